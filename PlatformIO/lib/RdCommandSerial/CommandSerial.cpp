@@ -152,7 +152,7 @@ void CommandSerial::service()
             int chunkPos = 0;
             int chunkLen = 0;
             bool finalChunk = false;
-            uint8_t* pData = _fileManager.chunkFileNext(filename, fileLen, chunkPos, chunkLen, finalChunk);
+            uint8_t* pData = _fileManager.chunkFileNext(this, filename, fileLen, chunkPos, chunkLen, finalChunk);
             if (pData && (chunkLen != 0))
             {
                 // Handle the chunk
@@ -164,6 +164,7 @@ void CommandSerial::service()
                 // Tidy up if finished
                 if (!finalChunk)
                     Log.warning("%supload 0 len but not final\n", MODULE_PREFIX);
+                _fileManager.chunkedFileEnd(this);
                 _uploadFromFSInProgress = false;
                 // Log.notice("File upload from FS timed out lastBlockMs %u betweenBlocksMs %u chunkLen %u finalChunk %d", 
                 //         _uploadLastBlockMs, DEFAULT_BETWEEN_BLOCKS_MS, chunkLen, finalChunk);
@@ -178,6 +179,8 @@ void CommandSerial::service()
         uint32_t curMs = millis();
         if (Utils::isTimeout(curMs+1, _uploadLastBlockMs, MAX_BETWEEN_BLOCKS_MS))
         {
+            if (_uploadFromFSInProgress)
+                _fileManager.chunkedFileEnd(this);
             _uploadFromFSInProgress = false;
             _uploadFromAPIInProgress = false;
             Log.notice("%sUpload block timed out millis %d lastBlockMs %d\n", MODULE_PREFIX, 
@@ -185,6 +188,8 @@ void CommandSerial::service()
         }
         if (Utils::isTimeout(curMs+1, _uploadStartMs, MAX_UPLOAD_MS))
         {
+            if (_uploadFromFSInProgress)
+                _fileManager.chunkedFileEnd(this);
             _uploadFromFSInProgress = false;
             _uploadFromAPIInProgress = false;
             Log.notice("%sUpload timed out\n", MODULE_PREFIX);
@@ -320,7 +325,7 @@ bool CommandSerial::startUploadFromFileSystem(const String& fileSystemName,
     }
 
     // Start a chunked file session
-    if (!_fileManager.chunkedFileStart(fileSystemName, filename, false))
+    if (!_fileManager.chunkedFileStart(fileSystemName, filename, false, this))
     {
         // Log.trace("%sstartUploadFromFileSystem failed to start %s\n", MODULE_PREFIX, filename.c_str());
         return false;
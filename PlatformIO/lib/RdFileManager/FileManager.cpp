@@ -152,6 +152,12 @@ void FileManager::reformat(const String& fileSystemStr, String& respStr)
     // Watchdog is not enabled on core 1 in Arduino according to this
     // https://www.bountysource.com/issues/44690700-watchdog-with-system-reset
     _cachedFileListValid = false;
+
+    // Close any chunked file session whoever owns it
+    xSemaphoreTake(_fileSysMutex, portMAX_DELAY);
+    chunkedFileClose();
+    _pChunkedFileOwner = NULL;
+    xSemaphoreGive(_fileSysMutex);
     disableCore0WDT();
     esp_err_t ret = esp_spiffs_format(NULL);
     enableCore0WDT();
@@ -397,6 +403,43 @@ String FileManager::getFileContents(const String& fileSystemStr, const String& f
     return readData;
 }
 
+int FileManager::getFileSection(const String& fileSystemStr, const String& filename, int startPos, uint8_t* pBuf, int maxLen)
+{
+    // Check file system supported
+    String nameOfFS;
+    if (!checkFileSystem(fileSystemStr, nameOfFS))
+    {
+        Log.trace("%sgetSection %s invalid file system %s\n", MODULE_PREFIX, filename.c_str(), fileSystemStr.c_str());
+        return -1;
+    }
+
+    // Take mutex
+    xSemaphoreTake(_fileSysMutex, portMAX_DELAY);
+
+    // Open file and move to the start position
+    String rootFilename = getFilePath(nameOfFS, filename);
+    FILE* pFile = fopen(rootFilename.c_str(), "rb");
+    if (!pFile)
+    {
+        xSemaphoreGive(_fileSysMutex);
+        Log.trace("%sgetSection failed to open file to read %s\n", MODULE_PREFIX, rootFilename.c_str());
+        return -1;
+    }
+    if (fseek(pFile, startPos, SEEK_SET) != 0)
+    {
+        fclose(pFile);
+        xSemaphoreGive(_fileSysMutex);
+        Log.trace("%sgetSection failed to seek to %d in %s\n", MODULE_PREFIX, startPos, rootFilename.c_str());
+        return -1;
+    }
+
+    // Read
+    size_t bytesRead = fread((char*)pBuf, 1, maxLen, pFile);
+    fclose(pFile);
+    xSemaphoreGive(_fileSysMutex);
+    return bytesRead;
+}
+
 bool FileManager::setFileContents(const String& fileSystemStr, const String& filename, String& fileContents)
 {
     // Check file system supported
@@ -512,6 +555,8 @@ bool FileManager::deleteFile(const String& fileSystemStr, const String& filename
     String rootFilename = getFilePath(nameOfFS, filename);
     if (stat(rootFilename.c_str(), &st) == 0) 
     {
+        if (_pChunkedFile && (rootFilename == _chunkedFilename))
+            chunkedFileClose();
         unlink(rootFilename.c_str());
     }
 
@@ -520,7 +565,7 @@ bool FileManager::deleteFile(const String& fileSystemStr, const String& filename
     return true;
 }
 
-bool FileManager::chunkedFileStart(const String& fileSystemStr, const String& filename, bool readByLine)
+bool FileManager::chunkedFileStart(const String& fileSystemStr, const String& filename, bool readByLine, const void* pOwner)
 {
     // Check file system supported
     String nameOfFS;
@@ -532,6 +577,16 @@ bool FileManager::chunkedFileStart(const String& fileSystemStr, const String& fi
     // Take mutex
     xSemaphoreTake(_fileSysMutex, portMAX_DELAY);
 
+    // Only one session at a time - the owner's previous session is ended
+    if (_pChunkedFileOwner && (_pChunkedFileOwner != pOwner))
+    {
+        Log.trace("%schunked file busy %s\n", MODULE_PREFIX, _chunkedFilename.c_str());
+        xSemaphoreGive(_fileSysMutex);
+        return false;
+    }
+    chunkedFileClose();
+    _pChunkedFileOwner = NULL;
+
     // Check file exists
     struct stat st;
     String rootFilename = getFilePath(nameOfFS, filename);
@@ -542,18 +597,65 @@ bool FileManager::chunkedFileStart(const String& fileSystemStr, const String& fi
         return false;
     }
     _chunkedFileLen = st.st_size;
-    xSemaphoreGive(_fileSysMutex);  
-    
+
+    // Open the file - it stays open until the final chunk
+    _pChunkedFile = fopen(rootFilename.c_str(), readByLine ? "r" : "rb");
+    if (!_pChunkedFile)
+    {
+        Log.trace("%schunkedFileStart failed open %s\n", MODULE_PREFIX, rootFilename.c_str());
+        xSemaphoreGive(_fileSysMutex);
+        return false;
+    }
+
     // Setup access
     _chunkedFilename = rootFilename;
     _chunkedFileInProgress = true;
+    _pChunkedFileOwner = pOwner;
     _chunkedFilePos = 0;
     _chunkOnLineEndings = readByLine;
+    _chunkedReadAheadPos = 0;
+    _chunkedReadAheadLen = 0;
+    if (readByLine)
+        _chunkedReadAhead.resize(CHUNKED_READ_AHEAD_LEN);
+    xSemaphoreGive(_fileSysMutex);
     Log.trace("%schunkedFileStart filename %s size %d byLine %s\n", MODULE_PREFIX, 
             rootFilename.c_str(), _chunkedFileLen, (readByLine ? "Y" : "N"));
     return true; 
 }
 
+void FileManager::chunkedFileEnd(const void* pOwner)
+{
+    xSemaphoreTake(_fileSysMutex, portMAX_DELAY);
+    if (_pChunkedFileOwner == pOwner)
+    {
+        chunkedFileClose();
+        _pChunkedFileOwner = NULL;
+    }
+    xSemaphoreGive(_fileSysMutex);
+}
+
+// Close the chunked file and release the read-ahead buffer - mutex must be held
+void FileManager::chunkedFileClose()
+{
+    if (_pChunkedFile)
+        fclose(_pChunkedFile);
+    _pChunkedFile = NULL;
+    _chunkedFileInProgress = false;
+    _chunkedReadAheadPos = 0;
+    _chunkedReadAheadLen = 0;
+    std::vector<uint8_t>().swap(_chunkedReadAhead);
+}
+
+// Refill the read-ahead buffer - returns false at end of file - mutex must be held
+bool FileManager::chunkedFileFillReadAhead()
+{
+    _chunkedReadAheadPos = 0;
+    _chunkedReadAheadLen = 0;
+    if (_pChunkedFile)
+        _chunkedReadAheadLen = fread(_chunkedReadAhead.data(), 1, _chunkedReadAhead.size(), _pChunkedFile);
+    return _chunkedReadAheadLen > 0;
+}
+
 char* FileManager::readLineFromFile(char* pBuf, int maxLen, FILE* pFile)
 {
     // Iterate over chars
@@ -582,83 +684,63 @@ char* FileManager::readLineFromFile(char* pBuf, int maxLen, FILE* pFile)
     return pBuf;
 }
 
-uint8_t* FileManager::chunkFileNext(String& filename, int& fileLen, int& chunkPos, int& chunkLen, bool& finalChunk)
+uint8_t* FileManager::chunkFileNext(const void* pOwner, String& filename, int& fileLen, int& chunkPos, int& chunkLen, bool& finalChunk)
 {
-    // Check valid
+    // Check valid - the session is only accessed by its owner and with the mutex held
     chunkLen = 0;
-    if (!_chunkedFileInProgress)
+    xSemaphoreTake(_fileSysMutex, portMAX_DELAY);
+    if (!_chunkedFileInProgress || !_pChunkedFile || (_pChunkedFileOwner != pOwner))
+    {
+        xSemaphoreGive(_fileSysMutex);
         return NULL;
+    }
 
     // Return details
     filename = _chunkedFilename;
     fileLen = _chunkedFileLen;
     chunkPos = _chunkedFilePos;
 
-    // Take mutex
-    xSemaphoreTake(_fileSysMutex, portMAX_DELAY);
-
-    // Open file and seek
-    FILE* pFile = NULL;
-    if (_chunkOnLineEndings)
-        pFile = fopen(_chunkedFilename.c_str(), "r");
-    else
-        pFile = fopen(_chunkedFilename.c_str(), "rb");
-    if (!pFile)
-    {
-            xSemaphoreGive(_fileSysMutex);  
-            Log.trace("%schunkNext failed open %s\n", MODULE_PREFIX, _chunkedFilename.c_str());
-            return NULL;
-    }    
-    if ((_chunkedFilePos != 0) && (fseek(pFile, _chunkedFilePos, SEEK_SET) != 0))
-    {
-        xSemaphoreGive(_fileSysMutex);  
-        Log.trace("%schunkNext failed seek in filename %s to %d\n", MODULE_PREFIX, 
-                        _chunkedFilename.c_str(), _chunkedFilePos);
-        fclose(pFile);
-        return NULL;
-    }
-
     // Handle data type
     if (_chunkOnLineEndings)
     {
-        // Read a line
-        char* pReadLine = readLineFromFile((char*)_chunkedFileBuffer, CHUNKED_BUF_MAXLEN-1, pFile);
-        // Ensure line is terminated
-        if (!pReadLine)
+        // Copy a line from the read-ahead buffer
+        bool lineEnded = false;
+        while (!lineEnded && (chunkLen < CHUNKED_BUF_MAXLEN-2))
         {
-            finalChunk = true;
-            _chunkedFileInProgress = false;
-            chunkLen = 0;
-        }
-        else
-        {
-            chunkLen = strlen((char*)_chunkedFileBuffer);
+            if ((_chunkedReadAheadPos >= _chunkedReadAheadLen) && !chunkedFileFillReadAhead())
+                break;
+            uint8_t ch = _chunkedReadAhead[_chunkedReadAheadPos++];
+            _chunkedFilePos++;
+            if (ch == '\n')
+                lineEnded = true;
+            else if (ch != '\r')
+                _chunkedFileBuffer[chunkLen++] = ch;
         }
-        // Record position
-        _chunkedFilePos = ftell(pFile);
+        _chunkedFileBuffer[chunkLen] = 0;
+
+        // Nothing more in the file
+        if (!lineEnded && (chunkLen == 0))
+            finalChunk = true;
     }
     else
     {
         // Fill the buffer with file data
-        chunkLen = fread((char*)_chunkedFileBuffer, 1, CHUNKED_BUF_MAXLEN, pFile);
+        chunkLen = fread((char*)_chunkedFileBuffer, 1, CHUNKED_BUF_MAXLEN, _pChunkedFile);
 
         // Record position and check if this was the final block
-        _chunkedFilePos = ftell(pFile);
+        _chunkedFilePos += chunkLen;
         if ((chunkLen != CHUNKED_BUF_MAXLEN) || (_chunkedFileLen <= _chunkedFilePos))
-        {
             finalChunk = true;
-            _chunkedFileInProgress = false;
-        }
-
     }
 
-    Log.verbose("%schunkNext filename %s chunklen %d filePos %d fileLen %d inprog %d final %d byLine %s\n", MODULE_PREFIX, 
+    Log.verbose("%schunkNext filename %s chunklen %d filePos %d fileLen %d final %d byLine %s\n", MODULE_PREFIX, 
                     _chunkedFilename.c_str(), chunkLen, _chunkedFilePos, _chunkedFileLen, 
-                    _chunkedFileInProgress, finalChunk, (_chunkOnLineEndings ? "Y" : "N"));
+                    finalChunk, (_chunkOnLineEndings ? "Y" : "N"));
 
-    // Close
-    fclose(pFile);
-    xSemaphoreGive(_fileSysMutex);  
+    // Close the file when done - the session (and the chunk data) remains with the owner
+    if (finalChunk)
+        chunkedFileClose();
+    xSemaphoreGive(_fileSysMutex);
     return _chunkedFileBuffer;
 }
 
@@ -5,6 +5,7 @@
 
 #include <Arduino.h>
 #include "ConfigBase.h"
+#include <vector>
 
 class FileManager
 {
@@ -20,14 +21,23 @@ private:
     // SD card
     void* _pSDCard;
 
-    // Chunked file access
+    // Chunked file access - the file is kept open for the whole session and when reading
+    // by line it is read ahead in large blocks and lines are handed out from the read-ahead buffer
+    // There is one session at a time which belongs to the caller which started it (until that caller
+    // ends it) - all session state is only accessed with the mutex held
     static const int CHUNKED_BUF_MAXLEN = 1000;
+    static const int CHUNKED_READ_AHEAD_LEN = 4096;
     uint8_t _chunkedFileBuffer[CHUNKED_BUF_MAXLEN];
     int _chunkedFileInProgress;
     int _chunkedFilePos;
     String _chunkedFilename;
     int _chunkedFileLen;
     bool _chunkOnLineEndings;
+    FILE* _pChunkedFile;
+    std::vector<uint8_t> _chunkedReadAhead;
+    int _chunkedReadAheadPos;
+    int _chunkedReadAheadLen;
+    const void* _pChunkedFileOwner;
 
     // Cached file list response
     String _cachedFileListResponse;
@@ -47,6 +57,10 @@ public:
         _chunkedFileLen = 0;
         _chunkedFilePos = 0;
         _chunkedFileInProgress = false;
+        _pChunkedFile = NULL;
+        _chunkedReadAheadPos = 0;
+        _chunkedReadAheadLen = 0;
+        _pChunkedFileOwner = NULL;
         _pSDCard = NULL;
         _fileSysMutex = xSemaphoreCreateMutex();
     }
@@ -65,6 +79,9 @@ public:
     String getFileContents(const String& fileSystemStr, const String& filename, int maxLen=0);
     bool setFileContents(const String& fileSystemStr, const String& filename, String& fileContents);
 
+    // Read part of a file into a buffer - returns number of bytes read or -1 on failure
+    int getFileSection(const String& fileSystemStr, const String& filename, int startPos, uint8_t* pBuf, int maxLen);
+
     // Handle a file upload block - same API as ESPAsyncWebServer file handler
     void uploadAPIBlockHandler(const char* fileSystem, const String& req, const String& filename, int fileLength, size_t index, uint8_t *data, size_t len, bool finalBlock);
     void uploadAPIBlocksComplete();
@@ -75,11 +92,16 @@ public:
     // Test file exists and get info
     bool getFileInfo(const String& fileSystemStr, const String& filename, int& fileLength);
 
-    // Start access to a file in chunks
-    bool chunkedFileStart(const String& fileSystemStr, const String& filename, bool readByLine);
+    // Start access to a file in chunks - pOwner identifies the caller (fails if another caller has
+    // a session in progress)
+    bool chunkedFileStart(const String& fileSystemStr, const String& filename, bool readByLine, const void* pOwner);
+
+    // Get next chunk of file - the data is valid until the owner's next call (or the session ends)
+    uint8_t* chunkFileNext(const void* pOwner, String& filename, int& fileLen, int& chunkPos, int& chunkLen, bool& finalChunk);
 
-    // Get next chunk of file
-    uint8_t* chunkFileNext(String& filename, int& fileLen, int& chunkPos, int& chunkLen, bool& finalChunk);
+    // End chunked file access - the file is closed after the final chunk but the session
+    // remains with its owner until this is called
+    void chunkedFileEnd(const void* pOwner);
 
     // Get file name extension
     static String getFileExtension(String& filename);
@@ -90,5 +112,7 @@ public:
 private:
     bool checkFileSystem(const String& fileSystemStr, String& fsName);
     String getFilePath(const String& nameOfFS, const String& filename);
+    bool chunkedFileFillReadAhead();
+    void chunkedFileClose();
 
 };
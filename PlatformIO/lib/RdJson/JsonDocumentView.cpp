@@ -0,0 +1,256 @@
+// RdJson
+// Rob Dobson 2017-2018
+
+#include "JsonDocumentView.h"
+#include "RdJson.h"
+
+JsonDocumentView::JsonDocumentView(const char* pSourceStr)
+{
+    _pSourceStr = pSourceStr;
+    _pTokens = NULL;
+    _numTokens = 0;
+    _keyIndexMask = 0;
+    if (!pSourceStr)
+        return;
+
+    // Parse json into tokens
+    _pTokens = RdJson::parseJson(pSourceStr, _numTokens);
+    if (_pTokens && (_numTokens <= 0))
+    {
+        delete[] _pTokens;
+        _pTokens = NULL;
+    }
+    if (!_pTokens)
+        return;
+
+    // Size the key index so it is never more than half full (each key has at least two tokens)
+    uint32_t indexSize = 4;
+    while (indexSize < (uint32_t)_numTokens)
+        indexSize <<= 1;
+    KeyIndexEntry emptyEntry = { 0, -1, -1 };
+    _keyIndex.assign(indexSize, emptyEntry);
+    _keyIndexMask = indexSize - 1;
+
+    // Index the whole document
+    _elementEnd.resize(_numTokens);
+    indexElement(0);
+}
+
+JsonDocumentView::~JsonDocumentView()
+{
+    delete[] _pTokens;
+}
+
+int JsonDocumentView::indexElement(int tokIdx)
+{
+    const jsmnrtok_t& tok = _pTokens[tokIdx];
+    int nextIdx = tokIdx + 1;
+    if (tok.type == JSMNR_OBJECT)
+    {
+        // Members are a key token followed by the value
+        for (int i = 0; (i < tok.size) && (nextIdx + 1 < _numTokens); i++)
+        {
+            addMember(tokIdx, nextIdx);
+            nextIdx = indexElement(nextIdx + 1);
+        }
+    }
+    else if (tok.type == JSMNR_ARRAY)
+    {
+        for (int i = 0; (i < tok.size) && (nextIdx < _numTokens); i++)
+            nextIdx = indexElement(nextIdx);
+    }
+    _elementEnd[tokIdx] = nextIdx;
+    return nextIdx;
+}
+
+void JsonDocumentView::addMember(int objTokIdx, int keyTokIdx)
+{
+    const jsmnrtok_t& keyTok = _pTokens[keyTokIdx];
+    const char* pKey = _pSourceStr + keyTok.start;
+    int keyLen = keyTok.end - keyTok.start;
+    uint32_t hash = keyHash(objTokIdx, pKey, keyLen);
+    for (uint32_t slot = hash & _keyIndexMask; ; slot = (slot + 1) & _keyIndexMask)
+    {
+        KeyIndexEntry& entry = _keyIndex[slot];
+        if (entry.keyTokIdx < 0)
+        {
+            entry.hash = hash;
+            entry.objTokIdx = objTokIdx;
+            entry.keyTokIdx = keyTokIdx;
+            return;
+        }
+        // Where a key is repeated the first one is used (as with RdJson)
+        if ((entry.hash == hash) && (entry.objTokIdx == objTokIdx))
+        {
+            const jsmnrtok_t& entryTok = _pTokens[entry.keyTokIdx];
+            if ((entryTok.end - entryTok.start == keyLen) && (strncmp(_pSourceStr + entryTok.start, pKey, keyLen) == 0))
+                return;
+        }
+    }
+}
+
+int JsonDocumentView::findMember(int objTokIdx, const char* pKey, int keyLen) const
+{
+    if (_pTokens[objTokIdx].type != JSMNR_OBJECT)
+        return -1;
+    uint32_t hash = keyHash(objTokIdx, pKey, keyLen);
+    for (uint32_t slot = hash & _keyIndexMask; ; slot = (slot + 1) & _keyIndexMask)
+    {
+        const KeyIndexEntry& entry = _keyIndex[slot];
+        if (entry.keyTokIdx < 0)
+            return -1;
+        if ((entry.hash == hash) && (entry.objTokIdx == objTokIdx))
+        {
+            const jsmnrtok_t& keyTok = _pTokens[entry.keyTokIdx];
+            if ((keyTok.end - keyTok.start == keyLen) && (strncmp(_pSourceStr + keyTok.start, pKey, keyLen) == 0))
+                return (entry.keyTokIdx + 1 < _numTokens) ? entry.keyTokIdx + 1 : -1;
+        }
+    }
+}
+
+int JsonDocumentView::findArrayElement(int arrayTokIdx, int elemIdx) const
+{
+    if ((_pTokens[arrayTokIdx].type != JSMNR_ARRAY) || (elemIdx >= _pTokens[arrayTokIdx].size))
+        return -1;
+    int tokIdx = arrayTokIdx + 1;
+    for (int i = 0; (i < elemIdx) && (tokIdx < _numTokens); i++)
+        tokIdx = _elementEnd[tokIdx];
+    return (tokIdx < _numTokens) ? tokIdx : -1;
+}
+
+int JsonDocumentView::findToken(const char* dataPath) const
+{
+    if (!_pTokens || !dataPath)
+        return -1;
+
+    // Go through the parts of the path - an empty key refers to the current element
+    // (so a leading / refers to the root)
+    int curTokIdx = 0;
+    const char* pPart = dataPath;
+    while (true)
+    {
+        const char* pPartEnd = strchr(pPart, '/');
+        bool isLastPart = (pPartEnd == NULL);
+        if (isLastPart)
+            pPartEnd = pPart + strlen(pPart);
+
+        // Key is followed by an optional array index
+        const char* pKeyEnd = pPart;
+        while ((pKeyEnd < pPartEnd) && (*pKeyEnd != '['))
+            pKeyEnd++;
+        if (pKeyEnd != pPart)
+        {
+            curTokIdx = findMember(curTokIdx, pPart, pKeyEnd - pPart);
+            if (curTokIdx < 0)
+                return -1;
+        }
+        if (pKeyEnd < pPartEnd)
+        {
+            long arrayIdx = strtol(pKeyEnd + 1, NULL, 10);
+            if (arrayIdx >= 0)
+            {
+                curTokIdx = findArrayElement(curTokIdx, arrayIdx);
+                if (curTokIdx < 0)
+                    return -1;
+            }
+        }
+
+        // Check if at the requested level
+        if (isLastPart)
+            return curTokIdx;
+
+        // Can only go deeper into an object
+        if (_pTokens[curTokIdx].type != JSMNR_OBJECT)
+            return -1;
+        pPart = pPartEnd + 1;
+    }
+}
+
+uint32_t JsonDocumentView::keyHash(int objTokIdx, const char* pKey, int keyLen)
+{
+    // FNV-1a of the key and the object containing it
+    uint32_t hash = 2166136261u ^ (uint32_t)objTokIdx;
+    for (int i = 0; i < keyLen; i++)
+    {
+        hash ^= (uint8_t)pKey[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Get location of element in JSON string
+bool JsonDocumentView::getElement(const char* dataPath,
+                        int& startPos, int& strLen,
+                        jsmnrtype_t& objType, int& objSize) const
+{
+    int tokIdx = findToken(dataPath);
+    if (tokIdx < 0)
+        return false;
+
+    // Extract information on element
+    objType = _pTokens[tokIdx].type;
+    objSize = _pTokens[tokIdx].size;
+    startPos = _pTokens[tokIdx].start;
+    strLen = _pTokens[tokIdx].end - startPos;
+    return true;
+}
+
+// Get a string from the JSON
+String JsonDocumentView::getString(const char* dataPath,
+                        const char* defaultValue, bool& isValid,
+                        jsmnrtype_t& objType, int& objSize) const
+{
+    // Find the element in the JSON
+    int startPos = 0, strLen = 0;
+    isValid = getElement(dataPath, startPos, strLen, objType, objSize);
+    if (!isValid)
+        return defaultValue;
+    return RdJson::getElementString(_pSourceStr, startPos, strLen, objType, objSize);
+}
+
+String JsonDocumentView::getString(const char* dataPath, const char* defaultValue, bool& isValid) const
+{
+    jsmnrtype_t objType = JSMNR_UNDEFINED;
+    int objSize = 0;
+    return getString(dataPath, defaultValue, isValid, objType, objSize);
+}
+
+String JsonDocumentView::getString(const char* dataPath, const char* defaultValue) const
+{
+    bool isValid = false;
+    return getString(dataPath, defaultValue, isValid);
+}
+
+double JsonDocumentView::getDouble(const char* dataPath, double defaultValue, bool& isValid) const
+{
+    int startPos = 0, strLen = 0;
+    jsmnrtype_t objType = JSMNR_UNDEFINED;
+    int objSize = 0;
+    isValid = getElement(dataPath, startPos, strLen, objType, objSize);
+    if (!isValid)
+        return defaultValue;
+    return strtod(_pSourceStr + startPos, NULL);
+}
+
+double JsonDocumentView::getDouble(const char* dataPath, double defaultValue) const
+{
+    bool isValid = false;
+    return getDouble(dataPath, defaultValue, isValid);
+}
+
+long JsonDocumentView::getLong(const char* dataPath, long defaultValue, bool& isValid) const
+{
+    int startPos = 0, strLen = 0;
+    jsmnrtype_t objType = JSMNR_UNDEFINED;
+    int objSize = 0;
+    isValid = getElement(dataPath, startPos, strLen, objType, objSize);
+    if (!isValid)
+        return defaultValue;
+    return strtol(_pSourceStr + startPos, NULL, 10);
+}
+
+long JsonDocumentView::getLong(const char* dataPath, long defaultValue) const
+{
+    bool isValid = false;
+    return getLong(dataPath, defaultValue, isValid);
+}
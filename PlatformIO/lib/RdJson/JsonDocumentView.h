@@ -0,0 +1,87 @@
+// RdJson
+// Rob Dobson 2017-2018
+
+// JsonDocumentView tokenizes a JSON string once and then answers many queries on it
+// Use this in place of the RdJson static methods where a number of values are read from the same JSON
+// (as happens when configuring) - each RdJson call parses the whole string again
+// The dataPath syntax is the same as for RdJson
+// The source string is not copied so it must remain valid (and unchanged) for the life of the view
+
+#pragma once
+#include <WString.h>
+#include <vector>
+#include "jsmnParticleR.h"
+
+class JsonDocumentView
+{
+public:
+    JsonDocumentView(const char* pSourceStr);
+    ~JsonDocumentView();
+
+    // Check the source was parsed ok
+    bool isValid() const
+    {
+        return _pTokens != NULL;
+    }
+
+    const char* getSourceStr() const
+    {
+        return _pSourceStr;
+    }
+
+    // Get location of element in JSON string
+    bool getElement(const char* dataPath,
+                    int& startPos, int& strLen,
+                    jsmnrtype_t& objType, int& objSize) const;
+
+    // Get a string from the JSON
+    String getString(const char* dataPath,
+                     const char* defaultValue, bool& isValid,
+                     jsmnrtype_t& objType, int& objSize) const;
+    String getString(const char* dataPath, const char* defaultValue, bool& isValid) const;
+    String getString(const char* dataPath, const char* defaultValue) const;
+
+    double getDouble(const char* dataPath, double defaultValue, bool& isValid) const;
+    double getDouble(const char* dataPath, double defaultValue) const;
+
+    long getLong(const char* dataPath, long defaultValue, bool& isValid) const;
+    long getLong(const char* dataPath, long defaultValue) const;
+
+private:
+    // Not copyable as the tokens are owned
+    JsonDocumentView(const JsonDocumentView&);
+    JsonDocumentView& operator=(const JsonDocumentView&);
+
+    // Index the tokens within an element - returns index of the token after the element
+    int indexElement(int tokIdx);
+    void addMember(int objTokIdx, int keyTokIdx);
+
+    // Find the token of a key's value in an object
+    int findMember(int objTokIdx, const char* pKey, int keyLen) const;
+
+    // Find the token of the nth element of an array
+    int findArrayElement(int arrayTokIdx, int elemIdx) const;
+
+    // Find the token referred to by a dataPath
+    int findToken(const char* dataPath) const;
+
+    static uint32_t keyHash(int objTokIdx, const char* pKey, int keyLen);
+
+    // Source and tokens
+    const char* _pSourceStr;
+    jsmnrtok_t* _pTokens;
+    int _numTokens;
+
+    // Index of token following each element (used to step over array elements)
+    std::vector<int> _elementEnd;
+
+    // Hashed index of object members - open addressing with linear probing
+    struct KeyIndexEntry
+    {
+        uint32_t hash;
+        int objTokIdx;
+        int keyTokIdx;
+    };
+    std::vector<KeyIndexEntry> _keyIndex;
+    uint32_t _keyIndexMask;
+};
@@ -50,7 +50,13 @@ String RdJson::getString(const char* dataPath,
     isValid = getElement(dataPath, startPos, strLen, objType, objSize, pSourceStr);
     if (!isValid)
         return defaultValue;
+    return getElementString(pSourceStr, startPos, strLen, objType, objSize);
+}
 
+// Get the string for an element found in the JSON
+String RdJson::getElementString(const char* pSourceStr, int startPos, int strLen,
+                        jsmnrtype_t objType, int& objSize)
+{
     // Extract string
     String outStr;
     char* pStr = safeStringDup(pSourceStr + startPos, strLen,
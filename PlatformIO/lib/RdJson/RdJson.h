@@ -32,6 +32,10 @@ public:
     static String getString(const char* dataPath, const char* defaultValue,
                             const char* pSourceStr, bool& isValid);
 
+    // Get the string for an element found in the JSON (used by getString)
+    static String getElementString(const char* pSourceStr, int startPos, int strLen,
+                            jsmnrtype_t objType, int& objSize);
+
     // Alternate form of getString with fewer parameters
     static String getString(const char* dataPath, const char* defaultValue,
                             const char* pSourceStr);
@@ -27,6 +27,10 @@ private:
     bool _moreMovesComing : 1;
     bool _isHoming: 1;
     bool _hasHomed: 1;
+    bool _isArc : 1;
+    bool _arcCentreValid : 1;
+    bool _arcRadiusValid : 1;
+    bool _pathBlendValid : 1;
     // Command control
     int _queuedCommands;
     int _numberedCommandIndex;
@@ -38,6 +42,11 @@ private:
     float _feedrateValue;
     RobotMoveTypeArg _moveType;
     AxisMinMaxBools _endstops;
+    // Arc centre (offset from start in X and Y) or radius
+    float _arcCentreOffset[2];
+    float _arcRadius;
+    // Path blending tolerance (0 for exact path, negative for the configured default)
+    float _pathBlendToleranceMM;
 
 public:
     RobotCommandArgs()
@@ -58,6 +67,10 @@ public:
         _moreMovesComing = false;
         _isHoming = false;
         _hasHomed = false;
+        _isArc = false;
+        _arcCentreValid = false;
+        _arcRadiusValid = false;
+        _pathBlendValid = false;
         // Command control
         _queuedCommands = 0;
         _numberedCommandIndex = RobotConsts::NUMBERED_COMMAND_NONE;
@@ -69,6 +82,10 @@ public:
         _feedrateValue = 0.0;
         _moveType = RobotMoveTypeArg_None;
         _endstops.none();
+        _arcCentreOffset[0] = 0;
+        _arcCentreOffset[1] = 0;
+        _arcRadius = 0;
+        _pathBlendToleranceMM = 0;
     }
 
     RobotCommandArgs& operator=(const RobotCommandArgs& copyFrom)
@@ -90,6 +107,10 @@ public:
             (_allowOutOfBounds == other._allowOutOfBounds) &&
             (_pause == other._pause) &&
             (_moreMovesComing == other._moreMovesComing) &&
+            (_isArc == other._isArc) &&
+            (_arcCentreValid == other._arcCentreValid) &&
+            (_arcRadiusValid == other._arcRadiusValid) &&
+            (_pathBlendValid == other._pathBlendValid) &&
             // Command control
             (_queuedCommands == other._queuedCommands) &&
             (_numberedCommandIndex == other._numberedCommandIndex) &&
@@ -97,7 +118,11 @@ public:
             (_extrudeValue == other._extrudeValue) &&
             (_feedrateValue == other._feedrateValue) &&
             (_moveType == other._moveType) &&
-            (_endstops == other._endstops);
+            (_endstops == other._endstops) &&
+            (_arcCentreOffset[0] == other._arcCentreOffset[0]) &&
+            (_arcCentreOffset[1] == other._arcCentreOffset[1]) &&
+            (_arcRadius == other._arcRadius) &&
+            (_pathBlendToleranceMM == other._pathBlendToleranceMM);
         if (!isEqual)
             return false;
         // Coords, etc
@@ -133,6 +158,10 @@ private:
         _allowOutOfBounds = copyFrom._allowOutOfBounds;
         _pause = copyFrom._pause;
         _moreMovesComing = copyFrom._moreMovesComing;
+        _isArc = copyFrom._isArc;
+        _arcCentreValid = copyFrom._arcCentreValid;
+        _arcRadiusValid = copyFrom._arcRadiusValid;
+        _pathBlendValid = copyFrom._pathBlendValid;
         // Command control
         _queuedCommands = copyFrom._queuedCommands;
         _numberedCommandIndex = copyFrom._numberedCommandIndex;
@@ -144,6 +173,10 @@ private:
         _feedrateValue = copyFrom._feedrateValue;
         _moveType = copyFrom._moveType;
         _endstops = copyFrom._endstops;
+        _arcCentreOffset[0] = copyFrom._arcCentreOffset[0];
+        _arcCentreOffset[1] = copyFrom._arcCentreOffset[1];
+        _arcRadius = copyFrom._arcRadius;
+        _pathBlendToleranceMM = copyFrom._pathBlendToleranceMM;
     }
 
 public:
@@ -236,6 +269,68 @@ public:
     {
         _moveRapid = moveRapid;
     }
+    void setMoveClockwise(bool moveClockwise)
+    {
+        _moveClockwise = moveClockwise;
+    }
+    bool getMoveClockwise()
+    {
+        return _moveClockwise;
+    }
+    void setIsArc(bool isArc)
+    {
+        _isArc = isArc;
+    }
+    bool isArc()
+    {
+        return _isArc;
+    }
+    // Arc centre offset from the start position (axisIdx 0 for X, 1 for Y)
+    void setArcCentreOffset(int axisIdx, float offset)
+    {
+        if (axisIdx >= 0 && axisIdx < 2)
+        {
+            _arcCentreOffset[axisIdx] = offset;
+            _arcCentreValid = true;
+        }
+    }
+    bool isArcCentreValid()
+    {
+        return _arcCentreValid;
+    }
+    float getArcCentreOffset(int axisIdx)
+    {
+        if (axisIdx >= 0 && axisIdx < 2)
+            return _arcCentreOffset[axisIdx];
+        return 0;
+    }
+    void setArcRadius(float radius)
+    {
+        _arcRadius = radius;
+        _arcRadiusValid = true;
+    }
+    bool isArcRadiusValid()
+    {
+        return _arcRadiusValid;
+    }
+    float getArcRadius()
+    {
+        return _arcRadius;
+    }
+    // Path blending (G64/G61) - tolerance 0 for exact path, negative for the configured default
+    void setPathBlendTolerance(float toleranceMM)
+    {
+        _pathBlendToleranceMM = toleranceMM;
+        _pathBlendValid = true;
+    }
+    bool isPathBlendValid()
+    {
+        return _pathBlendValid;
+    }
+    float getPathBlendTolerance()
+    {
+        return _pathBlendToleranceMM;
+    }
     void setMoreMovesComing(bool moreMovesComing)
     {
         _moreMovesComing = moreMovesComing;
@@ -26,6 +26,8 @@ const char *RobotConfigurations::_robotConfigs[] = {
 "   }"
 "   ,"
 "   \"blockDistanceMM\": 1,"
+"   \"blockDeviationMM\": 0.2,"
+"   \"coalesceToleranceMM\": 0.02,"
 "   \"allowOutOfBounds\": 0,"
 "   \"stepEnablePin\": \"4\","
 "   \"stepEnLev\": 1,"
@@ -114,6 +116,8 @@ const char *RobotConfigurations::_robotConfigs[] = {
 "   }"
 "   ,"
 "   \"blockDistanceMM\": 1,"
+"   \"blockDeviationMM\": 0.2,"
+"   \"coalesceToleranceMM\": 0.02,"
 "   \"allowOutOfBounds\": 0,"
 "   \"stepEnablePin\": \"21\","
 "   \"stepEnLev\": 0,"
@@ -211,6 +215,8 @@ const char *RobotConfigurations::_robotConfigs[] = {
 "   }"
 "   ,"
 "   \"blockDistanceMM\": 1,"
+"   \"blockDeviationMM\": 0.2,"
+"   \"coalesceToleranceMM\": 0.02,"
 "   \"allowOutOfBounds\": 0,"
 "   \"stepEnablePin\": \"21\","
 "   \"stepEnLev\": 0,"
@@ -290,6 +296,8 @@ const char *RobotConfigurations::_robotConfigs[] = {
 "   }"
 "   ,"
 "   \"blockDistanceMM\": 1,"
+"   \"blockDeviationMM\": 0.2,"
+"   \"coalesceToleranceMM\": 0.02,"
 "   \"allowOutOfBounds\": 0,"
 "   \"stepEnablePin\": \"12\","
 "   \"stepEnLev\": 0,"
@@ -18,6 +18,7 @@ class AxesParams
   public:
     // Cache values for master axis as they are used frequently in the planner
     float _masterAxisMaxAccMMps2;
+    float _masterAxisMaxJerkMMps3;
     // Cache max step rate
     AxisFloats _maxStepRatesPerSec;
 
@@ -31,6 +32,7 @@ class AxesParams
     {
         _masterAxisIdx = -1;
         _masterAxisMaxAccMMps2 = AxisParams::acceleration_default;
+        _masterAxisMaxJerkMMps3 = AxisParams::jerk_default;
         for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
             _axisParams[axisIdx].clear();
     }
@@ -132,6 +134,20 @@ class AxesParams
         return _axisParams[axisIdx]._maxAccelMMps2;
     }
 
+    float getMaxStepAccel(int axisIdx)
+    {
+        if (axisIdx < 0 || axisIdx >= RobotConsts::MAX_AXES)
+            return AxisParams::maxStepAccel_default;
+        return _axisParams[axisIdx]._maxStepAccel;
+    }
+
+    float getMaxJerk(int axisIdx)
+    {
+        if (axisIdx < 0 || axisIdx >= RobotConsts::MAX_AXES)
+            return AxisParams::jerk_default;
+        return _axisParams[axisIdx]._maxJerkMMps3;
+    }
+
     bool isPrimaryAxis(int axisIdx)
     {
         if (axisIdx < 0 || axisIdx >= RobotConsts::MAX_AXES)
@@ -201,5 +217,6 @@ class AxesParams
 
         // Cache values for master axis
         _masterAxisMaxAccMMps2 = getMaxAccel(_masterAxisIdx);
+        _masterAxisMaxJerkMMps3 = getMaxJerk(_masterAxisIdx);
     }
 };
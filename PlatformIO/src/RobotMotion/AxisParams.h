@@ -4,15 +4,19 @@
 #pragma once
 
 #include "RdJson.h"
+#include "JsonDocumentView.h"
 
 class AxisParams
 {
   public:
     static constexpr float maxSpeed_default = 100.0f;
     static constexpr float acceleration_default = 100.0f;
+    // Jerk of 0 means no jerk limit (trapezoidal rather than S-curve velocity profiles)
+    static constexpr float jerk_default = 0.0f;
     static constexpr float stepsPerRot_default = 1.0f;
     static constexpr float unitsPerRot_default = 1.0f;
     static constexpr float maxRPM_default = 300.0f;
+    static constexpr float maxStepAccel_default = 0.0f;
     static constexpr float homeOffsetVal_default = 0.0f;
     static constexpr long homeOffSteps_default = 0;
     static constexpr float minSpeedMMps_default = 0.0f;
@@ -22,9 +26,12 @@ class AxisParams
     float _maxSpeedMMps;
     float _minSpeedMMps;
     float _maxAccelMMps2;
+    float _maxJerkMMps3;
     float _stepsPerRot;
     float _unitsPerRot;
     float _maxRPM;
+    // Max actuator acceleration in steps per second per second (0 if not limited)
+    float _maxStepAccel;
     bool _minValValid;
     float _minVal;
     bool _maxValValid;
@@ -47,9 +54,11 @@ class AxisParams
         _maxSpeedMMps = maxSpeed_default;
         _minSpeedMMps = minSpeedMMps_default;
         _maxAccelMMps2 = acceleration_default;
+        _maxJerkMMps3 = jerk_default;
         _stepsPerRot = stepsPerRot_default;
         _unitsPerRot = unitsPerRot_default;
         _maxRPM = maxRPM_default;
+        _maxStepAccel = maxStepAccel_default;
         _minValValid = false;
         _minVal = 0;
         _maxValValid = false;
@@ -88,25 +97,29 @@ class AxisParams
 
     void setFromJSON(const char *axisJSON)
     {
+        JsonDocumentView axisDoc(axisJSON);
+
         // Stepper motor
-        _maxSpeedMMps = float(RdJson::getDouble("maxSpeed", AxisParams::maxSpeed_default, axisJSON));
-        _maxAccelMMps2 = float(RdJson::getDouble("maxAcc", AxisParams::acceleration_default, axisJSON));
-        _stepsPerRot = float(RdJson::getDouble("stepsPerRot", AxisParams::stepsPerRot_default, axisJSON));
-        _unitsPerRot = float(RdJson::getDouble("unitsPerRot", AxisParams::unitsPerRot_default, axisJSON));
-        _maxRPM = float(RdJson::getDouble("maxRPM", AxisParams::maxRPM_default, axisJSON));
-        _minVal = float(RdJson::getDouble("minVal", 0, _minValValid, axisJSON));
-        _maxVal = float(RdJson::getDouble("maxVal", 0, _maxValValid, axisJSON));
-        _isDominantAxis = RdJson::getLong("isDominantAxis", 0, axisJSON) != 0;
-        _isPrimaryAxis = RdJson::getLong("isPrimaryAxis", 1, axisJSON) != 0;
-        _isServoAxis = RdJson::getLong("isServoAxis", 0, axisJSON) != 0;
-        _homeOffsetVal = float(RdJson::getDouble("homeOffsetVal", 0, axisJSON));
-        _homeOffSteps = RdJson::getLong("homeOffSteps", 0, axisJSON);
+        _maxSpeedMMps = float(axisDoc.getDouble("maxSpeed", AxisParams::maxSpeed_default));
+        _maxAccelMMps2 = float(axisDoc.getDouble("maxAcc", AxisParams::acceleration_default));
+        _maxJerkMMps3 = float(axisDoc.getDouble("maxJerk", AxisParams::jerk_default));
+        _stepsPerRot = float(axisDoc.getDouble("stepsPerRot", AxisParams::stepsPerRot_default));
+        _unitsPerRot = float(axisDoc.getDouble("unitsPerRot", AxisParams::unitsPerRot_default));
+        _maxRPM = float(axisDoc.getDouble("maxRPM", AxisParams::maxRPM_default));
+        _maxStepAccel = float(axisDoc.getDouble("maxStepAccel", AxisParams::maxStepAccel_default));
+        _minVal = float(axisDoc.getDouble("minVal", 0, _minValValid));
+        _maxVal = float(axisDoc.getDouble("maxVal", 0, _maxValValid));
+        _isDominantAxis = axisDoc.getLong("isDominantAxis", 0) != 0;
+        _isPrimaryAxis = axisDoc.getLong("isPrimaryAxis", 1) != 0;
+        _isServoAxis = axisDoc.getLong("isServoAxis", 0) != 0;
+        _homeOffsetVal = float(axisDoc.getDouble("homeOffsetVal", 0));
+        _homeOffSteps = axisDoc.getLong("homeOffSteps", 0);
     }
 
     void debugLog(int axisIdx)
     {
-        Log.notice("Axis%d params maxSpeed %F, acceleration %F, stepsPerRot %F, unitsPerRot %F, maxRPM %F\n",
-                   axisIdx, _maxSpeedMMps, _maxAccelMMps2, _stepsPerRot, _unitsPerRot, _maxRPM);
+        Log.notice("Axis%d params maxSpeed %F, acceleration %F, jerk %F, stepsPerRot %F, unitsPerRot %F, maxRPM %F, maxStepAccel %F\n",
+                   axisIdx, _maxSpeedMMps, _maxAccelMMps2, _maxJerkMMps3, _stepsPerRot, _unitsPerRot, _maxRPM, _maxStepAccel);
         Log.notice("Axis%d params minVal %F (%d), maxVal %F (%d), isDominant %d, isServo %d, homeOffVal %F, homeOffSteps %d\n",
                    axisIdx, _minVal, _minValValid, _maxVal, _maxValValid, _isDominantAxis, _isServoAxis, _homeOffsetVal, _homeOffSteps);
     }
@@ -0,0 +1,188 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#include "MotionArc.h"
+#include "math.h"
+
+// Sweeps this close to zero are taken to be full circles
+static constexpr float ARC_ANGULAR_TRAVEL_EPSILON = 5E-7f;
+// Corners with a cosine of the change of direction above this are too straight to round and below
+// the negative of it are reversals which can't be rounded
+static constexpr float CORNER_BLEND_MAX_COS = 0.9999f;
+// Smallest radius of arc used to round a corner
+static constexpr float CORNER_BLEND_MIN_RADIUS_MM = 0.001f;
+
+MotionArc::MotionArc()
+{
+    clear();
+}
+
+void MotionArc::clear()
+{
+    _startPos.clear();
+    _endPos.clear();
+    _centreX = 0;
+    _centreY = 0;
+    _radius = 0;
+    _startAngleRads = 0;
+    _sweepRads = 0;
+}
+
+bool MotionArc::setupFromCentre(AxisFloats& startPos, AxisFloats& endPos, float centreOffsetX, float centreOffsetY, bool clockwise)
+{
+    _radius = sqrtf(centreOffsetX * centreOffsetX + centreOffsetY * centreOffsetY);
+    if (_radius < 1E-6f)
+        return false;
+    _startPos = startPos;
+    _endPos = endPos;
+    _centreX = startPos.getVal(0) + centreOffsetX;
+    _centreY = startPos.getVal(1) + centreOffsetY;
+
+    // Angle between the vectors from the centre to start and end
+    float startRelX = -centreOffsetX;
+    float startRelY = -centreOffsetY;
+    float endRelX = endPos.getVal(0) - _centreX;
+    float endRelY = endPos.getVal(1) - _centreY;
+    _startAngleRads = atan2f(startRelY, startRelX);
+    _sweepRads = atan2f(startRelX * endRelY - startRelY * endRelX, startRelX * endRelX + startRelY * endRelY);
+    if (clockwise)
+    {
+        if (_sweepRads >= -ARC_ANGULAR_TRAVEL_EPSILON)
+            _sweepRads -= 2 * M_PI;
+    }
+    else
+    {
+        if (_sweepRads <= ARC_ANGULAR_TRAVEL_EPSILON)
+            _sweepRads += 2 * M_PI;
+    }
+    return true;
+}
+
+bool MotionArc::setupFromRadius(AxisFloats& startPos, AxisFloats& endPos, float radius, bool clockwise)
+{
+    // Centre is on the perpendicular bisector of the chord from start to end
+    float chordX = endPos.getVal(0) - startPos.getVal(0);
+    float chordY = endPos.getVal(1) - startPos.getVal(1);
+    float chordLen = sqrtf(chordX * chordX + chordY * chordY);
+    if (chordLen < 1E-6f)
+        return false;
+    float hSquaredX4 = 4 * radius * radius - chordLen * chordLen;
+    if (hSquaredX4 < 0)
+    {
+        // Allow for rounding in the G-code when the chord is a diameter
+        if (hSquaredX4 < -0.01f * chordLen * chordLen)
+            return false;
+        hSquaredX4 = 0;
+    }
+    float hX2DivD = -sqrtf(hSquaredX4) / chordLen;
+    if (!clockwise)
+        hX2DivD = -hX2DivD;
+    if (radius < 0)
+        hX2DivD = -hX2DivD;
+    return setupFromCentre(startPos, endPos, 0.5f * (chordX - chordY * hX2DivD),
+                0.5f * (chordY + chordX * hX2DivD), clockwise);
+}
+
+bool MotionArc::setupCornerBlend(AxisFloats& startPos, AxisFloats& cornerPos, AxisFloats& nextPos, float toleranceMM,
+            AxisFloats& blendStartPos)
+{
+    if (toleranceMM <= 0)
+        return false;
+    // Only corners in the XY plane are rounded
+    for (int axisIdx = 2; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        if ((startPos._pt[axisIdx] != cornerPos._pt[axisIdx]) || (nextPos._pt[axisIdx] != cornerPos._pt[axisIdx]))
+            return false;
+
+    // Unit vectors along the two lines
+    float inX = cornerPos.getVal(0) - startPos.getVal(0);
+    float inY = cornerPos.getVal(1) - startPos.getVal(1);
+    float outX = nextPos.getVal(0) - cornerPos.getVal(0);
+    float outY = nextPos.getVal(1) - cornerPos.getVal(1);
+    float inLen = sqrtf(inX * inX + inY * inY);
+    float outLen = sqrtf(outX * outX + outY * outY);
+    if ((inLen < 1E-6f) || (outLen < 1E-6f))
+        return false;
+    inX /= inLen;
+    inY /= inLen;
+    outX /= outLen;
+    outY /= outLen;
+    float cosTheta = inX * outX + inY * outY;
+    if ((cosTheta > CORNER_BLEND_MAX_COS) || (cosTheta < -CORNER_BLEND_MAX_COS))
+        return false;
+
+    // The arc is tangent to both lines - alpha is half the angle between them so the corner is
+    // r/sin(alpha) from the centre and r/sin(alpha) - r from the arc - the tangent points are
+    // r/tan(alpha) from the corner
+    float sinAlpha = sqrtf((1 + cosTheta) / 2);
+    float cosAlpha = sqrtf((1 - cosTheta) / 2);
+    float radius = toleranceMM * sinAlpha / (1 - sinAlpha);
+    float tangentDist = toleranceMM * cosAlpha / (1 - sinAlpha);
+    float maxTangentDist = fminf(inLen, outLen) / 2;
+    if (tangentDist > maxTangentDist)
+    {
+        tangentDist = maxTangentDist;
+        radius = tangentDist * sinAlpha / cosAlpha;
+    }
+    if (radius < CORNER_BLEND_MIN_RADIUS_MM)
+        return false;
+
+    // Tangent points and the centre which is to the left of the first line for an anticlockwise turn
+    bool clockwise = (inX * outY - inY * outX) < 0;
+    AxisFloats blendEndPos = cornerPos;
+    blendStartPos = cornerPos;
+    blendStartPos.setVal(0, cornerPos.getVal(0) - inX * tangentDist);
+    blendStartPos.setVal(1, cornerPos.getVal(1) - inY * tangentDist);
+    blendEndPos.setVal(0, cornerPos.getVal(0) + outX * tangentDist);
+    blendEndPos.setVal(1, cornerPos.getVal(1) + outY * tangentDist);
+    float centreOffsetX = clockwise ? inY * radius : -inY * radius;
+    float centreOffsetY = clockwise ? -inX * radius : inX * radius;
+    return setupFromCentre(blendStartPos, blendEndPos, centreOffsetX, centreOffsetY, clockwise);
+}
+
+int MotionArc::getNumSegments(float chordToleranceMM, float maxSegmentMM)
+{
+    float numSegments = 1;
+    float sweepAbs = fabsf(_sweepRads);
+
+    // The largest angle for which the chord stays within tolerance of the arc
+    if (chordToleranceMM > 0)
+    {
+        float cosHalfAngle = 1 - chordToleranceMM / _radius;
+        if (cosHalfAngle < -1)
+            cosHalfAngle = -1;
+        float segAngle = 2 * acosf(cosHalfAngle);
+        if (segAngle > 0)
+            numSegments = ceilf(sweepAbs / segAngle);
+    }
+
+    // Helical length is used for the segment length limit
+    if (maxSegmentMM > 0)
+    {
+        float arcLen = _radius * sweepAbs;
+        float zDist = _endPos.getVal(2) - _startPos.getVal(2);
+        float pathLen = sqrtf(arcLen * arcLen + zDist * zDist);
+        numSegments = fmaxf(numSegments, ceilf(pathLen / maxSegmentMM));
+    }
+    if (numSegments < 1)
+        return 1;
+    if (numSegments > MAX_SEGMENTS)
+        return MAX_SEGMENTS;
+    return int(numSegments);
+}
+
+void MotionArc::getSegmentEnd(int segIdx, int numSegments, AxisFloats& pt)
+{
+    if (segIdx + 1 >= numSegments)
+    {
+        pt = _endPos;
+        return;
+    }
+    // Axes other than X and Y move linearly
+    float frac = float(segIdx + 1) / numSegments;
+    pt = _endPos;
+    for (int axisIdx = 2; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        pt._pt[axisIdx] = _startPos._pt[axisIdx] + (_endPos._pt[axisIdx] - _startPos._pt[axisIdx]) * frac;
+    float angle = _startAngleRads + _sweepRads * frac;
+    pt.setVal(0, _centreX + _radius * cosf(angle));
+    pt.setVal(1, _centreY + _radius * sinf(angle));
+}
@@ -0,0 +1,57 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include "AxisValues.h"
+
+// Arc in the XY plane (G2/G3) - other axes move linearly so helical moves are possible
+// Points along the arc are generated on demand so an arc doesn't need storage per segment
+class MotionArc
+{
+public:
+    // Limit on segments for a single arc
+    static const int MAX_SEGMENTS = 20000;
+
+    MotionArc();
+    void clear();
+
+    // Setup with the centre as an offset from the start position (G-code I and J)
+    bool setupFromCentre(AxisFloats& startPos, AxisFloats& endPos, float centreOffsetX, float centreOffsetY, bool clockwise);
+    // Setup from a radius (G-code R) - a negative radius selects the arc of more than 180 degrees
+    bool setupFromRadius(AxisFloats& startPos, AxisFloats& endPos, float radius, bool clockwise);
+    // Setup as the arc which rounds the corner between two lines in the XY plane passing no further
+    // than toleranceMM from the corner - the arc starts at blendStartPos on the first line and uses at
+    // most half of each line - returns false if the corner can't be rounded
+    bool setupCornerBlend(AxisFloats& startPos, AxisFloats& cornerPos, AxisFloats& nextPos, float toleranceMM,
+                AxisFloats& blendStartPos);
+
+    // Number of straight segments needed to keep the chord error within tolerance and
+    // (if maxSegmentMM is non-zero) each segment no longer than maxSegmentMM
+    int getNumSegments(float chordToleranceMM, float maxSegmentMM);
+
+    // End point of a segment - the last segment ends exactly on the end position
+    void getSegmentEnd(int segIdx, int numSegments, AxisFloats& pt);
+
+    float getRadius()
+    {
+        return _radius;
+    }
+    float getSweepRads()
+    {
+        return _sweepRads;
+    }
+    AxisFloats& getEndPos()
+    {
+        return _endPos;
+    }
+
+private:
+    AxisFloats _startPos;
+    AxisFloats _endPos;
+    float _centreX;
+    float _centreY;
+    float _radius;
+    float _startAngleRads;
+    float _sweepRads;
+};
@@ -17,6 +17,7 @@ void MotionBlock::clear()
     // Clear values
     _feedrate = 0;
     _moveDistPrimaryAxesMM = 0;
+    _actuatorMaxAccMMps2 = 0;
     _maxEntrySpeedMMps = 0;
     _entrySpeedMMps = 0;
     _exitSpeedMMps = 0;
@@ -27,6 +28,8 @@ void MotionBlock::clear()
     _axisIdxWithMaxSteps = 0;
     _unitVecAxisWithMaxDist = 0;
     _accStepsPerTTicksPerMS = 0;
+    _jerkStepsPerTTicksPerMSPerMS = 0;
+    _accStepRateSqrPerStep = 0;
     _finalStepRatePerTTicks = 0;
     _initialStepRatePerTTicks = 0;
     _maxStepRatePerTTicks = 0;
@@ -78,9 +81,59 @@ uint32_t MotionBlock::getExitStepRatePerTTicks()
     return _finalStepRatePerTTicks;
 }
 
-float MotionBlock::maxAchievableSpeed(float acceleration, float target_velocity, float distance)
+// Max acceleration for the block - the lower of the master axis limit and the actuator limit
+float MotionBlock::getMaxAccMMps2(AxesParams &axesParams)
 {
-    return sqrtf(target_velocity * target_velocity + 2.0F * acceleration * distance);
+    return capToActuatorAcc(axesParams._masterAxisMaxAccMMps2);
+}
+
+// Limit an acceleration to the actuator limit for the block (if there is one)
+float MotionBlock::capToActuatorAcc(float accMMps2)
+{
+    if ((_actuatorMaxAccMMps2 > 0) && (_actuatorMaxAccMMps2 < accMMps2))
+        return _actuatorMaxAccMMps2;
+    return accMMps2;
+}
+
+// Max speed that can be reached from (or slowed to) target_velocity within distance
+// If jerk is non-zero the speed change uses an S-curve which starts and ends with zero acceleration
+float MotionBlock::maxAchievableSpeed(float acceleration, float jerk, float target_velocity, float distance)
+{
+    if (jerk <= 0)
+        return sqrtf(target_velocity * target_velocity + 2.0F * acceleration * distance);
+
+    // Check if there is room to reach full acceleration - the minimum such speed change is acc^2/jerk
+    float accLimitedSpeedChange = acceleration * acceleration / jerk;
+    if (distance >= distanceToChangeSpeed(acceleration, jerk, target_velocity, target_velocity + accLimitedSpeedChange))
+    {
+        // Solve distance = (v1^2 - v0^2) / 2a + (v0 + v1) * a / 2j for v1
+        float c = accLimitedSpeedChange * target_velocity - target_velocity * target_velocity - 2.0F * acceleration * distance;
+        return (sqrtf(accLimitedSpeedChange * accLimitedSpeedChange - 4.0F * c) - accLimitedSpeedChange) / 2;
+    }
+
+    // Solve distance = (2 * v0 + dv) * sqrt(dv / j) - a depressed cubic in sqrt(dv)
+    float p = 2.0F * target_velocity;
+    float q = distance * sqrtf(jerk);
+    float r = sqrtf(q * q / 4 + p * p * p / 27);
+    float sqrtSpeedChange = cbrtf(q / 2 + r) + cbrtf(q / 2 - r);
+    return target_velocity + sqrtSpeedChange * sqrtSpeedChange;
+}
+
+// Distance required to change between two speeds
+// If jerk is non-zero the speed change uses an S-curve which starts and ends with zero acceleration
+float MotionBlock::distanceToChangeSpeed(float acceleration, float jerk, float velocity1, float velocity2)
+{
+    float speedChange = fabsf(velocity2 - velocity1);
+    if (jerk <= 0)
+        return speedChange * (velocity1 + velocity2) / 2 / acceleration;
+
+    // The profile is symmetrical so average speed is the mean of the start and end speeds
+    float timeToChange = 0;
+    if (speedChange >= acceleration * acceleration / jerk)
+        timeToChange = speedChange / acceleration + acceleration / jerk;
+    else
+        timeToChange = 2 * sqrtf(speedChange / jerk);
+    return timeToChange * (velocity1 + velocity2) / 2;
 }
 
 void MotionBlock::forceInBounds(float &val, float lowBound, float highBound)
@@ -113,6 +166,7 @@ bool MotionBlock::prepareForStepping(AxesParams &axesParams, bool isStepwise)
     float initialStepRatePerSec = 0;
     float finalStepRatePerSec = 0;
     float maxAccStepsPerSec2 = 0;
+    float maxJerkStepsPerSec3 = 0;
     float axisMaxStepRatePerSec = 0;
     uint32_t stepsDecelerating = 0; 
     double stepDistMM = 0;
@@ -138,56 +192,95 @@ bool MotionBlock::prepareForStepping(AxesParams &axesParams, bool isStepwise)
         finalStepRatePerSec = fabsf(_exitSpeedMMps / stepDistMM);
         if (finalStepRatePerSec > axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps))
             finalStepRatePerSec = axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps);
-        maxAccStepsPerSec2 = fabsf(axesParams.getMaxAccel(_axisIdxWithMaxSteps) / stepDistMM);
-
-        // Calculate the distance decelerating and ensure within bounds
-        // Using the facts for the block ... (assuming max accleration followed by max deceleration):
-        //		Vmax * Vmax = Ventry * Ventry + 2 * Amax * Saccelerating
-        //		Vexit * Vexit = Vmax * Vmax - 2 * Amax * Sdecelerating
-        //      Stotal = Saccelerating + Sdecelerating
-        // And solving for Saccelerating (distance accelerating)
-        uint32_t stepsAccelerating = 0;
-        float stepsAcceleratingFloat =
-            ceilf((powf(finalStepRatePerSec, 2) - powf(initialStepRatePerSec, 2)) / 4 /
-                        maxAccStepsPerSec2 +
-                    absMaxStepsForAnyAxis / 2);
-        if (stepsAcceleratingFloat > 0)
-        {
-            stepsAccelerating = uint32_t(stepsAcceleratingFloat);
-            if (stepsAccelerating > absMaxStepsForAnyAxis)
-                stepsAccelerating = absMaxStepsForAnyAxis;
-        }
+        float maxAccMMps2 = capToActuatorAcc(axesParams.getMaxAccel(_axisIdxWithMaxSteps));
+        maxAccStepsPerSec2 = fabsf(maxAccMMps2 / stepDistMM);
 
-        // Decelerating steps
-        stepsDecelerating = 0;
+        // Jerk for the axis with max steps (0 if not jerk limited)
+        maxJerkStepsPerSec3 = fabsf(axesParams.getMaxJerk(_axisIdxWithMaxSteps) / stepDistMM);
 
         // Find max possible rate for axis with max steps
         axisMaxStepRatePerSec = fabsf(_feedrate / stepDistMM);
         if (axisMaxStepRatePerSec > axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps))
             axisMaxStepRatePerSec = axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps);
 
-        // See if max speed will be reached
-        uint32_t stepsToMaxSpeed =
-            uint32_t((powf(axisMaxStepRatePerSec, 2) - powf(initialStepRatePerSec, 2)) /
-                        2 / maxAccStepsPerSec2);
-        if (stepsAccelerating > stepsToMaxSpeed)
+        if (maxJerkStepsPerSec3 > 0)
         {
-            // Max speed will be reached
-            stepsAccelerating = stepsToMaxSpeed;
+            // S-curve profile - see if max speed will be reached
+            float stepsToMaxSpeed = distanceToChangeSpeed(maxAccStepsPerSec2, maxJerkStepsPerSec3,
+                                                        initialStepRatePerSec, axisMaxStepRatePerSec);
+            float stepsFromMaxSpeed = distanceToChangeSpeed(maxAccStepsPerSec2, maxJerkStepsPerSec3,
+                                                        axisMaxStepRatePerSec, finalStepRatePerSec);
+            if (stepsToMaxSpeed + stepsFromMaxSpeed > absMaxStepsForAnyAxis)
+            {
+                // Max speed won't be reached so search for the peak speed that uses all the steps
+                float lowRate = fminf(fmaxf(initialStepRatePerSec, finalStepRatePerSec), axisMaxStepRatePerSec);
+                float highRate = axisMaxStepRatePerSec;
+                for (int i = 0; i < SCURVE_PEAK_RATE_SEARCH_ITERATIONS; i++)
+                {
+                    float midRate = (lowRate + highRate) / 2;
+                    if (distanceToChangeSpeed(maxAccStepsPerSec2, maxJerkStepsPerSec3, initialStepRatePerSec, midRate) +
+                            distanceToChangeSpeed(maxAccStepsPerSec2, maxJerkStepsPerSec3, midRate, finalStepRatePerSec) >
+                            absMaxStepsForAnyAxis)
+                        highRate = midRate;
+                    else
+                        lowRate = midRate;
+                }
+                axisMaxStepRatePerSec = lowRate;
+                stepsFromMaxSpeed = distanceToChangeSpeed(maxAccStepsPerSec2, maxJerkStepsPerSec3,
+                                                        axisMaxStepRatePerSec, finalStepRatePerSec);
+            }
 
             // Decelerating steps
-            stepsDecelerating =
-                uint32_t((powf(axisMaxStepRatePerSec, 2) - powf(finalStepRatePerSec, 2)) /
-                            2 / maxAccStepsPerSec2);
+            stepsDecelerating = uint32_t(stepsFromMaxSpeed);
+            if (stepsDecelerating > absMaxStepsForAnyAxis)
+                stepsDecelerating = absMaxStepsForAnyAxis;
         }
         else
         {
-            // Calculate max speed that will be reached
-            axisMaxStepRatePerSec =
-                sqrtf(powf(initialStepRatePerSec, 2) + 2.0F * maxAccStepsPerSec2 * stepsAccelerating);
+            // Calculate the distance decelerating and ensure within bounds
+            // Using the facts for the block ... (assuming max accleration followed by max deceleration):
+            //		Vmax * Vmax = Ventry * Ventry + 2 * Amax * Saccelerating
+            //		Vexit * Vexit = Vmax * Vmax - 2 * Amax * Sdecelerating
+            //      Stotal = Saccelerating + Sdecelerating
+            // And solving for Saccelerating (distance accelerating)
+            uint32_t stepsAccelerating = 0;
+            float stepsAcceleratingFloat =
+                ceilf((powf(finalStepRatePerSec, 2) - powf(initialStepRatePerSec, 2)) / 4 /
+                            maxAccStepsPerSec2 +
+                        absMaxStepsForAnyAxis / 2);
+            if (stepsAcceleratingFloat > 0)
+            {
+                stepsAccelerating = uint32_t(stepsAcceleratingFloat);
+                if (stepsAccelerating > absMaxStepsForAnyAxis)
+                    stepsAccelerating = absMaxStepsForAnyAxis;
+            }
 
             // Decelerating steps
-            stepsDecelerating = absMaxStepsForAnyAxis - stepsAccelerating;
+            stepsDecelerating = 0;
+
+            // See if max speed will be reached
+            uint32_t stepsToMaxSpeed =
+                uint32_t((powf(axisMaxStepRatePerSec, 2) - powf(initialStepRatePerSec, 2)) /
+                            2 / maxAccStepsPerSec2);
+            if (stepsAccelerating > stepsToMaxSpeed)
+            {
+                // Max speed will be reached
+                stepsAccelerating = stepsToMaxSpeed;
+
+                // Decelerating steps
+                stepsDecelerating =
+                    uint32_t((powf(axisMaxStepRatePerSec, 2) - powf(finalStepRatePerSec, 2)) /
+                                2 / maxAccStepsPerSec2);
+            }
+            else
+            {
+                // Calculate max speed that will be reached
+                axisMaxStepRatePerSec =
+                    sqrtf(powf(initialStepRatePerSec, 2) + 2.0F * maxAccStepsPerSec2 * stepsAccelerating);
+
+                // Decelerating steps
+                stepsDecelerating = absMaxStepsForAnyAxis - stepsAccelerating;
+            }
         }
     }
 
@@ -196,6 +289,11 @@ bool MotionBlock::prepareForStepping(AxesParams &axesParams, bool isStepwise)
     _maxStepRatePerTTicks = uint32_t((axisMaxStepRatePerSec * TTICKS_VALUE) / TICKS_PER_SEC);
     _finalStepRatePerTTicks = uint32_t((finalStepRatePerSec * TTICKS_VALUE) / TICKS_PER_SEC);
     _accStepsPerTTicksPerMS = uint32_t((maxAccStepsPerSec2 * TTICKS_VALUE) / TICKS_PER_SEC / 1000);
+    _jerkStepsPerTTicksPerMSPerMS = 0;
+    if (maxJerkStepsPerSec3 > 0)
+        _jerkStepsPerTTicksPerMSPerMS = std::max(uint32_t((maxJerkStepsPerSec3 * TTICKS_VALUE) / TICKS_PER_SEC / 1000000), 1u);
+    _accStepRateSqrPerStep = uint64_t(2 * maxAccStepsPerSec2 * STEP_RATE_PER_TTICKS_PER_STEP_PER_SEC *
+                                        STEP_RATE_PER_TTICKS_PER_STEP_PER_SEC);
     _stepsBeforeDecel = absMaxStepsForAnyAxis - stepsDecelerating;
     _debugStepDistMM = stepDistMM;
 
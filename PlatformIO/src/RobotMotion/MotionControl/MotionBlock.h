@@ -25,6 +25,12 @@ public:
     // Number of ns in ms
     static constexpr uint32_t NS_IN_A_MS = 1000000;
 
+    // Iterations used to find the peak step rate of an S-curve block which can't reach its feedrate
+    static constexpr int SCURVE_PEAK_RATE_SEARCH_ITERATIONS = 16;
+
+    // Step rate (in TTicks per tick) of one step per second
+    static constexpr double STEP_RATE_PER_TTICKS_PER_STEP_PER_SEC = TTICKS_VALUE / TICKS_PER_SEC;
+
 public:
     // Max speed for move - either MMps or stepsPerSec depending if move is stepwise
     float _feedrate;
@@ -32,6 +38,8 @@ public:
     float _moveDistPrimaryAxesMM;
     // Unit vector on axis with max movement
     float _unitVecAxisWithMaxDist;
+    // Max acceleration allowed by the actuators for this block (0 if only the axis limits apply)
+    float _actuatorMaxAccMMps2;
     // Computed max entry speed for a block based on max junction deviation calculation
     float _maxEntrySpeedMMps;
     // Computed entry speed for this block
@@ -46,16 +54,14 @@ public:
     // like homing
     int _numberedCommandIndex;
 
-    // Flags
-    struct
-    {
-        // Flag indicating the block is currently executing
-        volatile bool _isExecuting : 1;
-        // Flag indicating the block can start executing
-        volatile bool _canExecute : 1;
-        // Block is followed by others
-        bool _blockIsFollowed : 1;
-    };
+    // Flags - these are separate bytes rather than bitfields as they are written from different contexts
+    // Flag indicating the block is currently executing - only written by the ramp generator
+    volatile bool _isExecuting;
+    // Flag indicating the block can start executing - only written by the planner and handed over to
+    // the ramp generator through the pipeline
+    bool _canExecute;
+    // Block is followed by others
+    bool _blockIsFollowed;
 
     // Steps to target and before deceleration
     int32_t _stepsTotalMaybeNeg[RobotConsts::MAX_AXES];
@@ -67,6 +73,11 @@ public:
     uint32_t _maxStepRatePerTTicks;
     uint32_t _finalStepRatePerTTicks;
     uint32_t _accStepsPerTTicksPerMS;
+    // Jerk (change in acceleration per ms) - 0 for a trapezoidal profile
+    uint32_t _jerkStepsPerTTicksPerMSPerMS;
+    // Change in the square of the step rate for each step at max acceleration (v^2 = u^2 + 2as)
+    // used when the step rate is updated on every step rather than every ms
+    uint64_t _accStepRateSqrPerStep;
 
 public:
     MotionBlock();
@@ -77,7 +88,10 @@ public:
     int32_t getAbsStepsToTarget(int axisIdx);
     void setStepsToTarget(int axisIdx, int32_t steps);
     uint32_t getExitStepRatePerTTicks();
-    static float maxAchievableSpeed(float acceleration, float target_velocity, float distance);
+    float getMaxAccMMps2(AxesParams &axesParams);
+    float capToActuatorAcc(float accMMps2);
+    static float maxAchievableSpeed(float acceleration, float jerk, float target_velocity, float distance);
+    static float distanceToChangeSpeed(float acceleration, float jerk, float velocity1, float velocity2);
     void forceInBounds(float &val, float lowBound, float highBound);
     void setEndStopsToCheck(AxisMinMaxBools &endStopCheck);
 
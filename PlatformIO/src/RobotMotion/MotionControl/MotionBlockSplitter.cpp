@@ -0,0 +1,115 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#include "MotionBlockSplitter.h"
+#include "math.h"
+
+MotionBlockSplitter::MotionBlockSplitter()
+{
+    _ptToActuatorFn = nullptr;
+    _actuatorToPtFn = nullptr;
+    _lineLenMM = 0;
+    _toleranceMM = 0;
+    _allowOutOfBounds = false;
+    _curFrac = 1;
+    _lastStepFrac = 1;
+}
+
+void MotionBlockSplitter::setTransforms(ptToActuatorFnType ptToActuatorFn, actuatorToPtFnType actuatorToPtFn)
+{
+    _ptToActuatorFn = ptToActuatorFn;
+    _actuatorToPtFn = actuatorToPtFn;
+}
+
+void MotionBlockSplitter::setup(AxisFloats& startPos, AxisFloats& endPos, float toleranceMM, bool allowOutOfBounds)
+{
+    _startPos = startPos;
+    _endPos = endPos;
+    float dx = endPos.getVal(0) - startPos.getVal(0);
+    float dy = endPos.getVal(1) - startPos.getVal(1);
+    _lineLenMM = sqrtf(dx * dx + dy * dy);
+    _toleranceMM = toleranceMM;
+    _allowOutOfBounds = allowOutOfBounds;
+    _curFrac = 0;
+    _lastStepFrac = 1;
+}
+
+void MotionBlockSplitter::nextBlockEnd(AxisPosition& curPos, AxesParams& axesParams, AxisFloats& blockEnd)
+{
+    // Start from double the last block length and halve until within tolerance
+    float remainingFrac = 1 - _curFrac;
+    float minStepFrac = (_lineLenMM > MIN_BLOCK_LEN_MM) ? MIN_BLOCK_LEN_MM / _lineLenMM : 1;
+    float stepFrac = fminf(remainingFrac, _lastStepFrac * 2);
+    while (true)
+    {
+        if (stepFrac <= minStepFrac)
+        {
+            stepFrac = fminf(minStepFrac, remainingFrac);
+            break;
+        }
+        pointOnLine(_curFrac + stepFrac, blockEnd);
+        if (blockDeviationMM(curPos, blockEnd, axesParams) <= _toleranceMM)
+            break;
+        stepFrac /= 2;
+    }
+    _lastStepFrac = stepFrac;
+    _curFrac += stepFrac;
+
+    // Last block ends exactly at the end of the line
+    if (_curFrac >= 1 - 1E-6f)
+    {
+        _curFrac = 1;
+        blockEnd = _endPos;
+        return;
+    }
+    pointOnLine(_curFrac, blockEnd);
+}
+
+float MotionBlockSplitter::blockDeviationMM(AxisPosition& curPos, AxisFloats& blockEnd, AxesParams& axesParams,
+            int numCheckPts)
+{
+    if (!_ptToActuatorFn || !_actuatorToPtFn)
+        return 0;
+
+    // Actuator coords at the end of the block (out of bounds blocks are rejected by the planner)
+    AxisFloats endActuator;
+    if (!_ptToActuatorFn(blockEnd, endActuator, curPos, axesParams, _allowOutOfBounds))
+        return 0;
+
+    // Check points part way along the block in actuator space
+    float maxDevMM = 0;
+    for (int ptIdx = 1; ptIdx <= numCheckPts; ptIdx++)
+    {
+        float frac = float(ptIdx) / (numCheckPts + 1);
+        AxisInt32s checkActuator;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        {
+            float startSteps = curPos._stepsFromHome.getVal(axisIdx);
+            checkActuator.setVal(axisIdx, int32_t(roundf(startSteps + (endActuator.getVal(axisIdx) - startSteps) * frac)));
+        }
+        AxisFloats checkPt;
+        _actuatorToPtFn(checkActuator, checkPt, curPos, axesParams);
+        maxDevMM = fmaxf(maxDevMM, distFromLine(checkPt));
+    }
+    return maxDevMM;
+}
+
+void MotionBlockSplitter::pointOnLine(float frac, AxisFloats& pt)
+{
+    pt = _endPos;
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        pt._pt[axisIdx] = _startPos._pt[axisIdx] + (_endPos._pt[axisIdx] - _startPos._pt[axisIdx]) * frac;
+}
+
+// Distance in X and Y from the line segment
+float MotionBlockSplitter::distFromLine(AxisFloats& pt)
+{
+    float lineX = _endPos.getVal(0) - _startPos.getVal(0);
+    float lineY = _endPos.getVal(1) - _startPos.getVal(1);
+    float ptX = pt.getVal(0) - _startPos.getVal(0);
+    float ptY = pt.getVal(1) - _startPos.getVal(1);
+    float lenSq = lineX * lineX + lineY * lineY;
+    float t = (lenSq > 0) ? (ptX * lineX + ptY * lineY) / lenSq : 0;
+    t = fmaxf(0, fminf(1, t));
+    return sqrtf(powf(ptX - t * lineX, 2) + powf(ptY - t * lineY, 2));
+}
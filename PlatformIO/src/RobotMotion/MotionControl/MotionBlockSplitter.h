@@ -0,0 +1,61 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include "AxisValues.h"
+#include "../AxesParams.h"
+#include "../AxisPosition.h"
+#include "MotionPlanner.h"
+
+// Splits a straight cartesian move into blocks for robots whose actuators don't move in
+// proportion to cartesian position (e.g. SCARA)
+// Each block is interpolated linearly in actuator space so the path bows away from the line -
+// blocks are made as long as possible while that deviation stays within tolerance
+class MotionBlockSplitter
+{
+public:
+    // Points within each block (evenly spaced in actuator space) checked for deviation
+    static const int NUM_DEVIATION_CHECK_PTS = 3;
+    // Blocks are not split below this length
+    static constexpr float MIN_BLOCK_LEN_MM = 0.1f;
+
+    MotionBlockSplitter();
+    void setTransforms(ptToActuatorFnType ptToActuatorFn, actuatorToPtFnType actuatorToPtFn);
+
+    // Setup to split the line from startPos to endPos
+    void setup(AxisFloats& startPos, AxisFloats& endPos, float toleranceMM, bool allowOutOfBounds);
+
+    // Check if the end of the line has been reached
+    bool isDone()
+    {
+        return _curFrac >= 1;
+    }
+
+    // Get the end of the next block - curPos is the end of the previous block
+    void nextBlockEnd(AxisPosition& curPos, AxesParams& axesParams, AxisFloats& blockEnd);
+
+    // Largest distance (in X and Y) from the line of a block from curPos to blockEnd - measured at
+    // numCheckPts points evenly spaced within the block in actuator space
+    float blockDeviationMM(AxisPosition& curPos, AxisFloats& blockEnd, AxesParams& axesParams,
+                int numCheckPts = NUM_DEVIATION_CHECK_PTS);
+
+private:
+    void pointOnLine(float frac, AxisFloats& pt);
+    float distFromLine(AxisFloats& pt);
+
+    // Transforms
+    ptToActuatorFnType _ptToActuatorFn;
+    actuatorToPtFnType _actuatorToPtFn;
+
+    // Line being split
+    AxisFloats _startPos;
+    AxisFloats _endPos;
+    float _lineLenMM;
+    float _toleranceMM;
+    bool _allowOutOfBounds;
+
+    // Progress along the line and length of the last block (as fractions of the line)
+    float _curFrac;
+    float _lastStepFrac;
+};
@@ -0,0 +1,93 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#include "MotionCoalescer.h"
+#include "math.h"
+
+MotionCoalescer::MotionCoalescer()
+{
+    _toleranceMM = 0;
+    clear();
+}
+
+void MotionCoalescer::configure(float toleranceMM)
+{
+    _toleranceMM = toleranceMM;
+    clear();
+}
+
+void MotionCoalescer::clear()
+{
+    _isPending = false;
+    _canExtend = false;
+    _numPts = 0;
+}
+
+void MotionCoalescer::start(RobotCommandArgs& args, AxisFloats& startPos, AxisFloats& endPos, bool canExtend)
+{
+    _args = args;
+    _startPos = startPos;
+    _endPos = endPos;
+    _numPts = 0;
+    _canExtend = canExtend && canMerge(args);
+    _isPending = true;
+}
+
+bool MotionCoalescer::extend(RobotCommandArgs& args, AxisFloats& endPos, AxesParams& axesParams)
+{
+    // Moves must be compatible
+    if (!_isPending || !canExtend() || !canMerge(args))
+        return false;
+    if ((args.isFeedrateValid() != _args.isFeedrateValid()) ||
+            (args.isFeedrateValid() && (args.getFeedrate() != _args.getFeedrate())))
+        return false;
+    if ((args.getEndstopCheck() != _args.getEndstopCheck()) ||
+            (args.getAllowOutOfBounds() != _args.getAllowOutOfBounds()))
+        return false;
+
+    // Axes which aren't primary must not move
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        if (!axesParams.isPrimaryAxis(axisIdx) && (endPos.getVal(axisIdx) != _endPos.getVal(axisIdx)))
+            return false;
+
+    // All points passed through must be within tolerance of the merged line
+    if (distFromLine(_endPos, endPos, axesParams) > _toleranceMM)
+        return false;
+    for (int ptIdx = 0; ptIdx < _numPts; ptIdx++)
+        if (distFromLine(_pts[ptIdx], endPos, axesParams) > _toleranceMM)
+            return false;
+
+    // Merge
+    _pts[_numPts++] = _endPos;
+    _endPos = endPos;
+    return true;
+}
+
+bool MotionCoalescer::canMerge(RobotCommandArgs& args)
+{
+    return !args.isArc() && !args.isStepwise() && !args.getDontSplitMove() && !args.isExtrudeValid() &&
+            (args.getNumberedCommandIndex() == RobotConsts::NUMBERED_COMMAND_NONE);
+}
+
+// Distance (over the primary axes) from the line between the start and lineEnd - points
+// which are not part way along the line are treated as out of tolerance
+float MotionCoalescer::distFromLine(AxisFloats& pt, AxisFloats& lineEnd, AxesParams& axesParams)
+{
+    float lenSq = 0;
+    float dotProd = 0;
+    float ptLenSq = 0;
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+    {
+        if (!axesParams.isPrimaryAxis(axisIdx))
+            continue;
+        float lineDelta = lineEnd.getVal(axisIdx) - _startPos.getVal(axisIdx);
+        float ptDelta = pt.getVal(axisIdx) - _startPos.getVal(axisIdx);
+        lenSq += lineDelta * lineDelta;
+        dotProd += lineDelta * ptDelta;
+        ptLenSq += ptDelta * ptDelta;
+    }
+    if ((lenSq <= 0) || (dotProd <= 0) || (dotProd >= lenSq))
+        return 1e8;
+    float distSq = ptLenSq - dotProd * dotProd / lenSq;
+    return (distSq > 0) ? sqrtf(distSq) : 0;
+}
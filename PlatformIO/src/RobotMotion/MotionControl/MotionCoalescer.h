@@ -0,0 +1,71 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include "AxisValues.h"
+#include "RobotCommandArgs.h"
+#include "../AxesParams.h"
+
+// Merges runs of nearly collinear moves into a single move
+// The latest move is held back so that following moves can be merged into it - a following move
+// is merged if the points passed through stay within the lateral tolerance of the merged line
+class MotionCoalescer
+{
+public:
+    // Max number of moves merged into one
+    static const int MAX_MOVES_MERGED = 16;
+
+    MotionCoalescer();
+    void configure(float toleranceMM);
+    void clear();
+
+    bool isEnabled()
+    {
+        return _toleranceMM > 0;
+    }
+    bool isPending()
+    {
+        return _isPending;
+    }
+
+    // Hold back a move - if canExtend is false the move is never merged with following moves
+    void start(RobotCommandArgs& args, AxisFloats& startPos, AxisFloats& endPos, bool canExtend);
+
+    // Merge a following move into the held back move if possible
+    bool extend(RobotCommandArgs& args, AxisFloats& endPos, AxesParams& axesParams);
+
+    // Check if a move could ever be merged
+    static bool canMerge(RobotCommandArgs& args);
+
+    // Held back move
+    RobotCommandArgs& getArgs()
+    {
+        return _args;
+    }
+    AxisFloats& getEndPos()
+    {
+        return _endPos;
+    }
+    bool canExtend()
+    {
+        return _canExtend && (_numPts < MAX_MOVES_MERGED - 1);
+    }
+    int getNumMerged()
+    {
+        return _numPts + 1;
+    }
+
+private:
+    float distFromLine(AxisFloats& pt, AxisFloats& lineEnd, AxesParams& axesParams);
+
+    float _toleranceMM;
+    bool _isPending;
+    bool _canExtend;
+    RobotCommandArgs _args;
+    AxisFloats _startPos;
+    AxisFloats _endPos;
+    // Ends of the moves merged so far (excluding the last)
+    AxisFloats _pts[MAX_MOVES_MERGED - 1];
+    int _numPts;
+};
@@ -6,6 +6,7 @@
 #include "MotionHelper.h"
 #include "Utils.h"
 #include "AxisValues.h"
+#include "JsonDocumentView.h"
 
 // #define MOTION_LOG_DEBUG 1
 // #define DEBUG_MOTION_HELPER 1
@@ -21,6 +22,9 @@ MotionHelper::MotionHelper() :
     _isPaused = false;
     _moveRelative = false;
     _blockDistanceMM = 0;
+    _arcChordToleranceMM = arcChordToleranceMM_default;
+    _pathBlendToleranceMM = pathBlendToleranceMM_default;
+    _blockDeviationMM = blockDeviationMM_default;
     _allowAllOutOfBounds = false;
     // Clear axis current location
     _lastCommandedAxisPos.clear();
@@ -32,6 +36,10 @@ MotionHelper::MotionHelper() :
     _correctStepOverflowFn = NULL;
     // Handling of splitting-up of motion into smaller blocks
     _blocksToAddTotal = 0;    
+    _homingDeferred = false;
+    _blocksToAddIsArc = false;
+    _blocksToAddAdaptive = false;
+    _blocksToAddBlend = false;
     // Init callbacks
     _ptToActuatorFn = nullptr;
     _actuatorToPtFn = nullptr;
@@ -59,6 +67,7 @@ void MotionHelper::setTransforms(ptToActuatorFnType ptToActuatorFn, actuatorToPt
     _correctStepOverflowFn = correctStepOverflowFn;
     _convertCoordsFn = convertCoordsFn;
     _setRobotAttributes = setRobotAttributes;
+    _blockSplitter.setTransforms(ptToActuatorFn, actuatorToPtFn);
 }
 
 // Configure the robot and pipeline parameters using a JSON input string
@@ -70,20 +79,30 @@ void MotionHelper::configure(const char *robotConfigJSON)
     
     // Config geometry
     String robotGeom = RdJson::getString("robotGeom", "NONE", robotConfigJSON);
+    JsonDocumentView geomDoc(robotGeom.c_str());
 
     // Config settings
-    int pipelineLen = int(RdJson::getLong("pipelineLen", pipelineLen_default, robotGeom.c_str()));
-    _blockDistanceMM = float(RdJson::getDouble("blockDistanceMM", blockDistanceMM_default, robotGeom.c_str()));
-    _allowAllOutOfBounds = bool(RdJson::getLong("allowOutOfBounds", false, robotGeom.c_str()));
-    float junctionDeviation = float(RdJson::getDouble("junctionDeviation", junctionDeviation_default, robotGeom.c_str()));
-    Log.notice("%sconfigMotionPipeline len %d, blockDistMM %F (0=no-max), allowOoB %s, jnDev %F\n", MODULE_PREFIX,
-               pipelineLen, _blockDistanceMM, _allowAllOutOfBounds ? "Y" : "N", junctionDeviation);
+    int pipelineLen = int(geomDoc.getLong("pipelineLen", pipelineLen_default));
+    _blockDistanceMM = float(geomDoc.getDouble("blockDistanceMM", blockDistanceMM_default));
+    _allowAllOutOfBounds = bool(geomDoc.getLong("allowOutOfBounds", false));
+    float junctionDeviation = float(geomDoc.getDouble("junctionDeviation", junctionDeviation_default));
+    _arcChordToleranceMM = float(geomDoc.getDouble("arcChordToleranceMM", arcChordToleranceMM_default));
+    _blockDeviationMM = float(geomDoc.getDouble("blockDeviationMM", blockDeviationMM_default));
+    float coalesceToleranceMM = float(geomDoc.getDouble("coalesceToleranceMM", coalesceToleranceMM_default));
+    _pathBlendToleranceMM = float(geomDoc.getDouble("pathBlendToleranceMM", pathBlendToleranceMM_default));
+    bool perStepAccel = bool(geomDoc.getLong("perStepAccel", false));
+    bool scheduledStepping = bool(geomDoc.getLong("scheduledStepping", false));
+    int stepEventQueueLen = int(geomDoc.getLong("stepEventQueueLen", 0));
+    Log.notice("%sconfigMotionPipeline len %d, blockDistMM %F (0=no-max), blockDevMM %F (0=off), allowOoB %s, jnDev %F, arcTolMM %F, blendTolMM %F, coalesceTolMM %F (0=off), perStepAcc %s, schedStep %s, stepQLen %d\n", MODULE_PREFIX,
+               pipelineLen, _blockDistanceMM, _blockDeviationMM, _allowAllOutOfBounds ? "Y" : "N", junctionDeviation, _arcChordToleranceMM, _pathBlendToleranceMM, coalesceToleranceMM, perStepAccel ? "Y" : "N",
+               scheduledStepping ? "Y" : "N", stepEventQueueLen);
 
     // Pipeline length and block size
     _motionPipeline.init(pipelineLen);
 
     // Motion Pipeline and Planner
     _motionPlanner.configure(junctionDeviation);
+    _moveCoalescer.configure(coalesceToleranceMM);
 
     // Clean up previous
     _trinamicsController.deinit();
@@ -118,6 +137,9 @@ void MotionHelper::configure(const char *robotConfigJSON)
     _motorEnabler.configure(robotGeom.c_str());
 
     // Start motion actuator
+    _rampGenerator.setPerStepAccel(perStepAccel);
+    _rampGenerator.setScheduledStepping(scheduledStepping);
+    _rampGenerator.setStepEventQueueLen(stepEventQueueLen);
     _rampGenerator.configure(!_trinamicsController.isRampGenerator());
 
     // Clear motion info
@@ -132,6 +154,10 @@ bool MotionHelper::canAccept()
     // Check if homing in progress
     if (_motionHoming.isHomingInProgress())
         return false;
+    // A held back move which can't be extended or blended (or homing held back behind moves) must be
+    // added before anything else
+    if ((_moveCoalescer.isPending() && !canPendingMoveTakeNext()) || _homingDeferred)
+        return false;
     // Check that the motion pipeline can accept new data
     return (_blocksToAddTotal == 0) && _motionPipeline.canAccept();
 }
@@ -154,6 +180,9 @@ bool MotionHelper::isPaused()
 void MotionHelper::stop()
 {
     _blocksToAddTotal = 0;
+    _blocksToAddBlend = false;
+    _moveCoalescer.clear();
+    _homingDeferred = false;
     _stopRequested = true;
     _stopRequestTimeMs = millis();
     _rampGenerator.stop();
@@ -166,7 +195,7 @@ void MotionHelper::stop()
 // Check if idle
 bool MotionHelper::isIdle()
 {
-    return !_motionPipeline.canGet();
+    return !_moveCoalescer.isPending() && !_motionPipeline.canGet() && !_rampGenerator.stepEventsPending();
 }
 
 void MotionHelper::setCurPosActualPosition()
@@ -229,7 +258,7 @@ void MotionHelper::getCurStatus(RobotCommandArgs &args)
     args.setIsHoming(_motionHoming.isHomingInProgress());
     args.setHasHomed(_motionHoming.isHomedOk());
     // Queue length
-    args.setNumQueued(_motionPipeline.count());
+    args.setNumQueued(_motionPipeline.count() + (_moveCoalescer.isPending() ? 1 : 0));
 }
 
 // Get attributes of robot
@@ -241,6 +270,14 @@ void MotionHelper::getRobotAttributes(String& robotAttrs)
 // Command the robot to home one or more axes
 void MotionHelper::goHome(RobotCommandArgs &args)
 {
+    // Moves before homing must be added first - if blocks are still being added homing is
+    // held back until they have been
+    if (!flushPendingMove() || (_blocksToAddTotal != 0))
+    {
+        _homingDeferred = true;
+        _homingDeferredArgs = args;
+        return;
+    }
     _motionHoming.homingStart(args);
 }
 
@@ -250,6 +287,15 @@ bool MotionHelper::moveTo(RobotCommandArgs &args)
     // Handle stepwise motion
     if (args.isStepwise())
     {
+        // Moves before this one must be added first - if blocks are still being added this
+        // move is held back (and can't be extended) until they have been
+        if (!flushPendingMove())
+            return false;
+        if (_blocksToAddTotal != 0)
+        {
+            _moveCoalescer.start(args, _lastCommandedAxisPos._axisPositionMM, _lastCommandedAxisPos._axisPositionMM, false);
+            return true;
+        }
         return _motionPlanner.moveToStepwise(args, _lastCommandedAxisPos, _axesParams, _motionPipeline);
     }
     // Convert coordinates if required
@@ -258,14 +304,14 @@ bool MotionHelper::moveTo(RobotCommandArgs &args)
         _convertCoordsFn(args, _axesParams);
     // Fill in the destPos for axes for which values not specified
     // Handle relative motion override if present
-    // Don't use servo values for computing distance to travel
+    // A move held back for coalescing is the previous position
+    AxisFloats prevPos = _moveCoalescer.isPending() ? _moveCoalescer.getEndPos() : _lastCommandedAxisPos._axisPositionMM;
     AxisFloats destPos = args.getPointMM();
-    bool includeDist[RobotConsts::MAX_AXES];
     for (int i = 0; i < RobotConsts::MAX_AXES; i++)
     {
         if (!args.isValid(i))
         {
-            destPos.setVal(i, _lastCommandedAxisPos._axisPositionMM.getVal(i));
+            destPos.setVal(i, prevPos.getVal(i));
 #ifdef DEBUG_MOTION_HELPER
             Log.notice("%smoveTo ax %d, pos %F NoMovementOnThisAxis\n", MODULE_PREFIX, 
                     i, 
@@ -280,7 +326,7 @@ bool MotionHelper::moveTo(RobotCommandArgs &args)
             if (args.getMoveType() != RobotMoveTypeArg_None)
                 moveRelative = (args.getMoveType() == RobotMoveTypeArg_Relative);
             if (moveRelative)
-                destPos.setVal(i, _lastCommandedAxisPos._axisPositionMM.getVal(i) + args.getValMM(i));
+                destPos.setVal(i, prevPos.getVal(i) + args.getValMM(i));
 #ifdef DEBUG_MOTION_HELPER
             Log.notice("%smoveTo ax %d, pos %F relative %s\n", MODULE_PREFIX, 
                     i, 
@@ -288,18 +334,126 @@ bool MotionHelper::moveTo(RobotCommandArgs &args)
                     moveRelative ? "Y" : "N");
 #endif
         }
-        includeDist[i] = _axesParams.isPrimaryAxis(i);
     }
 
+    // Merge with the held back move if nearly collinear - otherwise the held back move is
+    // added (with its corner rounded into this move if blending)
+    if (_moveCoalescer.extend(args, destPos, _axesParams))
+        return true;
+    if (!flushPendingMove(&args, &destPos))
+        return false;
+
+    // Moves are held back for coalescing or for blending into the next move - others are split
+    // into blocks straight away unless blocks of the previous move are still being added
+    bool holdBack = MotionCoalescer::canMerge(args) && (_moveCoalescer.isEnabled() || (getBlendToleranceMM(args) > 0));
+    if (!holdBack && (_blocksToAddTotal == 0))
+        return blocksToAddSetup(args, destPos);
+    _moveCoalescer.start(args, prevPos, destPos, _moveCoalescer.isEnabled());
+
+    // Process anything that can be done immediately
+    blocksToAddProcess();
+    return true;
+}
+
+// Add the move held back for coalescing (if any) - returns false if blocks from a previous
+// move are still being added (or there is no space in the pipeline for a stepwise move)
+// If the next move is given the corner between the moves is rounded when blending
+bool MotionHelper::flushPendingMove(RobotCommandArgs *pNextArgs, AxisFloats *pNextPos)
+{
+    if (!_moveCoalescer.isPending())
+        return true;
+    if (_blocksToAddTotal != 0)
+        return false;
+#ifdef DEBUG_MOTION_HELPER
+    Log.trace("%sflushPendingMove merged %d\n", MODULE_PREFIX, _moveCoalescer.getNumMerged());
+#endif
+    AxisFloats destPos = _moveCoalescer.getEndPos();
+    RobotCommandArgs args = _moveCoalescer.getArgs();
+    if (args.isStepwise())
+    {
+        if (!_motionPipeline.canAccept())
+            return false;
+        _moveCoalescer.clear();
+        _motionPlanner.moveToStepwise(args, _lastCommandedAxisPos, _axesParams, _motionPipeline);
+        return true;
+    }
+    _moveCoalescer.clear();
+
+    // The move is shortened to the start of the arc which rounds the corner
+    AxisFloats lineEndPos = destPos;
+    bool blend = pNextArgs && pNextPos && MotionCoalescer::canMerge(*pNextArgs) &&
+            (pNextArgs->getEndstopCheck() == args.getEndstopCheck()) &&
+            (pNextArgs->getAllowOutOfBounds() == args.getAllowOutOfBounds()) &&
+            _blocksToAddArc.setupCornerBlend(_lastCommandedAxisPos._axisPositionMM, destPos, *pNextPos,
+                        getBlendToleranceMM(args), lineEndPos);
+    blocksToAddSetup(args, lineEndPos, blend);
+    return true;
+}
+
+// Tolerance within which the corner at the end of a move is rounded (0 for an exact corner)
+float MotionHelper::getBlendToleranceMM(RobotCommandArgs &args)
+{
+    if (!args.isPathBlendValid() || (args.getPathBlendTolerance() < 0))
+        return _pathBlendToleranceMM;
+    return args.getPathBlendTolerance();
+}
+
+// Check if the held back move is waiting for a following move to merge with or blend into
+bool MotionHelper::canPendingMoveTakeNext()
+{
+    if (!_moveCoalescer.isPending())
+        return false;
+    return _moveCoalescer.canExtend() ||
+            (MotionCoalescer::canMerge(_moveCoalescer.getArgs()) && (getBlendToleranceMM(_moveCoalescer.getArgs()) > 0));
+}
+
+// Setup splitting of a move into blocks
+bool MotionHelper::blocksToAddSetup(RobotCommandArgs &args, AxisFloats &destPos, bool blendFollows)
+{
+    // Don't use servo values for computing distance to travel
+    bool includeDist[RobotConsts::MAX_AXES];
+    for (int i = 0; i < RobotConsts::MAX_AXES; i++)
+        includeDist[i] = _axesParams.isPrimaryAxis(i);
+
     // Split up into blocks of maximum length
     double lineLen = destPos.distanceTo(_lastCommandedAxisPos._axisPositionMM, includeDist);
+    float maxBlockDistMM = (_blockDistanceMM > 0.01f && !args.getDontSplitMove()) ? _blockDistanceMM : 0;
 
     // Ensure at least one block
     int numBlocks = 1;
-    if (_blockDistanceMM > 0.01f && !args.getDontSplitMove())
-        numBlocks = int(ceil(lineLen / _blockDistanceMM));
+    if (maxBlockDistMM > 0)
+        numBlocks = int(ceil(lineLen / maxBlockDistMM));
     if (numBlocks == 0)
         numBlocks = 1;
+
+    // Arcs are split into enough blocks to stay within the chord tolerance
+    _blocksToAddIsArc = args.isArc();
+    if (_blocksToAddIsArc)
+    {
+        bool arcOk = false;
+        if (args.isArcCentreValid())
+            arcOk = _blocksToAddArc.setupFromCentre(_lastCommandedAxisPos._axisPositionMM, destPos,
+                        args.getArcCentreOffset(0), args.getArcCentreOffset(1), args.getMoveClockwise());
+        else if (args.isArcRadiusValid())
+            arcOk = _blocksToAddArc.setupFromRadius(_lastCommandedAxisPos._axisPositionMM, destPos,
+                        args.getArcRadius(), args.getMoveClockwise());
+        if (!arcOk)
+        {
+            Log.notice("%smoveTo arc invalid\n", MODULE_PREFIX);
+            _blocksToAddIsArc = false;
+            return false;
+        }
+        numBlocks = _blocksToAddArc.getNumSegments(_arcChordToleranceMM, maxBlockDistMM);
+    }
+
+    // Lines can be split according to how far the actuator path deviates from them
+    _blocksToAddAdaptive = !_blocksToAddIsArc && (_blockDeviationMM > 0) && !args.getDontSplitMove();
+    if (_blocksToAddAdaptive)
+    {
+        _blockSplitter.setup(_lastCommandedAxisPos._axisPositionMM, destPos, _blockDeviationMM,
+                    args.getAllowOutOfBounds() || _allowAllOutOfBounds);
+        numBlocks = 1;
+    }
 #ifdef DEBUG_MOTION_HELPER
     Log.trace("%smoveTo curX %F(%d) curY %F(%d) curZ %F(%d) newX %F newY %F newZ %F numBlocks %d (lineLen %F / blockDistMM %F)\n", MODULE_PREFIX,
                 _lastCommandedAxisPos._axisPositionMM.getVal(0),
@@ -323,6 +477,7 @@ bool MotionHelper::moveTo(RobotCommandArgs &args)
     _blocksToAddEndPos = destPos;
     _blocksToAddCurBlock = 0;
     _blocksToAddTotal = numBlocks;
+    _blocksToAddBlend = blendFollows;
 
     // Process anything that can be done immediately
     blocksToAddProcess();
@@ -341,18 +496,46 @@ void MotionHelper::blocksToAddProcess()
             return;
 
         // Add to pipeline any blocks that are waiting to be expanded out
-        AxisFloats nextBlockDest = _blocksToAddStartPos + _blocksToAddDelta * float(_blocksToAddCurBlock + 1);
+        AxisFloats nextBlockDest;
+        if (_blocksToAddAdaptive)
+        {
+            // Number of blocks isn't known in advance
+            _blockSplitter.nextBlockEnd(_lastCommandedAxisPos, _axesParams, nextBlockDest);
+            _blocksToAddCurBlock++;
+            if (_blockSplitter.isDone())
+                _blocksToAddTotal = 0;
+        }
+        else
+        {
+            nextBlockDest = _blocksToAddStartPos + _blocksToAddDelta * float(_blocksToAddCurBlock + 1);
 
-        // If last block then just use end point coords
-        if (_blocksToAddCurBlock + 1 >= _blocksToAddTotal)
-            nextBlockDest = _blocksToAddEndPos;
+            // If last block then just use end point coords
+            if (_blocksToAddCurBlock + 1 >= _blocksToAddTotal)
+                nextBlockDest = _blocksToAddEndPos;
+            else if (_blocksToAddIsArc)
+                _blocksToAddArc.getSegmentEnd(_blocksToAddCurBlock, _blocksToAddTotal, nextBlockDest);
 
-        // Bump position
-        _blocksToAddCurBlock++;
+            // Bump position
+            _blocksToAddCurBlock++;
 
-        // Check if done
-        if (_blocksToAddCurBlock >= _blocksToAddTotal)
-            _blocksToAddTotal = 0;
+            // Check if done
+            if (_blocksToAddCurBlock >= _blocksToAddTotal)
+                _blocksToAddTotal = 0;
+        }
+
+        // The arc rounding the corner with the next move follows on from the last block
+        if ((_blocksToAddTotal == 0) && _blocksToAddBlend)
+        {
+            _blocksToAddBlend = false;
+            _blocksToAddIsArc = true;
+            _blocksToAddAdaptive = false;
+            _blocksToAddStartPos = nextBlockDest;
+            _blocksToAddEndPos = _blocksToAddArc.getEndPos();
+            _blocksToAddTotal = _blocksToAddArc.getNumSegments(_arcChordToleranceMM,
+                        _blockDistanceMM > 0.01f ? _blockDistanceMM : 0);
+            _blocksToAddDelta = (_blocksToAddEndPos - _blocksToAddStartPos) / float(_blocksToAddTotal);
+            _blocksToAddCurBlock = 0;
+        }
 
         // Prepare add to planner
         _blocksToAddCommandArgs.setPointMM(nextBlockDest);
@@ -427,6 +610,9 @@ void MotionHelper::service()
         if (Utils::isTimeout(millis(), _stopRequestTimeMs, MAX_TIME_BEFORE_STOP_COMPLETE_MS))
         {
             _blocksToAddTotal = 0;
+            _blocksToAddBlend = false;
+            _moveCoalescer.clear();
+            _homingDeferred = false;
             _rampGenerator.stop();
             _trinamicsController.stop();
             _motionPipeline.clear();
@@ -446,6 +632,22 @@ void MotionHelper::service()
     // Process any split-up blocks to be added to the pipeline
     blocksToAddProcess();
 
+    // Add a move held back for coalescing or blending if it can't take a following move, the pipeline
+    // is running low or homing is waiting for it
+    if (_moveCoalescer.isPending() && (_blocksToAddTotal == 0) &&
+            (!canPendingMoveTakeNext() || _homingDeferred || (_motionPipeline.count() < COALESCE_FLUSH_BELOW_BLOCKS)))
+    {
+        flushPendingMove();
+        blocksToAddProcess();
+    }
+
+    // Start homing held back until moves before it were added
+    if (_homingDeferred && !_moveCoalescer.isPending() && (_blocksToAddTotal == 0))
+    {
+        _homingDeferred = false;
+        _motionHoming.homingStart(_homingDeferredArgs);
+    }
+
     // Service homing
     _motionHoming.service(_axesParams);
 
@@ -11,21 +11,36 @@
 #include "MotionHoming.h"
 #include "Trinamics/TrinamicsController.h"
 #include "MotorEnabler.h"
+#include "MotionArc.h"
+#include "MotionBlockSplitter.h"
+#include "MotionCoalescer.h"
 
 class MotionHelper
 {
 public:
     static constexpr float blockDistanceMM_default = 0.0f;
     static constexpr float junctionDeviation_default = 0.05f;
+    static constexpr float arcChordToleranceMM_default = 0.01f;
+    static constexpr float blockDeviationMM_default = 0.0f;
+    static constexpr float pathBlendToleranceMM_default = 0.0f;
+    static constexpr float coalesceToleranceMM_default = 0.0f;
     static constexpr float distToTravelMM_ignoreBelow = 0.01f;
     static constexpr int pipelineLen_default = 100;
     static constexpr uint32_t MAX_TIME_BEFORE_STOP_COMPLETE_MS = 500;
+    // A move held back for coalescing is added when the pipeline has fewer blocks than this
+    static const int COALESCE_FLUSH_BELOW_BLOCKS = 3;
 
 private:
     // Pause
     bool _isPaused;
     // Block distance
     float _blockDistanceMM;
+    // Maximum distance between an arc and the straight segments that make it up
+    float _arcChordToleranceMM;
+    // Maximum distance of the actuator path from a straight line (0 = split by _blockDistanceMM)
+    float _blockDeviationMM;
+    // Tolerance for rounding the corners between moves which don't set one (and for G64 without P)
+    float _pathBlendToleranceMM;
     // Allow all out of bounds movement
     bool _allowAllOutOfBounds;
     // Axes parameters
@@ -68,6 +83,21 @@ private:
     AxisFloats _blocksToAddDelta;
     // Command args for block generation
     RobotCommandArgs _blocksToAddCommandArgs;
+    // Arc for block generation (blocks follow the arc rather than the straight line)
+    bool _blocksToAddIsArc;
+    MotionArc _blocksToAddArc;
+    // Adaptive block generation (block lengths depend on the kinematics)
+    bool _blocksToAddAdaptive;
+    MotionBlockSplitter _blockSplitter;
+    // Arc rounding the corner with the next move (set up in _blocksToAddArc) is added after the blocks
+    bool _blocksToAddBlend;
+
+    // Coalescing of nearly collinear moves before they are split into blocks
+    MotionCoalescer _moveCoalescer;
+
+    // Homing requested while blocks of earlier moves were still being added
+    bool _homingDeferred;
+    RobotCommandArgs _homingDeferredArgs;
 
     // Handling of stop
     bool _stopRequested;
@@ -157,6 +187,10 @@ public:
     {
         return &_motionHoming;
     }
+    MotionPipeline* testGetMotionPipeline()
+    {
+        return &_motionPipeline;
+    }
 #endif
 
 private:
@@ -167,4 +201,8 @@ private:
     void setCurPosActualPosition();
     bool addToPlanner(RobotCommandArgs &args);
     void blocksToAddProcess();
+    bool blocksToAddSetup(RobotCommandArgs &args, AxisFloats &destPos, bool blendFollows = false);
+    bool flushPendingMove(RobotCommandArgs *pNextArgs = NULL, AxisFloats *pNextPos = NULL);
+    float getBlendToleranceMM(RobotCommandArgs &args);
+    bool canPendingMoveTakeNext();
 };
@@ -6,28 +6,51 @@
 #include "MotionRingBuffer.h"
 #include "MotionBlock.h"
 #include <vector>
+#include <atomic>
 
+// Pipeline of motion blocks - the planner (main loop) adds and replans blocks and the ramp generator
+// (ISR or a task on the other core) executes and removes them
+// Blocks are handed over explicitly:
+//    [get, commit) - committed to the ramp generator and never changed by the planner again
+//    [commit, ready) - prepared for stepping and available to the ramp generator
+//    [ready, put) - being planned
+// The ramp generator commits a block by moving the commit position but backs out if the planner is
+// busy changing that block at the time - a planning pass only changes blocks from its plan position
+// on (the planned-up-to watermark) so blocks before that stay available while the planner is busy
 class MotionPipeline
 {
   private:
     MotionRingBufferPosn _pipelinePosn;
     std::vector<MotionBlock> _pipeline;
+    std::atomic<unsigned int> _commitPos;
+    std::atomic<unsigned int> _readyPos;
+    std::atomic<bool> _plannerBusy;
+    std::atomic<unsigned int> _planFromPos;
 
   public:
     MotionPipeline() : _pipelinePosn(0)
     {
+        _commitPos = 0;
+        _readyPos = 0;
+        _plannerBusy = false;
+        _planFromPos = 0;
     }
 
     void init(int pipelineSize)
     {
         _pipeline.resize(pipelineSize);
         _pipelinePosn.init(pipelineSize);
+        clear();
     }
 
-    // Clear the pipeline
+    // Clear the pipeline - only valid when the ramp generator isn't running
     void clear()
     {
         _pipelinePosn.clear();
+        _commitPos.store(0, std::memory_order_relaxed);
+        _readyPos.store(0, std::memory_order_relaxed);
+        _planFromPos.store(0, std::memory_order_relaxed);
+        _plannerBusy.store(false, std::memory_order_release);
     }
 
     unsigned int count()
@@ -49,7 +72,7 @@ class MotionPipeline
             return false;
 
         // Add the item
-        _pipeline[_pipelinePosn._putPos] = block;
+        _pipeline[_pipelinePosn.posToPut()] = block;
         _pipelinePosn.hasPut();
         return true;
     }
@@ -68,12 +91,12 @@ class MotionPipeline
             return false;
 
         // read the item and remove
-        block = _pipeline[_pipelinePosn._getPos];
+        block = _pipeline[_pipelinePosn.posToGet()];
         _pipelinePosn.hasGot();
         return true;
     }
 
-    // Remove last element from queue
+    // Remove last element from queue - this must have been committed with peekGetCommitted()
     bool IRAM_ATTR remove()
     {
         // Check if queue is empty
@@ -86,13 +109,92 @@ class MotionPipeline
     }
 
     // Peek the block which would be got (if there is one)
+    // The block may still be changed by the planner unless it has been committed
     MotionBlock* IRAM_ATTR peekGet()
     {
         // Check if queue is empty
         if (!_pipelinePosn.canGet())
             return NULL;
         // get pointer to the last item (don't remove)
-        return &(_pipeline[_pipelinePosn._getPos]);
+        return &(_pipeline[_pipelinePosn.posToGet()]);
+    }
+
+    // Check if the block which would be got has been committed to the ramp generator
+    bool IRAM_ATTR isGetCommitted()
+    {
+        return _commitPos.load(std::memory_order_relaxed) != _pipelinePosn.posToGet();
+    }
+
+    // Peek the block which would be got, committing it to the ramp generator if it wasn't already
+    // Returns NULL if there is no block ready or if the planner is busy changing it
+    MotionBlock* IRAM_ATTR peekGetCommitted()
+    {
+        unsigned int getPos = _pipelinePosn.posToGet();
+        unsigned int commitPos = _commitPos.load(std::memory_order_relaxed);
+        if (commitPos != getPos)
+            return &(_pipeline[getPos]);
+
+        // Check the block is ready - acquire so that the prepared block is visible
+        if (_readyPos.load(std::memory_order_acquire) == getPos)
+            return NULL;
+
+        // Commit then check the planner isn't part way through changing blocks - if it is then
+        // back out and try again later
+        unsigned int newCommitPos = getPos + 1;
+        if (newCommitPos >= _pipelinePosn._bufLen)
+            newCommitPos = 0;
+        _commitPos.store(newCommitPos, std::memory_order_seq_cst);
+        if (_plannerBusy.load(std::memory_order_seq_cst) && !isBeforePlanFrom(getPos))
+        {
+            _commitPos.store(commitPos, std::memory_order_release);
+            return NULL;
+        }
+        return &(_pipeline[getPos]);
+    }
+
+    // Start changing blocks - maxBlocksToChange is the number of blocks (counting back from the put position)
+    // which the planner may change - blocks before those can still be committed by the ramp generator
+    // Returns the number of blocks (counting back from the put position) which haven't been committed
+    // and can be changed until endPlanning() is called
+    unsigned int beginPlanning(unsigned int maxBlocksToChange)
+    {
+        unsigned int putPos = _pipelinePosn.posToPut();
+        unsigned int planFromPos = _pipelinePosn.posToGet();
+        if (maxBlocksToChange < _pipelinePosn.count())
+            planFromPos = (putPos >= maxBlocksToChange) ? putPos - maxBlocksToChange :
+                                    _pipelinePosn._bufLen + putPos - maxBlocksToChange;
+        _planFromPos.store(planFromPos, std::memory_order_seq_cst);
+        _plannerBusy.store(true, std::memory_order_seq_cst);
+        unsigned int commitPos = _commitPos.load(std::memory_order_seq_cst);
+        if (commitPos <= putPos)
+            return putPos - commitPos;
+        return _pipelinePosn._bufLen - commitPos + putPos;
+    }
+
+    // Finish changing blocks and make those that can execute available to the ramp generator
+    void endPlanning()
+    {
+        // The ramp generator can't commit while the planner is busy
+        unsigned int readyPos = _commitPos.load(std::memory_order_acquire);
+        unsigned int putPos = _pipelinePosn.posToPut();
+        while ((readyPos != putPos) && _pipeline[readyPos]._canExecute)
+        {
+            readyPos++;
+            if (readyPos >= _pipelinePosn._bufLen)
+                readyPos = 0;
+        }
+        _readyPos.store(readyPos, std::memory_order_release);
+        _plannerBusy.store(false, std::memory_order_release);
+    }
+
+    // Check if a position is before the first block the planner may be changing
+    bool IRAM_ATTR isBeforePlanFrom(unsigned int pos)
+    {
+        unsigned int planFromPos = _planFromPos.load(std::memory_order_seq_cst);
+        unsigned int putPos = _pipelinePosn._putPos.load(std::memory_order_acquire);
+        unsigned int toPlanFrom = (planFromPos >= pos) ? planFromPos - pos : _pipelinePosn._bufLen - pos + planFromPos;
+        unsigned int toPut = (putPos >= pos) ? putPos - pos : _pipelinePosn._bufLen - pos + putPos;
+        return (toPlanFrom > 0) && (toPlanFrom <= toPut);
     }
 
     // Peek from the put position
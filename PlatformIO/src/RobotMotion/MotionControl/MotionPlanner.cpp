@@ -112,17 +112,25 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
     if (!hasSteps)
         return false;
 
+    // Limit the feedrate and acceleration so that no actuator exceeds its limits - for non-cartesian
+    // robots the ratio of actuator steps to distance moved (the Jacobian) varies from block to block
+    applyActuatorLimits(block, moveDist, axesParams);
+
     // Set the dist moved on the axis with max steps
     block._unitVecAxisWithMaxDist = unitVectors.getVal(axisWithMaxMoveDist);
 
     // If there is a prior block then compute the maximum speed at exit of the second block to keep
     // the junction deviation within bounds - there are more comments in the Smoothieware (and GRBL) code
+    // S-curve (jerk limited) blocks start and end with zero acceleration so the same limit applies
     float junctionDeviation = _junctionDeviation;
     float vmaxJunction = _minimumPlannerSpeedMMps;
 
-    // Invalidate the data stored for the prev element if the pipeline becomes empty
+    // Invalidate the data stored for the prev element (and the planned watermark) if the pipeline becomes empty
     if (!motionPipeline.canGet())
+    {
         _prevMotionBlockValid = false;
+        _plannedUpToIdxFromPut = -1;
+    }
 
     // Calculate the maximum speed for the junction between two blocks
     if (isAPrimaryMove && _prevMotionBlockValid)
@@ -132,7 +140,9 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
         {
             // Compute cosine of angle between previous and current path. (prev_unit_vec is negative)
             // NOTE: Max junction velocity is computed without sin() or acos() by trig half angle identity.
-            float cosTheta = -_prevMotionBlock._unitVectors.X() * unitVectors.X() - _prevMotionBlock._unitVectors.Y() * unitVectors.Y() - _prevMotionBlock._unitVectors.Z() * unitVectors.Z();
+            float cosTheta = 0;
+            for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+                cosTheta -= _prevMotionBlock._unitVectors._pt[axisIdx] * unitVectors._pt[axisIdx];
 
             // Skip and use default max junction speed for 0 degree acute junction.
             if (cosTheta < 0.95F)
@@ -144,8 +154,10 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
                     // Compute maximum junction velocity based on maximum acceleration and junction deviation
                     // Trig half angle identity, always positive
                     float sinThetaD2 = sqrtf(0.5F * (1.0F - cosTheta));
+                    float junctionAccMMps2 = block.capToActuatorAcc(
+                                junctionAcceleration(_prevMotionBlock._unitVectors, unitVectors, axesParams));
                     vmaxJunction = fminf(vmaxJunction,
-                                            sqrtf(axesParams._masterAxisMaxAccMMps2 * junctionDeviation * sinThetaD2 /
+                                            sqrtf(junctionAccMMps2 * junctionDeviation * sinThetaD2 /
                                                 (1.0F - sinThetaD2)));
                 }
             }
@@ -160,13 +172,15 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
 
     // Add the element to the pipeline and remember previous element
     motionPipeline.add(block);
+    if (_plannedUpToIdxFromPut >= 0)
+        _plannedUpToIdxFromPut++;
     MotionBlockSequentialData prevBlockInfo;
     prevBlockInfo._maxParamSpeedMMps = block._feedrate;
     prevBlockInfo._unitVectors = unitVectors;
     _prevMotionBlock = prevBlockInfo;
     _prevMotionBlockValid = true;
 
-    // Recalculate the whole queue
+    // Recalculate the part of the queue that can still change
     recalculatePipeline(motionPipeline, axesParams);
 
     // Return the change in actuator position
@@ -177,6 +191,65 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
     return true;
 }
 
+// Acceleration available at a junction - the change in direction is treated as an acceleration
+// along the difference of the unit vectors and limited so that no axis exceeds its own max acceleration
+float MotionPlanner::junctionAcceleration(AxisFloats &prevUnitVectors, AxisFloats &unitVectors, AxesParams &axesParams)
+{
+    // Length of the junction vector
+    float junctionVecLenSq = 0;
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+    {
+        float delta = unitVectors._pt[axisIdx] - prevUnitVectors._pt[axisIdx];
+        junctionVecLenSq += delta * delta;
+    }
+    if (junctionVecLenSq <= 0)
+        return axesParams._masterAxisMaxAccMMps2;
+    float junctionVecLen = sqrtf(junctionVecLenSq);
+
+    // Limit by each axis with a component in the junction vector
+    float junctionAccMMps2 = 1e8;
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+    {
+        float component = fabsf(unitVectors._pt[axisIdx] - prevUnitVectors._pt[axisIdx]) / junctionVecLen;
+        if (component > 1E-6f)
+            junctionAccMMps2 = fminf(junctionAccMMps2, axesParams.getMaxAccel(axisIdx) / component);
+    }
+    return junctionAccMMps2;
+}
+
+void MotionPlanner::applyActuatorLimits(MotionBlock &block, float moveDist, AxesParams &axesParams)
+{
+    block._actuatorMaxAccMMps2 = 0;
+    if (moveDist <= 0)
+        return;
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+    {
+        int32_t absSteps = block.getAbsStepsToTarget(axisIdx);
+        if (absSteps == 0)
+            continue;
+        // Steps on this actuator per mm of cartesian travel in this block
+        float stepsPerMM = absSteps / moveDist;
+
+        // Feedrate at which this actuator reaches its max step rate
+        float maxStepRate = axesParams.getMaxStepRatePerSec(axisIdx);
+        if ((maxStepRate > 0) && (block._feedrate > maxStepRate / stepsPerMM))
+            block._feedrate = maxStepRate / stepsPerMM;
+
+        // Acceleration at which this actuator reaches its max step acceleration
+        float maxStepAccel = axesParams.getMaxStepAccel(axisIdx);
+        if (maxStepAccel > 0)
+        {
+            float maxAccMMps2 = maxStepAccel / stepsPerMM;
+            if ((block._actuatorMaxAccMMps2 <= 0) || (maxAccMMps2 < block._actuatorMaxAccMMps2))
+                block._actuatorMaxAccMMps2 = maxAccMMps2;
+        }
+    }
+
+#ifdef DEBUG_MOTIONPLANNER_DETAILED_INFO
+    Log.notice("ActuatorLimits feedrate %F maxAcc %F\n", block._feedrate, block._actuatorMaxAccMMps2);
+#endif
+}
+
 void MotionPlanner::debugDumpQueue(const char *comStr, MotionPipeline &motionPipeline, unsigned int minQLen)
 {
 #ifdef DEBUG_TEST_DUMP
@@ -197,27 +270,35 @@ void MotionPlanner::debugDumpQueue(const char *comStr, MotionPipeline &motionPip
 void MotionPlanner::recalculatePipeline(MotionPipeline &motionPipeline, AxesParams &axesParams)
 {
     // The last block in the pipe (most recently added) will have zero exit speed
-    // For each block, walking backwards in the queue :
+    // Blocks before the planned-up-to watermark already have optimal entry speeds (either at their
+    // maximum entry speed or limited by full acceleration from an optimal block) so adding a block
+    // can't change them - only the blocks after the watermark need to be reprocessed
+    // For each block after the watermark, walking backwards in the queue :
     //    We know the desired exit speed so calculate the entry speed using v^2 = u^2 + 2*a*s
-    //    Set the exit speed for the previous block from this entry speed
-    // Then walk forward in the queue starting with the first block that can be changed:
+    //    This entry speed is the desired exit speed for the previous block
+    // Then walk forward in the queue starting with the watermark block:
     //    Set the entry speed from the previous block (or to 0 if none)
     //    Calculate the max possible exit speed for the block using the same formula as above
     //    Set the entry speed for the next block using this exit speed
-    // Finally prepare the block for stepper motor actuation
+    //    Move the watermark forwards if the block's entry speed is now optimal
+    // Finally prepare the blocks whose speeds have changed for stepper motor actuation
+    // Blocks which have been committed to the ramp generator are never changed
 
 #ifdef DEBUG_MOTIONPLANNER_DETAILED_INFO
-    Log.notice("^^^^^^^^^^^^^^^^^^^^^^^BEFORE RECALC^^^^^^^^^^^^^^^^^^^^^^^^\n");
+    Log.notice("^^^^^^^^^^^^^^^^^^^^^^^BEFORE RECALC^^^^^^^^^^^^^^^^^^^^^^^^ planned %d\n", _plannedUpToIdxFromPut);
     motionPipeline.debugShowBlocks(axesParams);
 #endif
 
-    // Iterate the block queue in backwards time order stopping at the first block that has its recalculateFlag false
+    // Stop the ramp generator committing blocks while they are changed - blocks before the watermark
+    // aren't changed so they can still be committed
+    int changeableBlocks = motionPipeline.beginPlanning((_plannedUpToIdxFromPut >= 0) ?
+                                    _plannedUpToIdxFromPut + 1 : motionPipeline.count());
+
+    // Iterate the block queue in backwards time order stopping at the watermark or a committed block
     int blockIdx = 0;
-    int earliestBlockToReprocess = -1;
-    float previousBlockExitSpeed = 0;
     float followingBlockEntrySpeed = 0;
+    float earliestBlockPrevEntrySpeed = 0;
     MotionBlock *pBlock = NULL;
-    MotionBlock *pFollowingBlock = NULL;
     while (true)
     {
         // Get the block at current index
@@ -225,53 +306,53 @@ void MotionPlanner::recalculatePipeline(MotionPipeline &motionPipeline, AxesPara
         if (pBlock == NULL)
             break;
 
-        // Stop if we don't need to recalculate beyond here or if this block is already executing
-        if (pBlock->_isExecuting)
-        {
-            // Get the exit speed from this executing block to use as the entry speed when going forwards
-            previousBlockExitSpeed = pBlock->_exitSpeedMMps;
-            break;
-        }
-
-        // If entry speed is already at the maximum entry speed then we can stop here as no further changes are
-        // going to be made by going back further
-        if (pBlock->_entrySpeedMMps == pBlock->_maxEntrySpeedMMps && blockIdx > 1)
-        {
-#ifdef DEBUG_MOTIONPLANNER_DETAILED_INFO
-            Log.notice("++++++++++++++++++++++++++++++ Optimizing block %d, prevSpeed %F\n", blockIdx, pBlock->_exitSpeedMMps);
-#endif
-            //Get the exit speed from this block to use as the entry speed when going forwards
-            previousBlockExitSpeed = pBlock->_exitSpeedMMps;
+        // Stop if we've reached the planned-up-to watermark or if this block is committed to the ramp generator
+        if ((blockIdx >= changeableBlocks) || (blockIdx == _plannedUpToIdxFromPut))
             break;
-        }
-
-        // If there was a following block (remember we're working backwards) then now set the entry speed
-        if (pFollowingBlock)
-        {
-            // Assume for now that that whole block will be deceleration and calculate the max speed we can enter to be able to slow
-            // to the exit speed required
-            float maxEntrySpeed = MotionBlock::maxAchievableSpeed(axesParams._masterAxisMaxAccMMps2,
-                                                                    pFollowingBlock->_exitSpeedMMps, pFollowingBlock->_moveDistPrimaryAxesMM);
-            pFollowingBlock->_entrySpeedMMps = fminf(maxEntrySpeed, pFollowingBlock->_maxEntrySpeedMMps);
-
-            // Remember entry speed (to use as exit speed in the next loop)
-            followingBlockEntrySpeed = pFollowingBlock->_entrySpeedMMps;
-        }
 
-        // Remember the following block for the next pass
-        pFollowingBlock = pBlock;
+        // Remember the entry speed before changes in case this turns out to be the earliest block
+        earliestBlockPrevEntrySpeed = pBlock->_entrySpeedMMps;
 
-        // Set the block's exit speed to the entry speed of the block after this one
-        pBlock->_exitSpeedMMps = followingBlockEntrySpeed;
+        // Assume for now that that whole block will be deceleration and calculate the max speed we can enter to be able to slow
+        // to the exit speed required
+        float maxEntrySpeed = MotionBlock::maxAchievableSpeed(pBlock->getMaxAccMMps2(axesParams), axesParams._masterAxisMaxJerkMMps3,
+                                                                followingBlockEntrySpeed, pBlock->_moveDistPrimaryAxesMM);
+        pBlock->_entrySpeedMMps = fminf(maxEntrySpeed, pBlock->_maxEntrySpeedMMps);
 
-        // Remember this as the earliest block to reprocess when going forwards
-        earliestBlockToReprocess = blockIdx;
+        // Remember entry speed (to use as exit speed in the next loop)
+        followingBlockEntrySpeed = pBlock->_entrySpeedMMps;
 
         // Next
         blockIdx++;
     }
 
+    // Work out where to start going forwards
+    // Blocks before the first changeable one are (and remain) optimal - there is nothing before the first block
+    // in the pipeline so its entry speed is always zero
+    int earliestBlockToReprocess = blockIdx - 1;
+    float previousBlockExitSpeed = 0;
+    bool previousBlockExitChanged = (earliestBlockPrevEntrySpeed != 0);
+    if (pBlock)
+    {
+        if (blockIdx >= changeableBlocks)
+        {
+            // Get the exit speed from this committed block to use as the entry speed when going forwards
+            previousBlockExitSpeed = pBlock->_exitSpeedMMps;
+            previousBlockExitChanged = false;
+        }
+        else
+        {
+            // The watermark block's entry speed is fixed but its exit speed may be able to increase
+            earliestBlockToReprocess = blockIdx;
+            previousBlockExitSpeed = pBlock->_entrySpeedMMps;
+            previousBlockExitChanged = false;
+        }
+    }
+
     // Now iterate in forward time order
+    int plannedUpToIdx = -1;
+    bool prevBlockOptimal = true;
+    bool prevBlockAccelLimited = true;
     for (blockIdx = earliestBlockToReprocess; blockIdx >= 0; blockIdx--)
     {
         // Get the block to calculate for
@@ -280,25 +361,41 @@ void MotionPlanner::recalculatePipeline(MotionPipeline &motionPipeline, AxesPara
             break;
 
         // Set the entry speed to the previous block exit speed
-        // if (pBlock->_entrySpeedMMps > previousBlockExitSpeed)
         pBlock->_entrySpeedMMps = previousBlockExitSpeed;
 
+        // The entry speed is optimal if it is as high as the junction allows or if the previous block
+        // was optimal and accelerated as hard as possible
+        if ((pBlock->_entrySpeedMMps >= pBlock->_maxEntrySpeedMMps) || (prevBlockOptimal && prevBlockAccelLimited))
+        {
+            plannedUpToIdx = blockIdx;
+            prevBlockOptimal = true;
+        }
+        else
+        {
+            prevBlockOptimal = false;
+        }
+
         // Calculate maximum speed possible for the block - based on acceleration at the best rate
-        float maxExitSpeed = pBlock->maxAchievableSpeed(axesParams._masterAxisMaxAccMMps2,
+        // and limit to the entry speed required by the following block
+        float nextBlockEntrySpeed = 0;
+        if (blockIdx > 0)
+            nextBlockEntrySpeed = motionPipeline.peekNthFromPut(blockIdx - 1)->_entrySpeedMMps;
+        float maxExitSpeed = pBlock->maxAchievableSpeed(pBlock->getMaxAccMMps2(axesParams), axesParams._masterAxisMaxJerkMMps3,
                                                         pBlock->_entrySpeedMMps, pBlock->_moveDistPrimaryAxesMM);
-        pBlock->_exitSpeedMMps = fminf(maxExitSpeed, pBlock->_exitSpeedMMps);
+        prevBlockAccelLimited = maxExitSpeed <= nextBlockEntrySpeed;
+        float exitSpeed = fminf(maxExitSpeed, nextBlockEntrySpeed);
+
+        // Check for changes - the entry speed only changes if the previous block's exit speed did
+        bool speedsChanged = previousBlockExitChanged || (exitSpeed != pBlock->_exitSpeedMMps);
+        previousBlockExitChanged = (exitSpeed != pBlock->_exitSpeedMMps);
+        pBlock->_exitSpeedMMps = exitSpeed;
 
         // Remember for next block
-        previousBlockExitSpeed = pBlock->_exitSpeedMMps;
-    }
+        previousBlockExitSpeed = exitSpeed;
 
-    // Recalculate acceleration and deceleration curves
-    for (blockIdx = earliestBlockToReprocess; blockIdx >= 0; blockIdx--)
-    {
-        // Get the block to calculate for
-        pBlock = motionPipeline.peekNthFromPut(blockIdx);
-        if (!pBlock)
-            break;
+        // Recalculate acceleration and deceleration curves if required
+        if (!speedsChanged && pBlock->_canExecute)
+            continue;
 
         // Prepare this block for stepping
         if (pBlock->prepareForStepping(axesParams, false))
@@ -314,8 +411,14 @@ void MotionPlanner::recalculatePipeline(MotionPipeline &motionPipeline, AxesPara
         }
     }
 
+    // Move the watermark
+    _plannedUpToIdxFromPut = plannedUpToIdx;
+
+    // Hand over blocks which can execute
+    motionPipeline.endPlanning();
+
 #ifdef DEBUG_MOTIONPLANNER_DETAILED_INFO
-    Log.notice(".................AFTER RECALC.......................\n");
+    Log.notice(".................AFTER RECALC....................... planned %d\n", _plannedUpToIdxFromPut);
     motionPipeline.debugShowBlocks(axesParams);
 #elif DEBUG_MOTIONPLANNER_INFO
     motionPipeline.debugShowTopBlock(axesParams);
@@ -383,9 +486,12 @@ bool MotionPlanner::moveToStepwise(RobotCommandArgs &args,
         block._canExecute = true;
     }
 
-    // Add the block
+    // Add the block - it starts and ends at rest so nothing before it needs replanning
+    motionPipeline.beginPlanning(0);
     motionPipeline.add(block);
+    motionPipeline.endPlanning();
     _prevMotionBlockValid = true;
+    _plannedUpToIdxFromPut = 0;
 
     // Return the change in actuator position
     for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
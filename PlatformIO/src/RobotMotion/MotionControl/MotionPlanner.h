@@ -37,10 +37,16 @@ class MotionPlanner
     bool _prevMotionBlockValid;
     MotionBlockSequentialData _prevMotionBlock;
 
+    // Planned-up-to watermark - index (counting back from the put position) of the most
+    // recently added block whose entry speed is already optimal - all blocks before it
+    // are also optimal and need no further recalculation - -1 if no block is known optimal
+    int _plannedUpToIdxFromPut;
+
   public:
     MotionPlanner()
     {
         _prevMotionBlockValid = false;
+        _plannedUpToIdxFromPut = -1;
         _minimumPlannerSpeedMMps = 0;
         // Configure the motion pipeline - these values will be changed in config
         _junctionDeviation = 0;
@@ -58,6 +64,12 @@ class MotionPlanner
 
     void recalculatePipeline(MotionPipeline &motionPipeline, AxesParams &axesParams);
 
+    // Acceleration for the change of direction between blocks limited by each axis max acceleration
+    float junctionAcceleration(AxisFloats &prevUnitVectors, AxisFloats &unitVectors, AxesParams &axesParams);
+
+    // Limit block feedrate and acceleration to the actuator step rate and step acceleration limits
+    void applyActuatorLimits(MotionBlock &block, float moveDist, AxesParams &axesParams);
+
     // Entry point for adding a motion block
     bool moveToStepwise(RobotCommandArgs &args,
                         AxisPosition &curAxisPositions,
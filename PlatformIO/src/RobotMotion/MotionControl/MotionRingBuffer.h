@@ -1,12 +1,17 @@
 #pragma once
 
+#include <atomic>
+
 // Generic interrupt-safe ring buffer pointer class
-// Each pointer is only updated by one source (ISR or main thread)
+// Single producer single consumer - the put position is only updated by the producer and the get
+// position only by the consumer (ISR or main thread - which may be running on another core)
+// Positions are published with release semantics and read with acquire semantics so that the contents
+// of a slot are visible to the other side before the position which hands it over
 class MotionRingBufferPosn
 {
   public:
-    volatile unsigned int _putPos;
-    volatile unsigned int _getPos;
+    std::atomic<unsigned int> _putPos;
+    std::atomic<unsigned int> _getPos;
     unsigned int _bufLen;
 
     MotionRingBufferPosn(int maxLen)
@@ -17,29 +22,44 @@ class MotionRingBufferPosn
     void init(int maxLen)
     {
         _bufLen = maxLen;
-        _putPos = 0;
-        _getPos = 0;
+        clear();
     }
 
+    // Only valid when neither producer nor consumer is active
     void clear()
     {
-        _getPos = _putPos = 0;
+        _getPos.store(0, std::memory_order_relaxed);
+        _putPos.store(0, std::memory_order_release);
+    }
+
+    // Position to put the next element - only to be used by the producer
+    unsigned int posToPut()
+    {
+        return _putPos.load(std::memory_order_relaxed);
     }
+
+    // Position to get the next element - only to be used by the consumer
+    unsigned int IRAM_ATTR posToGet()
+    {
+        return _getPos.load(std::memory_order_relaxed);
+    }
+
     bool canPut()
     {
         if (_bufLen == 0)
             return false;
-        if (_putPos == _getPos)
+        unsigned int pp = _putPos.load(std::memory_order_relaxed);
+        unsigned int gp = _getPos.load(std::memory_order_acquire);
+        if (pp == gp)
             return true;
-        unsigned int gp = _getPos;
-        if (_putPos > gp)
+        if (pp > gp)
         {
-            if ((_putPos != _bufLen - 1) || (gp != 0))
+            if ((pp != _bufLen - 1) || (gp != 0))
                 return true;
         }
         else
         {
-            if (gp - _putPos > 1)
+            if (gp - pp > 1)
                 return true;
         }
         return false;
@@ -47,29 +67,32 @@ class MotionRingBufferPosn
 
     bool IRAM_ATTR canGet()
     {
-        return _putPos != _getPos;
+        return _putPos.load(std::memory_order_acquire) != _getPos.load(std::memory_order_relaxed);
     }
 
     void hasPut()
     {
-        _putPos++;
-        if (_putPos >= _bufLen)
-            _putPos = 0;
+        unsigned int pp = _putPos.load(std::memory_order_relaxed) + 1;
+        if (pp >= _bufLen)
+            pp = 0;
+        _putPos.store(pp, std::memory_order_release);
     }
 
     void IRAM_ATTR hasGot()
     {
-        _getPos++;
-        if (_getPos >= _bufLen)
-            _getPos = 0;
+        unsigned int gp = _getPos.load(std::memory_order_relaxed) + 1;
+        if (gp >= _bufLen)
+            gp = 0;
+        _getPos.store(gp, std::memory_order_release);
     }
 
     unsigned int count()
     {
-        unsigned int getPos = _getPos;
-        if (getPos <= _putPos)
-            return _putPos - getPos;
-        return _bufLen - getPos + _putPos;
+        unsigned int getPos = _getPos.load(std::memory_order_acquire);
+        unsigned int putPos = _putPos.load(std::memory_order_acquire);
+        if (getPos <= putPos)
+            return putPos - getPos;
+        return _bufLen - getPos + putPos;
     }
 
     // Get Nth element prior to the put position
@@ -78,14 +101,16 @@ class MotionRingBufferPosn
     // Returns -1 if invalid
     int getNthFromPut(unsigned int N)
     {
-        if (!canGet())
+        unsigned int getPos = _getPos.load(std::memory_order_acquire);
+        unsigned int putPos = _putPos.load(std::memory_order_acquire);
+        if (putPos == getPos)
             return -1;
         if (N >= _bufLen)
             return -1;
-        int nthPos = _putPos - 1 - N;
+        int nthPos = putPos - 1 - N;
         if (nthPos < 0)
             nthPos += _bufLen;
-        if (((unsigned int)(nthPos + 1) == _getPos) || ((unsigned int)(nthPos + 1) == _bufLen && _getPos == 0))
+        if (((unsigned int)(nthPos + 1) == getPos) || ((unsigned int)(nthPos + 1) == _bufLen && getPos == 0))
             return -1;
         return nthPos;
     }
@@ -96,14 +121,16 @@ class MotionRingBufferPosn
     // returns -1 if invalid
     int getNthFromGet(unsigned int N)
     {
-        if (!canGet())
+        unsigned int getPos = _getPos.load(std::memory_order_acquire);
+        unsigned int putPos = _putPos.load(std::memory_order_acquire);
+        if (putPos == getPos)
             return -1;
         if (N >= _bufLen)
             return -1;
-        unsigned int nthPos = _getPos + N;
+        unsigned int nthPos = getPos + N;
         if (nthPos >= _bufLen)
             nthPos -= _bufLen;
-        if (nthPos == _putPos)
+        if (nthPos == putPos)
             return -1;
         return nthPos;
     }
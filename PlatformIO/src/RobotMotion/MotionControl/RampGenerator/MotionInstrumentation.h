@@ -112,14 +112,14 @@ public:
             newInf._micros = micros();
             newInf._pin = uint8_t(pin);
             newInf._val = val;
-            _stepBuf[_stepBufPos._putPos] = newInf;
+            _stepBuf[_stepBufPos.posToPut()] = newInf;
             _stepBufPos.hasPut();
         }
     }
 
     TestOutputStepInf getStepInf()
     {
-        TestOutputStepInf inf = _stepBuf[_stepBufPos._getPos];
+        TestOutputStepInf inf = _stepBuf[_stepBufPos.posToGet()];
         _stepBufPos.hasGot();
         return inf;
     }
@@ -7,6 +7,7 @@
 #include "StepperMotor.h"
 #include "EndStop.h"
 #include "Utils.h"
+#include "JsonDocumentView.h"
 
 static const char* MODULE_PREFIX = "RampGenIO: ";
 
@@ -51,29 +52,31 @@ bool RampGenIO::configureAxis(int axisIdx, const char *axisJSON)
     if (axisIdx < 0 || axisIdx >= RobotConsts::MAX_AXES)
         return false;
 
+    JsonDocumentView axisDoc(axisJSON);
+
     // Check the kind of motor to use
     bool isValid = false;
-    String stepPinName = RdJson::getString("stepPin", "-1", axisJSON, isValid);
+    String stepPinName = axisDoc.getString("stepPin", "-1", isValid);
     if (isValid)
     {
         // Create the stepper motor for the axis
         int stepPin = ConfigPinMap::getPinFromName(stepPinName.c_str());
-        String dirnPinName = RdJson::getString("dirnPin", "-1", axisJSON);
+        String dirnPinName = axisDoc.getString("dirnPin", "-1");
         int dirnPin = ConfigPinMap::getPinFromName(dirnPinName.c_str());
         int muxPin1 = -1, muxPin2 = -1, muxPin3 = -1, muxDirnIdx = 0;
         if (dirnPin == -1)
         {
             // Check for multiplexed pins
-            String muxName = RdJson::getString("muxPin1", "-1", axisJSON);
+            String muxName = axisDoc.getString("muxPin1", "-1");
             muxPin1 = ConfigPinMap::getPinFromName(muxName.c_str());
-            muxName = RdJson::getString("muxPin2", "-1", axisJSON);
+            muxName = axisDoc.getString("muxPin2", "-1");
             muxPin2 = ConfigPinMap::getPinFromName(muxName.c_str());
-            muxName = RdJson::getString("muxPin3", "-1", axisJSON);
+            muxName = axisDoc.getString("muxPin3", "-1");
             muxPin3 = ConfigPinMap::getPinFromName(muxName.c_str());
-            muxName = RdJson::getString("muxDirnIdx", "-1", axisJSON);
+            muxName = axisDoc.getString("muxDirnIdx", "-1");
             muxDirnIdx = ConfigPinMap::getPinFromName(muxName.c_str());
         }
-        bool directionReversed = (RdJson::getLong("dirnRev", 0, axisJSON) != 0);
+        bool directionReversed = (axisDoc.getLong("dirnRev", 0) != 0);
 
         // Debug
         if (dirnPin >= 0)
@@ -90,7 +93,7 @@ bool RampGenIO::configureAxis(int axisIdx, const char *axisJSON)
     else
     {
         // Create a servo motor for the axis
-        String servoPinName = RdJson::getString("servoPin", "-1", axisJSON);
+        String servoPinName = axisDoc.getString("servoPin", "-1");
         long servoPin = ConfigPinMap::getPinFromName(servoPinName.c_str());
         Log.notice("%sAxis%d (servo pin %d)\n", MODULE_PREFIX, axisIdx, servoPin);
         if ((servoPin != -1))
@@ -106,7 +109,7 @@ bool RampGenIO::configureAxis(int axisIdx, const char *axisJSON)
     {
         // Get the config for endstop if present
         String endStopIdStr = "endStop" + String(endStopIdx);
-        String endStopJSON = RdJson::getString(endStopIdStr.c_str(), "{}", axisJSON);
+        String endStopJSON = axisDoc.getString(endStopIdStr.c_str(), "{}");
         if (endStopJSON.length() == 0 || endStopJSON.equals("{}"))
             continue;
 
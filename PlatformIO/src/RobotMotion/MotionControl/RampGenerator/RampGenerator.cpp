@@ -52,11 +52,33 @@ RampGenerator::RampGenerator(MotionPipeline* pMotionPipeline)
     _lastDoneNumberedCmdIdx = RobotConsts::NUMBERED_COMMAND_NONE;
     _isEnabled = false;
     _curStepRatePerTTicks = 0;
+    _curAccStepsPerTTicksPerMS = 0;
+    _curDecelerating = false;
+    _curStepPosRateSqr = 0;
+    _curStepPosRate = 0;
     _curAccumulatorStep = 0;
     _curAccumulatorNS = 0;
     _endStopCheckNum = 0;
     _isrTimerStarted = false;
     _rampGenEnabled = false;
+    _perStepAccel = false;
+    _curBlockPerStepAccel = false;
+    _scheduledStepping = false;
+    _schedIntervalNs = SCHEDULED_IDLE_INTERVAL_NS;
+    _schedIdle = true;
+    _stepEventDirectBlock = false;
+    _stepEventClearReq = false;
+    _producedStepAxes = 0;
+    _producedDirnAxes = 0;
+    _producerIntervalNs = 0;
+    _producerSinceLastNs = 0;
+    _stepEventSinceLastNs = 0;
+    _stepEventIdle = true;
+    _stepEventDirnAxes = STEP_EVENT_DIRN_UNKNOWN;
+#ifdef UNIT_TEST
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        _testStepEventAxisSteps[axisIdx] = 0;
+#endif
 
 #ifdef TEST_MOTION_ACTUATOR_ENABLE
     _pMotionInstrumentation = NULL;
@@ -86,6 +108,9 @@ void RampGenerator::deinit()
         _isrTimerStarted = false;
     }
 #endif
+    // A clear requested from stop() won't be done by the ISR now
+    if (_stepEventClearReq)
+        clearStepEvents();
 }
 
 void RampGenerator::configure(bool rampGenEnabled)
@@ -108,10 +133,28 @@ void RampGenerator::configure(bool rampGenEnabled)
 #ifdef USE_ESP32_TIMER_ISR
     if (_rampGenEnabled)
     {
-        Log.notice("RampGenerator: Starting ISR timer for direct stepping\n");
+        Log.notice("RampGenerator: Starting ISR timer for direct stepping %s\n",
+                    _stepEventQueue.isEnabled() ? "step-event-queue" : (_scheduledStepping ? "scheduled" : "polled"));
         _isrMotionTimer = timerBegin(0, CLOCK_RATE_MHZ, true);
-        timerAttachInterrupt(_isrMotionTimer, _staticISRStepperMotion, true);
-        timerAlarmWrite(_isrMotionTimer, DIRECT_STEP_ISR_TIMER_PERIOD_US, true);
+        if (_stepEventQueue.isEnabled())
+        {
+            // Step event queue output is always scheduled
+            _schedIntervalNs = SCHEDULED_IDLE_INTERVAL_NS;
+            timerAttachInterrupt(_isrMotionTimer, _staticISRStepEventQueue, true);
+            timerAlarmWrite(_isrMotionTimer, _schedIntervalNs / SCHEDULED_TIMER_RESOLUTION_NS, true);
+        }
+        else if (_scheduledStepping)
+        {
+            // Each alarm reloads the timer so each interval is relative to the previous alarm
+            _schedIntervalNs = SCHEDULED_IDLE_INTERVAL_NS;
+            timerAttachInterrupt(_isrMotionTimer, _staticISRStepperMotionScheduled, true);
+            timerAlarmWrite(_isrMotionTimer, _schedIntervalNs / SCHEDULED_TIMER_RESOLUTION_NS, true);
+        }
+        else
+        {
+            timerAttachInterrupt(_isrMotionTimer, _staticISRStepperMotion, true);
+            timerAlarmWrite(_isrMotionTimer, DIRECT_STEP_ISR_TIMER_PERIOD_US, true);
+        }
         timerAlarmEnable(_isrMotionTimer);
         _isrTimerStarted = true;
     }
@@ -122,6 +165,22 @@ void RampGenerator::stop()
 {
     _isPaused = true;
     _endStopReached = false;
+
+    // The step event queue is emptied by the ISR (the consumer) as it may be part way through
+    // outputting an event - nothing more is produced until that is done
+    if (_stepEventQueue.isEnabled())
+    {
+        if (_isrTimerStarted)
+            _stepEventClearReq = true;
+        else
+            clearStepEvents();
+    }
+
+    // Producer state (this is on the same task as the producer)
+    _producedStepAxes = 0;
+    _producedDirnAxes = 0;
+    _producerIntervalNs = 0;
+    _producerSinceLastNs = 0;
 }
 
 void RampGenerator::pause(bool pauseIt)
@@ -185,7 +244,7 @@ bool IRAM_ATTR RampGenerator::handleStepEnd()
 
 // Setup new block - cache all the info needed to process the block and reset
 // motion accumulators to facilitate the block's execution
-void IRAM_ATTR RampGenerator::setupNewBlock(MotionBlock *pBlock)
+void IRAM_ATTR RampGenerator::setupNewBlock(MotionBlock *pBlock, bool recordSteps)
 {
     // Setup step counts, direction and endstops for each axis
     _endStopCheckNum = 0;
@@ -197,8 +256,7 @@ void IRAM_ATTR RampGenerator::setupNewBlock(MotionBlock *pBlock)
         _curStepCount[axisIdx] = 0;
         _curAccumulatorRelative[axisIdx] = 0;
         // Set direction for the axis
-        _rampGenIO.setDirection(axisIdx, stepsTotal >= 0);
-        _totalStepsInc[axisIdx] = (stepsTotal >= 0) ? 1 : -1;
+        setAxisDirection(axisIdx, stepsTotal >= 0, recordSteps);
 
         // Instrumentation
         INSTRUMENT_MOTION_ACTUATOR_STEP_DIRN
@@ -253,13 +311,26 @@ void IRAM_ATTR RampGenerator::setupNewBlock(MotionBlock *pBlock)
 
     // Step rate
     _curStepRatePerTTicks = pBlock->_initialStepRatePerTTicks;
+
+    // Blocks start with zero acceleration
+    _curAccStepsPerTTicksPerMS = 0;
+    _curDecelerating = false;
+
+    // Per-step acceleration (S-curve blocks always change rate every ms)
+    _curBlockPerStepAccel = _perStepAccel && (pBlock->_jerkStepsPerTTicksPerMSPerMS == 0);
+    if (_curBlockPerStepAccel)
+    {
+        _curStepPosRate = _curStepRatePerTTicks;
+        _curStepPosRateSqr = uint64_t(_curStepPosRate) * _curStepPosRate;
+        updatePerStepRate(pBlock);
+    }
 }
 
 // Update millisecond accumulator to handle acceleration and deceleration
-void IRAM_ATTR RampGenerator::updateMSAccumulator(MotionBlock *pBlock)
+void IRAM_ATTR RampGenerator::updateMSAccumulator(MotionBlock *pBlock, uint32_t elapsedNs)
 {
     // Bump the millisec accumulator
-    _curAccumulatorNS += MotionBlock::TICK_INTERVAL_NS;
+    _curAccumulatorNS += elapsedNs;
 
     // Check for millisec accumulator overflow
     if (_curAccumulatorNS >= MotionBlock::NS_IN_A_MS)
@@ -267,6 +338,13 @@ void IRAM_ATTR RampGenerator::updateMSAccumulator(MotionBlock *pBlock)
         // Subtract from accumulator leaving remainder to combat rounding errors
         _curAccumulatorNS -= MotionBlock::NS_IN_A_MS;
 
+        // Jerk limited blocks change acceleration gradually
+        if (pBlock->_jerkStepsPerTTicksPerMSPerMS != 0)
+        {
+            updateJerkLimitedRate(pBlock);
+            return;
+        }
+
         // Check if decelerating
         if (_curStepCount[pBlock->_axisIdxWithMaxSteps] > pBlock->_stepsBeforeDecel)
         {
@@ -282,8 +360,147 @@ void IRAM_ATTR RampGenerator::updateMSAccumulator(MotionBlock *pBlock)
     }
 }
 
+// Update step rate for a jerk limited (S-curve) block - called once per ms
+// Acceleration is ramped up by the jerk value until it reaches the maximum and ramped down again
+// when the change in rate still required can just be achieved while reducing acceleration to zero
+void IRAM_ATTR RampGenerator::updateJerkLimitedRate(MotionBlock *pBlock)
+{
+    uint32_t jerk = pBlock->_jerkStepsPerTTicksPerMSPerMS;
+    uint32_t rateChangeRequired = 0;
+
+    // Check if decelerating
+    if (_curStepCount[pBlock->_axisIdxWithMaxSteps] > pBlock->_stepsBeforeDecel)
+    {
+        // Deceleration starts from zero acceleration
+        if (!_curDecelerating)
+        {
+            _curDecelerating = true;
+            _curAccStepsPerTTicksPerMS = 0;
+        }
+        uint32_t minStepRate = std::max(MIN_STEP_RATE_PER_TTICKS, pBlock->_finalStepRatePerTTicks);
+        if (_curStepRatePerTTicks <= minStepRate)
+            return;
+        rateChangeRequired = _curStepRatePerTTicks - minStepRate;
+    }
+    else if ((_curStepRatePerTTicks < MIN_STEP_RATE_PER_TTICKS) || (_curStepRatePerTTicks < pBlock->_maxStepRatePerTTicks))
+    {
+        rateChangeRequired = std::max(MIN_STEP_RATE_PER_TTICKS, pBlock->_maxStepRatePerTTicks) - _curStepRatePerTTicks;
+    }
+    else
+    {
+        return;
+    }
+
+    // Ramp acceleration down if the remaining rate change is no more than acc^2/(2*jerk) otherwise ramp up to max
+    if (uint64_t(_curAccStepsPerTTicksPerMS) * _curAccStepsPerTTicksPerMS >= 2 * uint64_t(jerk) * rateChangeRequired)
+        _curAccStepsPerTTicksPerMS = (_curAccStepsPerTTicksPerMS > 2 * jerk) ? _curAccStepsPerTTicksPerMS - jerk : jerk;
+    else if (_curAccStepsPerTTicksPerMS + jerk < pBlock->_accStepsPerTTicksPerMS)
+        _curAccStepsPerTTicksPerMS += jerk;
+    else
+        _curAccStepsPerTTicksPerMS = pBlock->_accStepsPerTTicksPerMS;
+
+    // Apply acceleration without overshooting the target rate
+    uint32_t rateChange = std::min(_curAccStepsPerTTicksPerMS, rateChangeRequired);
+    if (_curDecelerating)
+        _curStepRatePerTTicks -= rateChange;
+    else
+        _curStepRatePerTTicks += rateChange;
+}
+
+// Update step rate for the next step of the axis with most steps - called once per step
+// The rate at each step position follows v^2 = u^2 + 2as exactly and the rate used between two
+// step positions is the mean of the rates at each (which gives the exact time for the step)
+void IRAM_ATTR RampGenerator::updatePerStepRate(MotionBlock *pBlock)
+{
+    uint64_t rateSqrChange = pBlock->_accStepRateSqrPerStep;
+    uint64_t newRateSqr = _curStepPosRateSqr;
+
+    // Check if decelerating
+    if (_curStepCount[pBlock->_axisIdxWithMaxSteps] >= pBlock->_stepsBeforeDecel)
+    {
+        uint64_t minStepRate = std::max(MIN_STEP_RATE_PER_TTICKS, pBlock->_finalStepRatePerTTicks);
+        uint64_t minRateSqr = minStepRate * minStepRate;
+        if (newRateSqr > minRateSqr + rateSqrChange)
+            newRateSqr -= rateSqrChange;
+        else
+            newRateSqr = minRateSqr;
+    }
+    else
+    {
+        uint64_t maxStepRate = std::max(MIN_STEP_RATE_PER_TTICKS, pBlock->_maxStepRatePerTTicks);
+        uint64_t maxRateSqr = maxStepRate * maxStepRate;
+        if (newRateSqr + rateSqrChange < maxRateSqr)
+            newRateSqr += rateSqrChange;
+        else
+            newRateSqr = maxRateSqr;
+    }
+
+    // Cruising
+    if (newRateSqr == _curStepPosRateSqr)
+    {
+        _curStepRatePerTTicks = _curStepPosRate;
+        return;
+    }
+
+    // Rate for the next step
+    uint32_t newRate = stepRateSqrt(newRateSqr, _curStepPosRate);
+    _curStepRatePerTTicks = uint32_t((uint64_t(_curStepPosRate) + newRate) / 2);
+    _curStepPosRate = newRate;
+    _curStepPosRateSqr = newRateSqr;
+}
+
+// Integer square root of a squared step rate using Newton's method which converges in one or two
+// iterations when approxRate is the rate at the previous step
+uint32_t IRAM_ATTR RampGenerator::stepRateSqrt(uint64_t rateSqr, uint32_t approxRate)
+{
+    if (rateSqr == 0)
+        return 0;
+
+    // If the approximation is poor (e.g. starting from rest) start from a power of two within a factor of 2
+    uint64_t rate = approxRate;
+    if (rate * rate < (rateSqr >> 8))
+        rate = 1ull << ((64 - __builtin_clzll(rateSqr) + 1) / 2);
+
+    // Iterate until the change is insignificant
+    for (int i = 0; i < STEP_RATE_SQRT_MAX_ITERATIONS; i++)
+    {
+        uint64_t newRate = (rate + rateSqr / rate) / 2;
+        uint64_t change = (newRate > rate) ? newRate - rate : rate - newRate;
+        rate = newRate;
+        if (change <= (rate >> STEP_RATE_SQRT_PRECISION_SHIFT))
+            break;
+    }
+    return uint32_t(std::min(rate, uint64_t(MotionBlock::TTICKS_VALUE)));
+}
+
+// Set direction of an axis - or record it if producing step events (only the producer records)
+void IRAM_ATTR RampGenerator::setAxisDirection(int axisIdx, bool direction, bool recordSteps)
+{
+    if (recordSteps)
+    {
+        if (direction)
+            _producedDirnAxes |= (1 << axisIdx);
+        else
+            _producedDirnAxes &= ~(1 << axisIdx);
+        return;
+    }
+    _rampGenIO.setDirection(axisIdx, direction);
+    _totalStepsInc[axisIdx] = direction ? 1 : -1;
+}
+
+// Start a step on an axis - or record it if producing step events (only the producer records)
+void IRAM_ATTR RampGenerator::stepAxis(int axisIdx, bool recordSteps)
+{
+    if (recordSteps)
+    {
+        _producedStepAxes |= (1 << axisIdx);
+        return;
+    }
+    _rampGenIO.stepStart(axisIdx);
+}
+
 // Handle start of step on each axis
-bool IRAM_ATTR RampGenerator::handleStepMotion(MotionBlock *pBlock)
+bool IRAM_ATTR RampGenerator::handleStepMotion(MotionBlock *pBlock, bool recordSteps)
 {
     // Complete Flag
     bool anyAxisMoving = false;
@@ -298,7 +515,7 @@ bool IRAM_ATTR RampGenerator::handleStepMotion(MotionBlock *pBlock)
     if (_curStepCount[axisIdxMaxSteps] < _stepsTotalAbs[axisIdxMaxSteps])
     {
         // Step this axis
-        _rampGenIO.stepStart(axisIdxMaxSteps);
+        stepAxis(axisIdxMaxSteps, recordSteps);
         _curStepCount[axisIdxMaxSteps]++;
         if (_curStepCount[axisIdxMaxSteps] < _stepsTotalAbs[axisIdxMaxSteps])
             anyAxisMoving = true;
@@ -321,7 +538,7 @@ bool IRAM_ATTR RampGenerator::handleStepMotion(MotionBlock *pBlock)
             _curAccumulatorRelative[axisIdx] -= _stepsTotalAbs[axisIdxMaxSteps];
 
             // Step the axis
-            _rampGenIO.stepStart(axisIdx);
+            stepAxis(axisIdx, recordSteps);
             // Log.trace("RampGenerator::procTick otherAxisStep: %d (ax %d)\n", pAxisInfo->_pinStep, axisIdx);
             _curStepCount[axisIdx]++;
             if (_curStepCount[axisIdx] < _stepsTotalAbs[axisIdx])
@@ -376,15 +593,11 @@ void IRAM_ATTR RampGenerator::isrStepperMotion()
     if (_isPaused)
         return;
 
-    // Peek a MotionPipelineElem from the queue
-    MotionBlock *pBlock = _pMotionPipeline->peekGet();
+    // Peek a MotionPipelineElem from the queue - only blocks which can be executed are committed
+    MotionBlock *pBlock = _pMotionPipeline->peekGetCommitted();
     if (!pBlock)
         return;
 
-    // Check if the element can be executed
-    if (!pBlock->_canExecute)
-        return;
-
     // See if the block was already executing and set isExecuting if not
     bool newBlock = !pBlock->_isExecuting;
     pBlock->_isExecuting = true;
@@ -393,7 +606,7 @@ void IRAM_ATTR RampGenerator::isrStepperMotion()
     if (newBlock)
     {
         // Setup new block
-        setupNewBlock(pBlock);
+        setupNewBlock(pBlock, false);
 
         // Return here to reduce the maximum time this function takes
         // Assuming this function is called frequently (<50uS intervals say)
@@ -419,8 +632,9 @@ void IRAM_ATTR RampGenerator::isrStepperMotion()
     }
 
     // Update the millisec accumulator - this handles the process of changing speed incrementally to
-    // implement acceleration and deceleration
-    updateMSAccumulator(pBlock);
+    // implement acceleration and deceleration (unless the rate is updated on every step)
+    if (!_curBlockPerStepAccel)
+        updateMSAccumulator(pBlock, MotionBlock::TICK_INTERVAL_NS);
 
     // Bump the step accumulator
     _curAccumulatorStep += std::max(_curStepRatePerTTicks, MIN_STEP_RATE_PER_TTICKS);
@@ -443,7 +657,7 @@ void IRAM_ATTR RampGenerator::isrStepperMotion()
         bool anyAxisMoving = false;
 
         // Handle a step
-        anyAxisMoving = handleStepMotion(pBlock);
+        anyAxisMoving = handleStepMotion(pBlock, false);
 
         // Any axes still moving?
         if (!anyAxisMoving)
@@ -451,10 +665,293 @@ void IRAM_ATTR RampGenerator::isrStepperMotion()
             // This block is done
             endMotion(pBlock);
         }
+        else if (_curBlockPerStepAccel)
+        {
+            // Rate for the next step
+            updatePerStepRate(pBlock);
+        }
+    }
+
+    // Time execution
+    INSTRUMENT_MOTION_ACTUATOR_TIME_END
+}
+
+#ifdef USE_ESP32_TIMER_ISR
+// Function that handles ISR calls in scheduled stepping mode - the timer alarm is set to
+// the interval returned by isrStepperMotionScheduled()
+void IRAM_ATTR RampGenerator::_staticISRStepperMotionScheduled()
+{
+    if (_pThis)
+    {
+        uint32_t intervalNs = _pThis->isrStepperMotionScheduled();
+        timerAlarmWrite(_pThis->_isrMotionTimer, intervalNs / SCHEDULED_TIMER_RESOLUTION_NS, true);
+    }
+}
+#endif
+
+// Scheduled stepping - rather than being called every tick this is called when the next step is due,
+// when a step pulse should end or at a ms boundary (if the rate is only updated every ms)
+// Returns the time (ns) until it should next be called
+uint32_t IRAM_ATTR RampGenerator::isrStepperMotionScheduled()
+{
+    // Instrumentation code to time ISR execution (if enabled - see MotionInstrumentation.h)
+    INSTRUMENT_MOTION_ACTUATOR_TIME_START
+
+    // Do a step-end for any motor which needs one
+    handleStepEnd();
+
+    // Handle motion
+    _schedIntervalNs = scheduledFromISR(_schedIntervalNs);
+
+    // Time execution
+    INSTRUMENT_MOTION_ACTUATOR_TIME_END
+    return _schedIntervalNs;
+}
+
+// Scheduled stepping motion - the step and ms accumulators are advanced by the time elapsed since the
+// last call and the time until the next step, step pulse end or ms boundary (in ns) is returned
+// Returns 0 if there is nothing to step (idle or paused)
+// When recordSteps is set (step event producer only) steps and directions are recorded rather than output
+uint32_t IRAM_ATTR RampGenerator::stepperMotionScheduled(uint32_t elapsedNs, bool recordSteps)
+{
+    // Peek a MotionPipelineElem from the queue (unless paused) - only blocks which can be executed are committed
+    MotionBlock *pBlock = _isPaused ? NULL : _pMotionPipeline->peekGetCommitted();
+    if (!pBlock)
+        return 0;
+
+    // New block
+    if (!pBlock->_isExecuting)
+    {
+        pBlock->_isExecuting = true;
+        setupNewBlock(pBlock, recordSteps);
+
+        // Return here to reduce the maximum time this function takes
+        return scheduledInterval(SCHEDULED_MIN_INTERVAL_NS);
+    }
+
+    // Check endstops - motors only move on steps so checking at each call is sufficient
+    for (int i = 0; i < _endStopCheckNum; i++)
+    {
+        bool pinVal = digitalRead(_endStopChecks[i].pin);
+        if (pinVal == _endStopChecks[i].val)
+        {
+            // Cancel motion (by removing the block) as end-stop reached
+            _endStopReached = true;
+            endMotion(pBlock);
+            return scheduledInterval(SCHEDULED_MIN_INTERVAL_NS);
+        }
+    }
+
+    // Bump the step accumulator for the elapsed time at the rate which applied during that time
+    uint32_t stepRate = std::max(_curStepRatePerTTicks, MIN_STEP_RATE_PER_TTICKS);
+    _curAccumulatorStep += uint32_t(uint64_t(stepRate) * elapsedNs / MotionBlock::TICK_INTERVAL_NS);
+
+    // Update the millisec accumulator - this handles the process of changing speed incrementally to
+    // implement acceleration and deceleration (unless the rate is updated on every step)
+    if (!_curBlockPerStepAccel)
+        updateMSAccumulator(pBlock, elapsedNs);
+
+    // Check for step accumulator overflow
+    bool stepStarted = false;
+    if (_curAccumulatorStep >= MotionBlock::TTICKS_VALUE)
+    {
+        // Handle a step
+        stepStarted = true;
+        if (!handleStepMotion(pBlock, recordSteps))
+        {
+            // This block is done
+            endMotion(pBlock);
+            return scheduledInterval(STEP_PULSE_WIDTH_NS);
+        }
+        else if (_curBlockPerStepAccel)
+        {
+            // Rate for the next step
+            updatePerStepRate(pBlock);
+        }
+    }
+
+    // Time until the next step at the current rate
+    stepRate = std::max(_curStepRatePerTTicks, MIN_STEP_RATE_PER_TTICKS);
+    uint32_t accumulatorRemaining = (_curAccumulatorStep < MotionBlock::TTICKS_VALUE) ?
+                        MotionBlock::TTICKS_VALUE - _curAccumulatorStep : 0;
+    uint64_t intervalNs = (uint64_t(accumulatorRemaining) * MotionBlock::TICK_INTERVAL_NS + stepRate - 1) / stepRate;
+
+    // The rate may change at the next ms boundary
+    if (!_curBlockPerStepAccel)
+        intervalNs = std::min(intervalNs, uint64_t(MotionBlock::NS_IN_A_MS - _curAccumulatorNS));
+
+    // End of the step pulse
+    if (stepStarted)
+        intervalNs = std::min(intervalNs, uint64_t(STEP_PULSE_WIDTH_NS));
+    return scheduledInterval(intervalNs);
+}
+
+// Scheduled stepping from the ISR - the time spent idle or paused is not passed on as elapsed time
+// otherwise a block resumed after a pause would make up for the time with a burst of steps
+uint32_t IRAM_ATTR RampGenerator::scheduledFromISR(uint32_t elapsedNs)
+{
+    uint32_t intervalNs = stepperMotionScheduled(_schedIdle ? 0 : elapsedNs, false);
+    _schedIdle = (intervalNs == 0);
+    return _schedIdle ? SCHEDULED_IDLE_INTERVAL_NS : intervalNs;
+}
+
+// Interval until the next scheduled call - this is rounded up to the timer resolution and is at least
+// the minimum interval
+uint32_t IRAM_ATTR RampGenerator::scheduledInterval(uint64_t intervalNs)
+{
+    if (intervalNs < SCHEDULED_MIN_INTERVAL_NS)
+        intervalNs = SCHEDULED_MIN_INTERVAL_NS;
+    intervalNs = (intervalNs + SCHEDULED_TIMER_RESOLUTION_NS - 1) / SCHEDULED_TIMER_RESOLUTION_NS * SCHEDULED_TIMER_RESOLUTION_NS;
+    return uint32_t(intervalNs);
+}
+
+#ifdef USE_ESP32_TIMER_ISR
+// Function that handles ISR calls in step event queue mode
+void IRAM_ATTR RampGenerator::_staticISRStepEventQueue()
+{
+    if (_pThis)
+    {
+        uint32_t intervalNs = _pThis->isrStepEventQueue();
+        timerAlarmWrite(_pThis->_isrMotionTimer, intervalNs / SCHEDULED_TIMER_RESOLUTION_NS, true);
+    }
+}
+#endif
+
+// Empty the step event queue and reset the consumer state - this must only be called from the ISR
+// (or when the ISR isn't running)
+void IRAM_ATTR RampGenerator::clearStepEvents()
+{
+    while (_stepEventQueue.canGet())
+        _stepEventQueue.remove();
+    _stepEventDirectBlock = false;
+    _stepEventDirnAxes = STEP_EVENT_DIRN_UNKNOWN;
+    _stepEventSinceLastNs = 0;
+    _stepEventIdle = true;
+    _stepEventClearReq = false;
+}
+
+// Step event queue mode - the ISR outputs steps worked out in advance by produceStepEvents()
+// Blocks which check end-stops or complete numbered commands are executed directly
+// Returns the time (ns) until it should next be called
+uint32_t IRAM_ATTR RampGenerator::isrStepEventQueue()
+{
+    // Instrumentation code to time ISR execution (if enabled - see MotionInstrumentation.h)
+    INSTRUMENT_MOTION_ACTUATOR_TIME_START
+
+    // Time since the last call
+    uint32_t elapsedNs = _schedIntervalNs;
+
+    // Do a step-end for any motor which needs one
+    handleStepEnd();
+
+    // Check for a request to clear the queue (on stop)
+    if (_stepEventClearReq)
+    {
+        clearStepEvents();
+        _schedIntervalNs = SCHEDULED_IDLE_INTERVAL_NS;
+        return _schedIntervalNs;
+    }
+
+    // Check for a block to execute directly - this continues until the block is complete
+    if (_stepEventDirectBlock)
+    {
+        _schedIntervalNs = scheduledFromISR(elapsedNs);
+        if (!_pMotionPipeline->isGetCommitted())
+        {
+            _stepEventDirnAxes = STEP_EVENT_DIRN_UNKNOWN;
+            _stepEventDirectBlock = false;
+        }
+        return _schedIntervalNs;
+    }
+
+    // Check if paused or nothing to output - the time to an event is counted from when it is first seen
+    StepEvent *pStepEvent = _isPaused ? NULL : _stepEventQueue.peekGet();
+    if (!pStepEvent)
+    {
+        _stepEventSinceLastNs = 0;
+        _stepEventIdle = true;
+        _schedIntervalNs = SCHEDULED_IDLE_INTERVAL_NS;
+        return _schedIntervalNs;
+    }
+
+    // Check if the event is due
+    if (!_stepEventIdle)
+        _stepEventSinceLastNs += elapsedNs;
+    _stepEventIdle = false;
+    if (_stepEventSinceLastNs < pStepEvent->_intervalNs)
+    {
+        _schedIntervalNs = scheduledInterval(pStepEvent->_intervalNs - _stepEventSinceLastNs);
+        return _schedIntervalNs;
     }
 
+    // Set directions if changed - the step is output on the next call to allow for driver setup time
+    if (pStepEvent->_dirnAxes != _stepEventDirnAxes)
+    {
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            setAxisDirection(axisIdx, pStepEvent->_dirnAxes & (1 << axisIdx), false);
+        _stepEventDirnAxes = pStepEvent->_dirnAxes;
+        _schedIntervalNs = scheduledInterval(SCHEDULED_MIN_INTERVAL_NS);
+        return _schedIntervalNs;
+    }
+
+    // Step
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+    {
+        if (pStepEvent->_stepAxes & (1 << axisIdx))
+        {
+            stepAxis(axisIdx, false);
+#ifdef UNIT_TEST
+            _testStepEventAxisSteps[axisIdx]++;
+#endif
+        }
+    }
+
+    // Remainder of time is carried to the next event
+    _stepEventSinceLastNs -= pStepEvent->_intervalNs;
+    _stepEventQueue.remove();
+    _schedIntervalNs = scheduledInterval(STEP_PULSE_WIDTH_NS);
+
     // Time execution
     INSTRUMENT_MOTION_ACTUATOR_TIME_END
+    return _schedIntervalNs;
+}
+
+// Step event producer - called from the main loop - runs the scheduled stepping code against a virtual
+// clock recording the steps generated in the step event queue
+void RampGenerator::produceStepEvents()
+{
+    while (_stepEventQueue.canPut() && !_stepEventDirectBlock && !_stepEventClearReq && !_isPaused)
+    {
+        // Check there is a block to execute - this commits it so it is left for the ISR to start if
+        // it is to be executed directly
+        MotionBlock *pBlock = _pMotionPipeline->peekGetCommitted();
+        if (!pBlock)
+            return;
+
+        // Blocks which check end-stops or complete numbered commands are executed directly by the ISR
+        // once all queued events have been output
+        if (!pBlock->_isExecuting && (pBlock->_endStopsToCheck.any() ||
+                    (pBlock->getNumberedCommandIndex() != RobotConsts::NUMBERED_COMMAND_NONE)))
+        {
+            if (!_stepEventQueue.canGet())
+                _stepEventDirectBlock = true;
+            return;
+        }
+
+        // Run the stepping code recording steps rather than outputting them
+        _producedStepAxes = 0;
+        _producerSinceLastNs += _producerIntervalNs;
+        _producerIntervalNs = stepperMotionScheduled(_producerIntervalNs, true);
+        if (_producerIntervalNs == 0)
+            return;
+
+        // Add a step event
+        if (_producedStepAxes != 0)
+        {
+            _stepEventQueue.put(_producerSinceLastNs, _producedStepAxes, _producedDirnAxes);
+            _producerSinceLastNs = 0;
+        }
+    }
 }
 
 // Process method called by main program loop
@@ -463,6 +960,10 @@ void RampGenerator::process()
     // Service RampGenIO
     _rampGenIO.service();
 
+    // Fill the step event queue
+    if (_rampGenEnabled && _stepEventQueue.isEnabled())
+        produceStepEvents();
+
     // If using a controller with a ramp generator then service the block handling
     if (_rampGenEnabled)
     {
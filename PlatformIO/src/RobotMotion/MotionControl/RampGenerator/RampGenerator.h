@@ -11,6 +11,7 @@
 #include "MotionInstrumentation.h"
 #include "../MotionBlock.h"
 #include "RampGenIO.h"
+#include "StepEventQueue.h"
 
 class MotionPipeline;
 
@@ -41,11 +42,24 @@ private:
     static constexpr uint32_t MIN_STEP_RATE_PER_SEC = 10;
     static constexpr uint32_t MIN_STEP_RATE_PER_TTICKS = uint32_t((MIN_STEP_RATE_PER_SEC * 1.0 * MotionBlock::TTICKS_VALUE) / MotionBlock::TICKS_PER_SEC);
 
+    // Newton's method iterations for the step rate square root - normally only one or two are needed
+    // as the previous step rate is used as the starting point
+    static constexpr int STEP_RATE_SQRT_MAX_ITERATIONS = 8;
+    static constexpr int STEP_RATE_SQRT_PRECISION_SHIFT = 12;
+
 #ifdef INSTRUMENT_MOTION_ACTUATOR_ENABLE
     // Test code
     MotionInstrumentation *_pMotionInstrumentation;
 #endif
 
+    // Scheduled stepping - the timer is set for the next step edge (or step pulse end) rather than
+    // firing every tick - intervals are multiples of the timer resolution (1us) and the minimum must
+    // exceed ISR latency plus execution time
+    static constexpr uint32_t SCHEDULED_TIMER_RESOLUTION_NS = 1000;
+    static constexpr uint32_t SCHEDULED_MIN_INTERVAL_NS = 8000;
+    static constexpr uint32_t SCHEDULED_IDLE_INTERVAL_NS = 100000;
+    static constexpr uint32_t STEP_PULSE_WIDTH_NS = 8000;
+
 #ifdef USE_ESP32_TIMER_ISR
     // ISR based interval timer
     hw_timer_t *_isrMotionTimer;
@@ -59,6 +73,36 @@ private:
     bool _isEnabled;
     // Ramp generation enabled
     bool _rampGenEnabled;
+    // Update step rate on every step (rather than every ms) for trapezoidal blocks
+    bool _perStepAccel;
+    bool _curBlockPerStepAccel;
+    // Schedule the timer for the next event rather than polling every tick
+    bool _scheduledStepping;
+    // Interval (ns) until the next scheduled call
+    uint32_t _schedIntervalNs;
+    // Set while there is nothing to step (idle or paused) - time spent like this isn't counted
+    // as stepping time when a block starts or resumes
+    bool _schedIdle;
+
+    // Step event queue - when enabled steps are worked out in the main loop and output by the ISR
+    StepEventQueue _stepEventQueue;
+    // Set when the ISR is executing a block directly (because it checks end-stops, etc)
+    volatile bool _stepEventDirectBlock;
+    // Set on stop - the ISR empties the queue and clears this
+    volatile bool _stepEventClearReq;
+    // Producer state - steps and directions recorded by the producer (main loop only)
+    uint8_t _producedStepAxes;
+    uint8_t _producedDirnAxes;
+    uint32_t _producerIntervalNs;
+    uint32_t _producerSinceLastNs;
+    // Consumer state - time since the last step event was output and current directions
+    uint32_t _stepEventSinceLastNs;
+    bool _stepEventIdle;
+    uint8_t _stepEventDirnAxes;
+    static constexpr uint8_t STEP_EVENT_DIRN_UNKNOWN = 0xff;
+#ifdef UNIT_TEST
+    uint32_t _testStepEventAxisSteps[RobotConsts::MAX_AXES];
+#endif
     // End-stop reached
     bool _endStopReached;
     // Last completed numbered command
@@ -68,6 +112,13 @@ private:
     uint32_t _curStepCount[RobotConsts::MAX_AXES];
     // Current step rate (in steps per K ticks)
     uint32_t _curStepRatePerTTicks;
+    // Current acceleration and phase for jerk limited (S-curve) blocks
+    uint32_t _curAccStepsPerTTicksPerMS;
+    bool _curDecelerating;
+    // Square of the step rate and the step rate at the position of the last step - used for per-step
+    // acceleration where the step rate is the mean of the rates at the last and next step positions
+    uint64_t _curStepPosRateSqr;
+    uint32_t _curStepPosRate;
     // Accumulators for stepping and acceleration increments
     uint32_t _curAccumulatorStep;
     uint32_t _curAccumulatorNS;
@@ -87,6 +138,22 @@ public:
     void setInstrumentationMode(const char *testModeStr);
     void deinit();
     void configure(bool rampGenEnabled);
+    void setPerStepAccel(bool perStepAccel)
+    {
+        _perStepAccel = perStepAccel;
+    }
+    void setScheduledStepping(bool scheduledStepping)
+    {
+        _scheduledStepping = scheduledStepping;
+    }
+    void setStepEventQueueLen(int stepEventQueueLen)
+    {
+        _stepEventQueue.init(stepEventQueueLen);
+    }
+    bool stepEventsPending()
+    {
+        return _stepEventQueue.canGet() || _stepEventDirectBlock || _stepEventClearReq;
+    }
     bool configureAxis(int axisIdx, const char *axisJSON)
     {
         return _rampGenIO.configureAxis(axisIdx, axisJSON);
@@ -108,12 +175,58 @@ public:
     String getDebugStr();
     void showDebug();
 
+#ifdef UNIT_TEST
+    // Run the ISR code directly and inspect the stepping state
+    void testISRStepperMotion()
+    {
+        isrStepperMotion();
+    }
+    uint32_t testISRStepperMotionScheduled()
+    {
+        return isrStepperMotionScheduled();
+    }
+    uint32_t testISRStepEventQueue()
+    {
+        return isrStepEventQueue();
+    }
+    void testProduceStepEvents()
+    {
+        produceStepEvents();
+    }
+    uint32_t testGetStepEventAxisSteps(int axisIdx)
+    {
+        return _testStepEventAxisSteps[axisIdx];
+    }
+    uint32_t testGetStepCount(int axisIdx)
+    {
+        return _curStepCount[axisIdx];
+    }
+    uint32_t testGetStepRatePerTTicks()
+    {
+        return _curStepRatePerTTicks;
+    }
+#endif
+
 private:
     static void _staticISRStepperMotion();
+    static void _staticISRStepperMotionScheduled();
+    static void _staticISRStepEventQueue();
     void isrStepperMotion();
+    uint32_t isrStepperMotionScheduled();
+    uint32_t stepperMotionScheduled(uint32_t elapsedNs, bool recordSteps);
+    uint32_t scheduledFromISR(uint32_t elapsedNs);
+    static uint32_t scheduledInterval(uint64_t intervalNs);
+    uint32_t isrStepEventQueue();
+    void clearStepEvents();
+    void produceStepEvents();
+    void setAxisDirection(int axisIdx, bool direction, bool recordSteps);
+    void stepAxis(int axisIdx, bool recordSteps);
     bool handleStepEnd();
-    void setupNewBlock(MotionBlock *pBlock);
-    void updateMSAccumulator(MotionBlock *pBlock);
-    bool handleStepMotion(MotionBlock *pBlock);
+    void setupNewBlock(MotionBlock *pBlock, bool recordSteps);
+    void updateMSAccumulator(MotionBlock *pBlock, uint32_t elapsedNs);
+    void updateJerkLimitedRate(MotionBlock *pBlock);
+    void updatePerStepRate(MotionBlock *pBlock);
+    static uint32_t stepRateSqrt(uint64_t rateSqr, uint32_t approxRate);
+    bool handleStepMotion(MotionBlock *pBlock, bool recordSteps);
     void endMotion(MotionBlock *pBlock);
 };
@@ -0,0 +1,90 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include <Arduino.h>
+#include "../MotionRingBuffer.h"
+#include <vector>
+
+// A step event is one or more axes stepping at the same time
+struct StepEvent
+{
+    // Time since the previous step event
+    uint32_t _intervalNs;
+    // Bit for each axis to step
+    uint8_t _stepAxes;
+    // Bit for each axis which is set if moving in the positive direction
+    uint8_t _dirnAxes;
+};
+
+// Queue of step events - filled by the main loop and emptied by the ISR
+// This is lock-free as each position in the ring buffer is only updated by one side and positions are
+// published with release semantics after the event is written
+class StepEventQueue
+{
+  private:
+    MotionRingBufferPosn _queuePosn;
+    std::vector<StepEvent> _queue;
+
+  public:
+    StepEventQueue() : _queuePosn(0)
+    {
+    }
+
+    void init(int queueSize)
+    {
+        _queue.resize(queueSize);
+        _queuePosn.init(queueSize);
+    }
+
+    bool isEnabled()
+    {
+        return _queue.size() > 0;
+    }
+
+    void clear()
+    {
+        _queuePosn.clear();
+    }
+
+    unsigned int count()
+    {
+        return _queuePosn.count();
+    }
+
+    bool canPut()
+    {
+        return _queuePosn.canPut();
+    }
+
+    // Add to queue - the caller must check canPut() first
+    void put(uint32_t intervalNs, uint8_t stepAxes, uint8_t dirnAxes)
+    {
+        StepEvent &stepEvent = _queue[_queuePosn.posToPut()];
+        stepEvent._intervalNs = intervalNs;
+        stepEvent._stepAxes = stepAxes;
+        stepEvent._dirnAxes = dirnAxes;
+        _queuePosn.hasPut();
+    }
+
+    bool IRAM_ATTR canGet()
+    {
+        return _queuePosn.canGet();
+    }
+
+    // Peek at the next event - NULL if empty
+    StepEvent IRAM_ATTR *peekGet()
+    {
+        if (!_queuePosn.canGet())
+            return NULL;
+        return &_queue[_queuePosn.posToGet()];
+    }
+
+    // Remove the next event
+    void IRAM_ATTR remove()
+    {
+        if (_queuePosn.canGet())
+            _queuePosn.hasGot();
+    }
+};
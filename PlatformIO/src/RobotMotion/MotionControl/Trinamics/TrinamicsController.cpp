@@ -91,19 +91,20 @@ void TrinamicsController::configure(const char *configJSON)
 
     // Check for trinamics controller config JSON
     String motionController = RdJson::getString("motionController", "NONE", configJSON);
+    JsonDocumentView mcDoc(motionController.c_str());
 
     // Get chip
-    String mcChip = RdJson::getString("chip", "NONE", motionController.c_str());
+    String mcChip = mcDoc.getString("chip", "NONE");
     Log.trace("%sconfigure motionController %s chip %s\n", MODULE_PREFIX, motionController.c_str(), mcChip.c_str());
 
     if ((mcChip == "TMC5072") || (mcChip == "TMC2130"))
     {
         // SPI settings
-        String pinName = RdJson::getString("MOSI", "", motionController.c_str());
+        String pinName = mcDoc.getString("MOSI", "");
         int spiMOSIPin = ConfigPinMap::getPinFromName(pinName.c_str());
-        pinName = RdJson::getString("MISO", "", motionController.c_str());
+        pinName = mcDoc.getString("MISO", "");
         int spiMISOPin = ConfigPinMap::getPinFromName(pinName.c_str());
-        pinName = RdJson::getString("CLK", "", motionController.c_str());
+        pinName = mcDoc.getString("CLK", "");
         int spiCLKPin = ConfigPinMap::getPinFromName(pinName.c_str());
 
         // Check valid
@@ -129,19 +130,19 @@ void TrinamicsController::configure(const char *configJSON)
     if (_isEnabled)
     {
         // Non-multiplexed cs pins
-        _cs1 = getPinAndConfigure(motionController.c_str(), "CS1", OUTPUT, HIGH);
-        _cs2 = getPinAndConfigure(motionController.c_str(), "CS2", OUTPUT, HIGH);
-        _cs3 = getPinAndConfigure(motionController.c_str(), "CS3", OUTPUT, HIGH);
+        _cs1 = getPinAndConfigure(mcDoc, "CS1", OUTPUT, HIGH);
+        _cs2 = getPinAndConfigure(mcDoc, "CS2", OUTPUT, HIGH);
+        _cs3 = getPinAndConfigure(mcDoc, "CS3", OUTPUT, HIGH);
 
         // Multiplexer settings
-        _mux1 = getPinAndConfigure(motionController.c_str(), "MUX1", OUTPUT, LOW);
-        _mux2 = getPinAndConfigure(motionController.c_str(), "MUX2", OUTPUT, LOW);
-        _mux3 = getPinAndConfigure(motionController.c_str(), "MUX3", OUTPUT, HIGH);
-        String confName = RdJson::getString("MUX_CS_1", "", motionController.c_str());
+        _mux1 = getPinAndConfigure(mcDoc, "MUX1", OUTPUT, LOW);
+        _mux2 = getPinAndConfigure(mcDoc, "MUX2", OUTPUT, LOW);
+        _mux3 = getPinAndConfigure(mcDoc, "MUX3", OUTPUT, HIGH);
+        String confName = mcDoc.getString("MUX_CS_1", "");
         _muxCS1 = ConfigPinMap::getPinFromName(confName.c_str());
-        confName = RdJson::getString("MUX_CS_2", "", motionController.c_str());
+        confName = mcDoc.getString("MUX_CS_2", "");
         _muxCS2 = ConfigPinMap::getPinFromName(confName.c_str());
-        confName = RdJson::getString("MUX_CS_3", "", motionController.c_str());
+        confName = mcDoc.getString("MUX_CS_3", "");
         _muxCS3 = ConfigPinMap::getPinFromName(confName.c_str());
 
         // Configure TMC2130s
@@ -183,9 +184,9 @@ void TrinamicsController::configure(const char *configJSON)
 }
 
 uint32_t TrinamicsController::getUint32WithBaseFromConfig(const char* dataPath, uint32_t defaultValue,
-                            const char* pSourceStr)
+                            const JsonDocumentView& configDoc)
 {
-    String confStr = RdJson::getString(dataPath, "", pSourceStr);
+    String confStr = configDoc.getString(dataPath, "");
     if (confStr.length() == 0)
         return defaultValue;
     if ((confStr.startsWith("0x")) || (confStr.startsWith("0X")))
@@ -200,17 +201,19 @@ void TrinamicsController::configureAxis(int axisIdx, const char *axisJSON)
     if (axisIdx < 0 || axisIdx >= RobotConsts::MAX_AXES)
         return;
 
+    JsonDocumentView axisDoc(axisJSON);
+
     // Get axis information
-    _axisSettings[axisIdx].reversed = (RdJson::getLong("dirnRev", 0, axisJSON) != 0);
+    _axisSettings[axisIdx].reversed = (axisDoc.getLong("dirnRev", 0) != 0);
 
     // Driver settings
-    _axisSettings[axisIdx].iRunPower = RdJson::getLong("IRUN", TMC_IRUN_DEFAULT, axisJSON);
-    _axisSettings[axisIdx].iHoldPower = RdJson::getLong("IHOLD", TMC_IHOLD_DEFAULT, axisJSON);
-    _axisSettings[axisIdx].iHoldDelay = RdJson::getLong("IHOLDDELAY", TMC_IHOLDDELAY_DEFAULT, axisJSON);
-    _axisSettings[axisIdx].chopConf = getUint32WithBaseFromConfig("CHOPCONF", TMC_CHOPCONF_DEFAULT, axisJSON);
+    _axisSettings[axisIdx].iRunPower = axisDoc.getLong("IRUN", TMC_IRUN_DEFAULT);
+    _axisSettings[axisIdx].iHoldPower = axisDoc.getLong("IHOLD", TMC_IHOLD_DEFAULT);
+    _axisSettings[axisIdx].iHoldDelay = axisDoc.getLong("IHOLDDELAY", TMC_IHOLDDELAY_DEFAULT);
+    _axisSettings[axisIdx].chopConf = getUint32WithBaseFromConfig("CHOPCONF", TMC_CHOPCONF_DEFAULT, axisDoc);
 
     // Get axis mapping
-    int chipDriverIdx = RdJson::getLong("chipDriverIdx", -1, axisJSON);
+    int chipDriverIdx = axisDoc.getLong("chipDriverIdx", -1);
     if ((chipDriverIdx != -1) && (chipDriverIdx >= 0) && (chipDriverIdx < MAX_TMC5072*MAX_TMC_DRIVERS_PER_CHIP))
     {
         _axisIdxToChipDriverIdx[axisIdx] = chipDriverIdx;
@@ -311,9 +314,9 @@ void TrinamicsController::tmc5072Init()
     }
 }
 
-int TrinamicsController::getPinAndConfigure(const char* configJSON, const char* pinSelector, int direction, int initValue)
+int TrinamicsController::getPinAndConfigure(const JsonDocumentView& configDoc, const char* pinSelector, int direction, int initValue)
 {
-    String pinName = RdJson::getString(pinSelector, "", configJSON);
+    String pinName = configDoc.getString(pinSelector, "");
     int pinIdx = ConfigPinMap::getPinFromName(pinName.c_str());
     if (pinIdx >= 0)
     {
@@ -550,18 +553,11 @@ void TrinamicsController::_timerCallback(void* arg)
         isMoving |= _tmc5072Status[i].anyAxisMoving();
     }
 
-    // Peek a MotionPipelineElem from the queue
-    MotionBlock *pBlock = _motionPipeline.peekGet();
+    // Peek a MotionPipelineElem from the queue - only blocks which can be executed are committed
+    MotionBlock *pBlock = _motionPipeline.peekGetCommitted();
     if (!pBlock)
     {
-        // Log.trace("Nothing in pipe\n");
-        return;
-    }
-
-    // Check if the element can be executed
-    if (!pBlock->_canExecute)
-    {
-        // Log.trace("Can't execute\n");
+        // Log.trace("Nothing in pipe or can't execute\n");
         return;
     }
 
@@ -599,10 +595,9 @@ void TrinamicsController::_timerCallback(void* arg)
         // Check if we finished a block and, if so, see if there's a new one waiting
         if (blockFinished)
         {
-            // Peek a MotionPipelineElem from the queue
-            // Check if the element can be executed
-            MotionBlock *pBlock = _motionPipeline.peekGet();
-            if (pBlock && pBlock->_canExecute)
+            // Peek a MotionPipelineElem from the queue if it can be executed
+            MotionBlock *pBlock = _motionPipeline.peekGetCommitted();
+            if (pBlock)
             {
                 // Should be new!
                 blockIsNew = !pBlock->_isExecuting;
@@ -5,6 +5,7 @@
 
 #include <ArduinoLog.h>
 #include <SPI.h>
+#include "JsonDocumentView.h"
 #include "../../AxesParams.h"
 #include "../MotionPipeline.h"
 
@@ -216,7 +217,7 @@ private:
     static const int TMC2130_REG_DRVSTATUS = 0x6F;
 
     // Helpers
-    int getPinAndConfigure(const char* configJSON, const char* pinSelector, int direction, int initValue);
+    int getPinAndConfigure(const JsonDocumentView& configDoc, const char* pinSelector, int direction, int initValue);
     uint64_t tmcWrite(int chipIdx, uint8_t cmd, uint32_t data, bool addWriteFlag=true);
     uint8_t tmcReadLastAndSetCmd(int chipIdx, uint8_t cmd, uint32_t& dataOut);
     void chipSel(int chipIdx, bool en);
@@ -225,7 +226,7 @@ private:
     void updateStatus(int chipIdx);
     void tmc5072SendCmd(int axisIdx, uint8_t baseCmd, uint32_t data);
     uint32_t getUint32WithBaseFromConfig(const char* dataPath, uint32_t defaultValue,
-                            const char* pSourceStr);
+                            const JsonDocumentView& configDoc);
     bool isCloseToDestination();
 
     // TMC5072 status
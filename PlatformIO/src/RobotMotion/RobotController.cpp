@@ -118,6 +118,11 @@ bool RobotController::isPaused()
     return _pRobot->isPaused();
 }
 
+bool RobotController::isIdle()
+{
+    return _motionHelper.isIdle() || isPaused();
+}
+
 // Service (called frequently)
 void RobotController::service()
 {
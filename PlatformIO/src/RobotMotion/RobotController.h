@@ -28,6 +28,9 @@ public:
     // Check if paused
     bool isPaused();
 
+    // Check if idle (no motion in progress or paused)
+    bool isIdle();
+
     // Service (called frequently)
     void service();
 
@@ -4,6 +4,9 @@
 #pragma once
 
 #include "RobotBase.h"
+#ifdef UNIT_TEST
+#include "../MotionControl/MotionPlanner.h"
+#endif
 
 class AxisFloats;
 class AxisPosition;
@@ -32,6 +35,21 @@ public:
     RobotSandTableScara(const char* pRobotTypeName, MotionHelper& motionHelper);
     ~RobotSandTableScara();
 
+#ifdef UNIT_TEST
+    static ptToActuatorFnType testGetPtToActuator()
+    {
+        return ptToActuator;
+    }
+    static actuatorToPtFnType testGetActuatorToPt()
+    {
+        return actuatorToPt;
+    }
+    static correctStepOverflowFnType testGetCorrectStepOverflow()
+    {
+        return correctStepOverflow;
+    }
+#endif
+
 private:
 
     // Convert a cartesian point to actuator coordinates
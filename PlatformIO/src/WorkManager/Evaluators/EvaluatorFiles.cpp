@@ -5,6 +5,7 @@
 #include <ArduinoLog.h>
 #include "EvaluatorFiles.h"
 #include "RdJson.h"
+#include "JsonDocumentView.h"
 #include "../WorkManager.h"
 
 static const char* MODULE_PREFIX = "EvaluatorFiles: ";
@@ -16,10 +17,24 @@ EvaluatorFiles::EvaluatorFiles(FileManager& fileManager, WorkManager& workManage
     _fileType = FILE_TYPE_UNKNOWN;
     _firstValidLineProcessed = false;
     _interpolate = true;
+    _bedRadiusMM = 0;
+    _gcodeLastCmdNum = -1;
+    _gcodeLastFeedrate = -1;
 }
 
-void EvaluatorFiles::setConfig(const char* configStr)
+void EvaluatorFiles::setConfig(const char* configStr, const char* robotAttributes)
 {
+    JsonDocumentView configDoc(configStr);
+    JsonDocumentView robotAttribDoc(robotAttributes);
+
+    // Tolerance for simplification of moves in files (0 = off)
+    _simplifier.setTolerance(configDoc.getDouble("fileSimplifyMM", 0));
+    // Theta-rho points are converted to mm using the bed size
+    double sizeX = robotAttribDoc.getDouble("sizeX", 0);
+    double sizeY = robotAttribDoc.getDouble("sizeY", 0);
+    _bedRadiusMM = std::min(sizeX, sizeY) / 2;
+    Log.trace("%ssetConfig simplifyMM %F (0=off) radiusMM %F\n", MODULE_PREFIX,
+              configDoc.getDouble("fileSimplifyMM", 0), _bedRadiusMM);
 }
 
 const char* EvaluatorFiles::getConfig()
@@ -30,7 +45,7 @@ const char* EvaluatorFiles::getConfig()
 // Is Busy
 bool EvaluatorFiles::isBusy()
 {
-    return _inProgress;
+    return _inProgress || _simplifier.hasOutput();
 }
 
 int EvaluatorFiles::getFileTypeFromExtension(String& fileName)
@@ -72,7 +87,7 @@ bool EvaluatorFiles::execWorkItem(WorkItem& workItem)
     _fileType = fileType;
 
     // Start chunked file access
-    bool retc = _fileManager.chunkedFileStart("", fileName, true);
+    bool retc = _fileManager.chunkedFileStart("", fileName, true, this);
     if (!retc)
         return false;
     Log.trace("%sstarted chunked file %s type is %s\n", MODULE_PREFIX, 
@@ -80,13 +95,17 @@ bool EvaluatorFiles::execWorkItem(WorkItem& workItem)
     _inProgress = true;
     _firstValidLineProcessed = false;
     _interpolate = true;
+    _simplifier.clear(true);
+    _gcodeModalState.clear();
+    _gcodeLastCmdNum = -1;
+    _gcodeLastFeedrate = -1;
     return retc;
 }
 
 void EvaluatorFiles::service()
 {
-    // Check in progress
-    if (!_inProgress)
+    // Check in progress - lines may still be held for simplification at the end of the file
+    if (!_inProgress && !_simplifier.hasOutput())
         return;
 
     // See if we can add to the queue
@@ -101,13 +120,23 @@ void EvaluatorFiles::service()
             return;
     }
 
+    // Lines held for simplification are added before more of the file is read
+    String outLine;
+    if (_simplifier.getNextLine(outLine))
+    {
+        addLineWorkItem(outLine);
+        return;
+    }
+    if (!_inProgress)
+        return;
+
     // Get next line from file
     String filename = "";
     int fileLen = 0;
     int chunkPos = 0;
     int chunkLen = 0;
     bool finalChunk = false;
-    uint8_t* pLine = _fileManager.chunkFileNext(filename, fileLen, chunkPos, chunkLen, finalChunk);
+    uint8_t* pLine = _fileManager.chunkFileNext(this, filename, fileLen, chunkPos, chunkLen, finalChunk);
 
     // Check if valid
     if (chunkLen > 0)
@@ -143,28 +172,21 @@ void EvaluatorFiles::service()
         // Handle non-comments
         if (!isComment)
         {
-            bool isValid = true;
             // Format line if Theta-Rho
             if (_fileType == FILE_TYPE_THETA_RHO)
             {
                 int spacePos = newLine.indexOf(" ");
                 if (spacePos > 0)
                 {
-                    newLine = (_interpolate ? (!_firstValidLineProcessed ? "_THRLINE0_/" : "_THRLINEN_/") : "_THRLINE_/") +
+                    String workItemStr = (_interpolate ? (!_firstValidLineProcessed ? "_THRLINE0_/" : "_THRLINEN_/") : "_THRLINE_/") +
                              newLine.substring(0,spacePos) + "/" + newLine.substring(spacePos+1);
-                }
-                else
-                {
-                    isValid = false;
+                    simplifyThetaRhoLine(newLine, workItemStr);
+                    _firstValidLineProcessed = true;
                 }
             }
-            // Form the work item if valid
-            if (isValid)
+            else
             {
-                Log.verbose("%sservice new line %s\n", MODULE_PREFIX, newLine.c_str());
-                String retStr;
-                WorkItem workItem(newLine.c_str());
-                _workManager.addWorkItem(workItem, retStr);
+                simplifyGCodeLine(newLine);
                 _firstValidLineProcessed = true;
             }
         }
@@ -186,12 +208,94 @@ void EvaluatorFiles::service()
     {
         // Process the line
         Log.verbose("%sservice file finished\n", MODULE_PREFIX);
+        _simplifier.flush();
+        _fileManager.chunkedFileEnd(this);
         _inProgress = false;
+        if (_simplifier.isEnabled())
+            Log.notice("%sservice simplified %d points to %d\n", MODULE_PREFIX,
+                    _simplifier.getNumPointsIn(), _simplifier.getNumPointsOut());
+    }
+
+    // Add the next line if one is ready
+    if (_simplifier.getNextLine(outLine))
+        addLineWorkItem(outLine);
+}
+
+void EvaluatorFiles::addLineWorkItem(const String& line)
+{
+    Log.verbose("%sservice new line %s\n", MODULE_PREFIX, line.c_str());
+    String retStr;
+    WorkItem workItem(line.c_str());
+    if (_fileType == FILE_TYPE_GCODE)
+        workItem.setType(WORK_ITEM_TYPE_FILE_GCODE);
+    _workManager.addWorkItem(workItem, retStr);
+}
+
+// Theta-rho lines are straight moves only if not interpolated
+void EvaluatorFiles::simplifyThetaRhoLine(String& line, String& workItemStr)
+{
+    if (!_simplifier.isEnabled() || _interpolate)
+    {
+        _simplifier.addOtherLine(workItemStr);
+        return;
+    }
+    int spacePos = line.indexOf(" ");
+    double theta = atof(line.substring(0, spacePos).c_str());
+    double rho = atof(line.substring(spacePos + 1).c_str());
+    _simplifier.addPoint(sin(theta) * rho * _bedRadiusMM, cos(theta) * rho * _bedRadiusMM, workItemStr, false);
+}
+
+// G-code lines are straight moves if they are absolute G0/G1 moves in X and Y only
+void EvaluatorFiles::simplifyGCodeLine(String& line)
+{
+    if (!_simplifier.isEnabled())
+    {
+        _simplifier.addOtherLine(line);
+        return;
+    }
+    GCodeLine gcodeLine;
+    RobotCommandArgs& cmdArgs = gcodeLine.cmdArgs;
+    bool isMove = EvaluatorGCode::parseLine(line.c_str(), line.length(), _gcodeModalState, gcodeLine) &&
+            (gcodeLine.cmdLetter == 'G') && ((gcodeLine.cmdNum == 0) || (gcodeLine.cmdNum == 1)) &&
+            !_gcodeModalState.isRelative && (cmdArgs.getMoveType() != RobotMoveTypeArg_Relative) &&
+            cmdArgs.isValid(0) && cmdArgs.isValid(1) && !cmdArgs.isValid(2) &&
+            !cmdArgs.isStepwise() && !cmdArgs.isExtrudeValid();
+    if (!isMove)
+    {
+        _simplifier.addOtherLine(line);
+        return;
     }
 
+    // Lines which change the move type or feedrate are kept
+    float feedrate = cmdArgs.isFeedrateValid() ? cmdArgs.getFeedrate() : 0;
+    bool mustKeep = (gcodeLine.cmdNum != _gcodeLastCmdNum) || (feedrate != _gcodeLastFeedrate) ||
+            (gcodeLine.numModalGWords > 0);
+    _gcodeLastCmdNum = gcodeLine.cmdNum;
+    _gcodeLastFeedrate = feedrate;
+    _simplifier.addPoint(cmdArgs.getValMM(0), cmdArgs.getValMM(1), line, mustKeep);
+}
+
+void EvaluatorFiles::getSimplifyStatus(FilesSimplifyStatus& status)
+{
+    status.isEnabled = _simplifier.isEnabled();
+    status.numPointsIn = _simplifier.getNumPointsIn();
+    status.numPointsOut = _simplifier.getNumPointsOut();
+}
+
+void FilesSimplifyStatus::toJSON(String& statusJSON) const
+{
+    statusJSON = "";
+    if (!isEnabled || (numPointsOut == 0))
+        return;
+    statusJSON = "\"simplifyIn\":" + String(numPointsIn) +
+            ",\"simplifyOut\":" + String(numPointsOut) +
+            ",\"simplifyRatio\":" + String(double(numPointsIn) / numPointsOut, 2);
 }
 
 void EvaluatorFiles::stop()
 {
+    if (_inProgress)
+        _fileManager.chunkedFileEnd(this);
     _inProgress = false;
+    _simplifier.clear(false);
 }
@@ -4,17 +4,37 @@
 #pragma once
 
 #include "FileManager.h"
+#include "EvaluatorFiles_Simplifier.h"
+#include "EvaluatorGCode.h"
 
 class WorkManager;
 class WorkItem;
 
+// Counts from simplifying the moves in files - plain values so they can be published to other tasks
+struct FilesSimplifyStatus
+{
+    bool isEnabled;
+    int numPointsIn;
+    int numPointsOut;
+
+    FilesSimplifyStatus()
+    {
+        isEnabled = false;
+        numPointsIn = 0;
+        numPointsOut = 0;
+    }
+
+    // JSON fields for the status (empty if not enabled or nothing simplified)
+    void toJSON(String& statusJSON) const;
+};
+
 class EvaluatorFiles
 {
 public:
     EvaluatorFiles(FileManager& fileManager, WorkManager& workManager);
 
     // Config
-    void setConfig(const char* configStr);
+    void setConfig(const char* configStr, const char* robotAttributes);
     const char* getConfig();
 
     // Is Busy
@@ -32,6 +52,9 @@ public:
     // Control
     void stop();
 
+    // Status of simplification
+    void getSimplifyStatus(FilesSimplifyStatus& status);
+
     // File types
     enum {
         FILE_TYPE_UNKNOWN,
@@ -56,7 +79,17 @@ private:
     // Settings
     bool _interpolate;
 
+    // Simplification of moves as the file is read
+    EvaluatorFiles_Simplifier _simplifier;
+    double _bedRadiusMM;
+    GCodeModalState _gcodeModalState;
+    int _gcodeLastCmdNum;
+    float _gcodeLastFeedrate;
+
 private:
     int getFileTypeFromExtension(String& fileName);
+    void simplifyGCodeLine(String& line);
+    void simplifyThetaRhoLine(String& line, String& workItemStr);
+    void addLineWorkItem(const String& line);
 
 };
@@ -0,0 +1,161 @@
+// RBotFirmware
+// Rob Dobson 2017-2018
+
+#include "EvaluatorFiles_Simplifier.h"
+#include <math.h>
+
+EvaluatorFiles_Simplifier::EvaluatorFiles_Simplifier()
+{
+    _toleranceMM = 0;
+    _numPts = 0;
+    clear(true);
+}
+
+void EvaluatorFiles_Simplifier::setTolerance(double toleranceMM)
+{
+    _toleranceMM = toleranceMM;
+}
+
+void EvaluatorFiles_Simplifier::clear(bool clearCounts)
+{
+    _anchorValid = false;
+    _anchorX = 0;
+    _anchorY = 0;
+    for (int ptIdx = 0; ptIdx < _numPts; ptIdx++)
+        _ptLines[ptIdx] = "";
+    _numPts = 0;
+    _outLines.clear();
+    _outLineIdx = 0;
+    if (clearCounts)
+    {
+        _numPointsIn = 0;
+        _numPointsOut = 0;
+    }
+}
+
+void EvaluatorFiles_Simplifier::addPoint(double x, double y, const String& line, bool mustKeep)
+{
+    _numPointsIn++;
+
+    // Points which must be kept (or have nothing to simplify from) are output straight away
+    if (!isEnabled() || mustKeep || !_anchorValid)
+    {
+        flush();
+        _outLines.push_back(line);
+        _numPointsOut++;
+        _anchorValid = true;
+        _anchorX = x;
+        _anchorY = y;
+        return;
+    }
+
+    // Add to window
+    _ptX[_numPts] = x;
+    _ptY[_numPts] = y;
+    _ptLines[_numPts] = line;
+    _numPts++;
+    if (_numPts >= MAX_WINDOW_PTS)
+        simplifyWindow();
+}
+
+void EvaluatorFiles_Simplifier::addOtherLine(const String& line)
+{
+    flush();
+    _outLines.push_back(line);
+    _anchorValid = false;
+}
+
+void EvaluatorFiles_Simplifier::flush()
+{
+    if (_numPts > 0)
+        simplifyWindow();
+}
+
+bool EvaluatorFiles_Simplifier::getNextLine(String& line)
+{
+    if (!hasOutput())
+        return false;
+    line = _outLines[_outLineIdx++];
+    _outLines[_outLineIdx - 1] = "";
+    if (_outLineIdx >= _outLines.size())
+    {
+        _outLines.clear();
+        _outLineIdx = 0;
+    }
+    return true;
+}
+
+void EvaluatorFiles_Simplifier::simplifyWindow()
+{
+    // The polyline runs from the anchor through the window points - the last point is always kept
+    for (int ptIdx = 0; ptIdx < _numPts - 1; ptIdx++)
+        _ptKeep[ptIdx] = false;
+    _ptKeep[_numPts - 1] = true;
+
+    // Segments still to check held on a stack - start index -1 is the anchor
+    int segStart[MAX_WINDOW_PTS];
+    int segEnd[MAX_WINDOW_PTS];
+    int stackLen = 0;
+    segStart[stackLen] = -1;
+    segEnd[stackLen] = _numPts - 1;
+    stackLen++;
+    while (stackLen > 0)
+    {
+        stackLen--;
+        int startIdx = segStart[stackLen];
+        int endIdx = segEnd[stackLen];
+        double startX = startIdx < 0 ? _anchorX : _ptX[startIdx];
+        double startY = startIdx < 0 ? _anchorY : _ptY[startIdx];
+
+        // Find the point furthest from the segment
+        double maxDist = 0;
+        int maxIdx = -1;
+        for (int ptIdx = startIdx + 1; ptIdx < endIdx; ptIdx++)
+        {
+            double dist = distFromSegment(ptIdx, startX, startY, _ptX[endIdx], _ptY[endIdx]);
+            if (dist > maxDist)
+            {
+                maxDist = dist;
+                maxIdx = ptIdx;
+            }
+        }
+
+        // Keep it and check each side if out of tolerance
+        if ((maxIdx >= 0) && (maxDist > _toleranceMM))
+        {
+            _ptKeep[maxIdx] = true;
+            segStart[stackLen] = startIdx;
+            segEnd[stackLen] = maxIdx;
+            stackLen++;
+            segStart[stackLen] = maxIdx;
+            segEnd[stackLen] = endIdx;
+            stackLen++;
+        }
+    }
+
+    // Output the lines of points kept
+    for (int ptIdx = 0; ptIdx < _numPts; ptIdx++)
+    {
+        if (_ptKeep[ptIdx])
+        {
+            _outLines.push_back(_ptLines[ptIdx]);
+            _numPointsOut++;
+        }
+        _ptLines[ptIdx] = "";
+    }
+    _anchorX = _ptX[_numPts - 1];
+    _anchorY = _ptY[_numPts - 1];
+    _numPts = 0;
+}
+
+double EvaluatorFiles_Simplifier::distFromSegment(int ptIdx, double startX, double startY, double endX, double endY)
+{
+    double segX = endX - startX;
+    double segY = endY - startY;
+    double ptX = _ptX[ptIdx] - startX;
+    double ptY = _ptY[ptIdx] - startY;
+    double lenSq = segX * segX + segY * segY;
+    double t = (lenSq > 0) ? (ptX * segX + ptY * segY) / lenSq : 0;
+    t = fmax(0, fmin(1, t));
+    return sqrt(pow(ptX - t * segX, 2) + pow(ptY - t * segY, 2));
+}
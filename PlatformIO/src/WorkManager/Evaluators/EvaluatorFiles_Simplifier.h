@@ -0,0 +1,81 @@
+// RBotFirmware
+// Rob Dobson 2017-2018
+
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+// Simplifies the polyline formed by the moves in a file as it is read (Ramer-Douglas-Peucker)
+// Points are held in a window of bounded size which is simplified when full (or when a line
+// that isn't a simple move is reached) - the last point of each window is always kept and
+// the lines for points which are kept are output unchanged
+class EvaluatorFiles_Simplifier
+{
+public:
+    static const int MAX_WINDOW_PTS = 32;
+
+    EvaluatorFiles_Simplifier();
+
+    // Tolerance - 0 disables simplification
+    void setTolerance(double toleranceMM);
+    bool isEnabled()
+    {
+        return _toleranceMM > 0;
+    }
+
+    // Clear the held points and output (and optionally the counts)
+    void clear(bool clearCounts);
+
+    // Add a line which is a straight move to x, y - if mustKeep is set the line is not removed
+    void addPoint(double x, double y, const String& line, bool mustKeep);
+
+    // Add a line which is not a simple move - the position is unknown after it
+    void addOtherLine(const String& line);
+
+    // Simplify and output any points held
+    void flush();
+
+    // Get the next line to be output
+    bool getNextLine(String& line);
+    bool hasOutput()
+    {
+        return _outLineIdx < _outLines.size();
+    }
+
+    // Counts of points read and output
+    int getNumPointsIn()
+    {
+        return _numPointsIn;
+    }
+    int getNumPointsOut()
+    {
+        return _numPointsOut;
+    }
+
+private:
+    void simplifyWindow();
+    double distFromSegment(int ptIdx, double startX, double startY, double endX, double endY);
+
+    double _toleranceMM;
+
+    // Last point output - the start of the window
+    bool _anchorValid;
+    double _anchorX;
+    double _anchorY;
+
+    // Window of points
+    double _ptX[MAX_WINDOW_PTS];
+    double _ptY[MAX_WINDOW_PTS];
+    bool _ptKeep[MAX_WINDOW_PTS];
+    String _ptLines[MAX_WINDOW_PTS];
+    int _numPts;
+
+    // Lines to output
+    std::vector<String> _outLines;
+    unsigned int _outLineIdx;
+
+    // Counts
+    int _numPointsIn;
+    int _numPointsOut;
+};
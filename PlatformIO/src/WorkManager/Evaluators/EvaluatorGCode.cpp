@@ -12,109 +12,239 @@
 static const char *MODULE_PREFIX = "EvaluatorGCode: ";
 #endif
 
-bool EvaluatorGCode::getCmdNumber(const char* pCmdStr, int& cmdNum)
+// Parse a number (sign, digits and decimal point) - if there is no number the value is 0 and
+// the position is unchanged
+double EvaluatorGCode::parseNumber(const char*& pStr, const char* pEnd)
 {
-    // String passed in should start with a G or M
-    // And be followed immediately by a number
-    if (strlen(pCmdStr) < 1)
-        return false;
-    const char* pStr = pCmdStr + 1;
-    if (!isdigit(*pStr))
-        return false;
-    long rsltStr = strtol(pStr, NULL, 10);
-    cmdNum = (int) rsltStr;
-    return true;
+    const char* pCur = pStr;
+    bool isNeg = false;
+    if ((pCur < pEnd) && ((*pCur == '-') || (*pCur == '+')))
+        isNeg = (*pCur++ == '-');
+    double val = 0;
+    bool anyDigits = false;
+    while ((pCur < pEnd) && isdigit(*pCur))
+    {
+        val = val * 10 + (*pCur++ - '0');
+        anyDigits = true;
+    }
+    if ((pCur < pEnd) && (*pCur == '.'))
+    {
+        pCur++;
+        double scale = 0.1;
+        while ((pCur < pEnd) && isdigit(*pCur))
+        {
+            val += (*pCur++ - '0') * scale;
+            scale *= 0.1;
+            anyDigits = true;
+        }
+    }
+    if (!anyDigits)
+        return 0;
+    pStr = pCur;
+    return isNeg ? -val : val;
 }
 
-bool EvaluatorGCode::getGcodeCmdArgs(const char* pArgStr, RobotCommandArgs& cmdArgs)
+bool EvaluatorGCode::parseLine(const char* pLine, int lineLen, GCodeModalState& modalState, GCodeLine& gcodeLine)
 {
-    const char* pStr = pArgStr;
-    char* pEndStr = NULL;
-    while (*pStr)
+    gcodeLine.cmdLetter = 0;
+    gcodeLine.cmdNum = 0;
+    gcodeLine.numModalGWords = 0;
+    gcodeLine.lineNum = -1;
+    gcodeLine.cmdArgs.clear();
+    RobotCommandArgs& cmdArgs = gcodeLine.cmdArgs;
+    bool feedrateOnLine = false;
+    bool blendModeOnLine = false;
+
+    const char* pStr = pLine;
+    const char* pEnd = pLine + lineLen;
+
+    // Block delete - a line starting with / is skipped
+    while ((pStr < pEnd) && ((*pStr == ' ') || (*pStr == '\t')))
+        pStr++;
+    if ((pStr < pEnd) && (*pStr == '/'))
+        return false;
+
+    while (pStr < pEnd)
     {
-        switch(toupper(*pStr))
+        char ch = toupper(*pStr);
+        if ((ch == 0) || (ch == ';'))
+            break;
+        pStr++;
+        double unitsScale = modalState.unitsInches ? 25.4 : 1.0;
+        switch(ch)
         {
-            case 'A':
-                cmdArgs.setAxisSteps(0, int(strtod(++pStr, &pEndStr)), true);
-                pStr = pEndStr;
+            case '(':
+                // Comment
+                while ((pStr < pEnd) && (*pStr != ')') && (*pStr != 0))
+                    pStr++;
+                if ((pStr < pEnd) && (*pStr == ')'))
+                    pStr++;
                 break;
-            case 'B':
-                cmdArgs.setAxisSteps(1, int(strtod(++pStr, &pEndStr)), true);
-                pStr = pEndStr;
+            case '*':
+            {
+                // Checksum is the XOR of all characters before the *
+                uint8_t checksum = 0;
+                for (const char* pCk = pLine; pCk < pStr - 1; pCk++)
+                    checksum ^= (uint8_t)*pCk;
+                if ((long)parseNumber(pStr, pEnd) != checksum)
+                {
+#ifdef DEBUG_GCODE_EVALUATOR
+                    Log.trace("%schecksum mismatch %.*s\n", MODULE_PREFIX, lineLen, pLine);
+#endif
+                    return false;
+                }
+                pStr = pEnd;
                 break;
+            }
+            case 'N':
+                gcodeLine.lineNum = (long)parseNumber(pStr, pEnd);
+                break;
+            case 'G':
+            case 'M':
+            {
+                // Command number must follow immediately
+                if ((pStr >= pEnd) || !isdigit(*pStr))
+                    break;
+                int cmdNum = (int)parseNumber(pStr, pEnd);
+                bool isModal = (ch == 'G') && isModalGWord(cmdNum);
+                if (gcodeLine.cmdLetter == 0)
+                {
+                    gcodeLine.cmdLetter = ch;
+                    gcodeLine.cmdNum = cmdNum;
+                }
+                else
+                {
+                    // The command is the word which isn't a modal G word (if there is one) - any
+                    // other words are modal G words which are executed before it
+                    bool cmdIsModal = (gcodeLine.cmdLetter == 'G') && isModalGWord(gcodeLine.cmdNum);
+                    if ((!isModal && !cmdIsModal) || (gcodeLine.numModalGWords >= GCodeLine::MAX_MODAL_G_WORDS))
+                    {
+#ifdef DEBUG_GCODE_EVALUATOR
+                        Log.trace("%scan't execute all commands in %.*s\n", MODULE_PREFIX, lineLen, pLine);
+#endif
+                        return false;
+                    }
+                    if (isModal)
+                    {
+                        gcodeLine.modalGWords[gcodeLine.numModalGWords++] = cmdNum;
+                    }
+                    else
+                    {
+                        gcodeLine.modalGWords[gcodeLine.numModalGWords++] = gcodeLine.cmdNum;
+                        gcodeLine.cmdLetter = ch;
+                        gcodeLine.cmdNum = cmdNum;
+                    }
+                }
+                // Modal commands
+                if (ch == 'G')
+                {
+                    if ((cmdNum == 20) || (cmdNum == 21))
+                        modalState.unitsInches = (cmdNum == 20);
+                    else if ((cmdNum == 90) || (cmdNum == 91))
+                        modalState.isRelative = (cmdNum == 91);
+                    else if ((cmdNum == 61) || (cmdNum == 64))
+                    {
+                        modalState.pathBlendToleranceMM = (cmdNum == 64) ? -1 : 0;
+                        blendModeOnLine = (cmdNum == 64);
+                    }
+                }
+                break;
+            }
+            case 'A':
+            case 'B':
             case 'C':
-                cmdArgs.setAxisSteps(2, int(strtod(++pStr, &pEndStr)), true);
-                pStr = pEndStr;
+                cmdArgs.setAxisSteps(ch - 'A', int(parseNumber(pStr, pEnd)), true);
                 break;
             case 'X':
-                cmdArgs.setAxisValMM(0, strtod(++pStr, &pEndStr), true);
-                pStr = pEndStr;
-                break;
             case 'Y':
-                cmdArgs.setAxisValMM(1, strtod(++pStr, &pEndStr), true);
-                pStr = pEndStr;
-                break;
             case 'Z':
-                cmdArgs.setAxisValMM(2, strtod(++pStr, &pEndStr), true);
-                pStr = pEndStr;
+                cmdArgs.setAxisValMM(ch - 'X', parseNumber(pStr, pEnd) * unitsScale, true);
                 break;
             case 'E':
-                cmdArgs.setExtrude(strtod(++pStr, &pEndStr));
-                pStr = pEndStr;
+                cmdArgs.setExtrude(parseNumber(pStr, pEnd));
                 break;
             case 'F':
-                cmdArgs.setFeedrate(strtod(++pStr, &pEndStr));
-                pStr = pEndStr;
+                modalState.feedrate = parseNumber(pStr, pEnd) * unitsScale;
+                modalState.feedrateValid = true;
+                cmdArgs.setFeedrate(modalState.feedrate);
+                feedrateOnLine = true;
+                break;
+            case 'I':
+            case 'J':
+                cmdArgs.setArcCentreOffset(ch - 'I', parseNumber(pStr, pEnd) * unitsScale);
                 break;
             case 'R':
-                cmdArgs.setMoveType(RobotMoveTypeArg_Relative);
-                pStr++;
+            {
+                // R with a value is an arc radius - on its own it indicates relative motion
+                const char* pNum = pStr;
+                double radius = parseNumber(pStr, pEnd);
+                if (pStr != pNum)
+                    cmdArgs.setArcRadius(radius * unitsScale);
+                else
+                    cmdArgs.setMoveType(RobotMoveTypeArg_Relative);
+                break;
+            }
+            case 'P':
+                // Path blending tolerance (G64)
+                cmdArgs.setPathBlendTolerance(parseNumber(pStr, pEnd) * unitsScale);
                 break;
             case 'S':
             {
-                    int endstopIdx = strtol(++pStr, &pEndStr, 10);
-                    pStr = pEndStr;
-                    if (endstopIdx == 1)
-                        cmdArgs.setTestAllEndStops();
-                    else if (endstopIdx == 0)
-                        cmdArgs.setTestNoEndStops();
-#ifdef DEBUG_GCODE_EVALUATOR
-                    Log.trace("%sSet to check endstops %s\n", MODULE_PREFIX, cmdArgs.toJSON().c_str());
-#endif
-                    break;
+                int endstopIdx = (int)parseNumber(pStr, pEnd);
+                if (endstopIdx == 1)
+                    cmdArgs.setTestAllEndStops();
+                else if (endstopIdx == 0)
+                    cmdArgs.setTestNoEndStops();
+                break;
             }
             default:
-            {
-                pStr++;
                 break;
-            }
         }
     }
-    return true;
+
+    // Feedrate is modal for linear and arc moves
+    bool isFeedMove = (gcodeLine.cmdLetter == 'G') && (gcodeLine.cmdNum >= 1) && (gcodeLine.cmdNum <= 3);
+    if (isFeedMove && !feedrateOnLine && modalState.feedrateValid)
+        cmdArgs.setFeedrate(modalState.feedrate);
+
+    // Moves are absolute or relative according to the modal state of this source of G-code
+    bool isMove = (gcodeLine.cmdLetter == 'G') && (gcodeLine.cmdNum >= 0) && (gcodeLine.cmdNum <= 3);
+    if (isMove && (cmdArgs.getMoveType() == RobotMoveTypeArg_None))
+        cmdArgs.setMoveType(modalState.isRelative ? RobotMoveTypeArg_Relative : RobotMoveTypeArg_Absolute);
+
+    // Path blending is modal too - G64 takes the tolerance from P if given
+    if (blendModeOnLine && cmdArgs.isPathBlendValid())
+        modalState.pathBlendToleranceMM = cmdArgs.getPathBlendTolerance();
+    if (isMove)
+        cmdArgs.setPathBlendTolerance(modalState.pathBlendToleranceMM);
+    return gcodeLine.cmdLetter != 0;
 }
 
-// Interpret GCode G commands
-bool EvaluatorGCode::interpG(String& cmdStr, RobotController* pRobotController, bool takeAction)
+bool EvaluatorGCode::isModalGWord(int cmdNum)
 {
-    // Command string as a text buffer
-    const char* pCmdStr = cmdStr.c_str();
-
-    // Command number
-    int cmdNum = 0;
-    bool rslt = getCmdNumber(cmdStr.c_str(), cmdNum);
-    if (!rslt)
-        return false;
+    switch(cmdNum)
+    {
+        case 17: // XY plane
+        case 20: // Units inches
+        case 21: // Units mm
+        case 61: // Exact path
+        case 64: // Path blending
+        case 90: // Move absolute
+        case 91: // Movements relative
+            return true;
+    }
+    return false;
+}
 
-    // Get args string (separated from the GXX or MXX by a space)
-    const char* pArgsStr = "";
-    const char* pArgsPos = strstr(pCmdStr, " ");
-    if (pArgsPos != 0)
-        pArgsStr = pArgsPos + 1;
-    RobotCommandArgs cmdArgs;
-    rslt = getGcodeCmdArgs(pArgsStr, cmdArgs);
+// Interpret GCode G commands
+bool EvaluatorGCode::interpG(GCodeLine& gcodeLine, RobotController* pRobotController, bool takeAction)
+{
+    RobotCommandArgs& cmdArgs = gcodeLine.cmdArgs;
+    int cmdNum = gcodeLine.cmdNum;
 
 #ifdef DEBUG_GCODE_EVALUATOR
-    Log.trace("%sCmd G%d %s => X%F(%s) Y%F(%s) Z%F(%s) isStepwise %s feedrate %F isFeedrateValid %s\n", MODULE_PREFIX, cmdNum, pArgsStr,
+    Log.trace("%sCmd G%d N%d => X%F(%s) Y%F(%s) Z%F(%s) isStepwise %s feedrate %F isFeedrateValid %s\n", MODULE_PREFIX, cmdNum,
+            (int)gcodeLine.lineNum,
             cmdArgs.getValMM(0), 
             cmdArgs.isValid(0) ? "Y" : "N",
             cmdArgs.getValMM(1), 
@@ -125,7 +255,6 @@ bool EvaluatorGCode::interpG(String& cmdStr, RobotController* pRobotController,
             cmdArgs.getFeedrate(),
             cmdArgs.isFeedrateValid() ? "Y" : "N");
 #endif
-
     // Switch on number
     switch(cmdNum)
     {
@@ -137,6 +266,17 @@ bool EvaluatorGCode::interpG(String& cmdStr, RobotController* pRobotController,
                 pRobotController->moveTo(cmdArgs);
             }
             return true;
+        case 2: // Arc clockwise
+        case 3: // Arc anticlockwise
+            if (!cmdArgs.isArcCentreValid() && !cmdArgs.isArcRadiusValid())
+                return false;
+            if (takeAction)
+            {
+                cmdArgs.setIsArc(true);
+                cmdArgs.setMoveClockwise(cmdNum == 2);
+                pRobotController->moveTo(cmdArgs);
+            }
+            return true;
         case 6: // Direct stepper move
             if (takeAction)
             {
@@ -144,6 +284,11 @@ bool EvaluatorGCode::interpG(String& cmdStr, RobotController* pRobotController,
                 pRobotController->moveTo(cmdArgs);
             }
             return true;
+        case 17: // XY plane (the only plane supported for arcs)
+            return true;
+        case 20: // Units inches (handled in modal state)
+        case 21: // Units mm
+            return true;
         case 28: // Home axes
             if (takeAction)
             {
@@ -152,19 +297,11 @@ bool EvaluatorGCode::interpG(String& cmdStr, RobotController* pRobotController,
                 pRobotController->goHome(cmdArgs);
             }
             return true;
-        case 90: // Move absolute
-            if (takeAction)
-            {
-                cmdArgs.setMoveType(RobotMoveTypeArg_Absolute);
-                pRobotController->setMotionParams(cmdArgs);
-            }
+        case 61: // Exact path (handled in modal state and set on each move)
+        case 64: // Path blending with optional tolerance P
             return true;
+        case 90: // Move absolute (handled in modal state and set on each move)
         case 91: // Movements relative
-            if (takeAction)
-            {
-                cmdArgs.setMoveType(RobotMoveTypeArg_Relative);
-                pRobotController->setMotionParams(cmdArgs);
-            }
             return true;
         case 92: // Set home
             if (takeAction)
@@ -178,26 +315,39 @@ bool EvaluatorGCode::interpG(String& cmdStr, RobotController* pRobotController,
 }
 
 // Interpret GCode M commands
-bool EvaluatorGCode::interpM(String& cmdStr, RobotController* pRobotController, bool takeAction)
+bool EvaluatorGCode::interpM(GCodeLine& gcodeLine, RobotController* pRobotController, bool takeAction)
 {
     return false;
 }
 
 // Interpret GCode commands
-bool EvaluatorGCode::interpretGcode(WorkItem& workItem, RobotController* pRobotController, bool takeAction)
+bool EvaluatorGCode::interpretGcode(WorkItem& workItem, GCodeModalState& modalState,
+            RobotController* pRobotController, bool takeAction)
 {
-    // Extract code
-    String cmdStr = workItem.getString();
-    cmdStr.trim();
-    if (cmdStr.length() == 0)
+    const char* pCmdStr = workItem.getCString();
+    return interpretGcode(pCmdStr, strlen(pCmdStr), modalState, pRobotController, takeAction);
+}
+
+bool EvaluatorGCode::interpretGcode(const char* pLine, int lineLen, GCodeModalState& modalState,
+            RobotController* pRobotController, bool takeAction)
+{
+    // Lex the line
+    GCodeLine gcodeLine;
+    if (!parseLine(pLine, lineLen, modalState, gcodeLine))
         return false;
 
-    // Check for G or M codes
-    if (toupper(cmdStr.charAt(0)) == 'G')
-        return interpG(cmdStr, pRobotController, takeAction);
-    else if (toupper(cmdStr.charAt(0)) == 'M')
-        return interpM(cmdStr, pRobotController, takeAction);
+    // Modal G words on the line go before the command (e.g. G91 in G91 G1 X10)
+    bool rslt = true;
+    for (int wordIdx = 0; wordIdx < gcodeLine.numModalGWords; wordIdx++)
+    {
+        GCodeLine modalLine = gcodeLine;
+        modalLine.cmdLetter = 'G';
+        modalLine.cmdNum = gcodeLine.modalGWords[wordIdx];
+        rslt = interpG(modalLine, pRobotController, takeAction) && rslt;
+    }
 
-    // Failed
-    return false;
+    // Check for G or M codes
+    if (gcodeLine.cmdLetter == 'G')
+        return interpG(gcodeLine, pRobotController, takeAction) && rslt;
+    return interpM(gcodeLine, pRobotController, takeAction) && rslt;
 }
@@ -4,19 +4,69 @@
 #pragma once
 
 #include "../WorkItem.h"
-class RobotCommandArgs;
+#include "RobotCommandArgs.h"
 class RobotController;
 
+// Modal state carried from one line of G-code to the next
+struct GCodeModalState
+{
+    bool isRelative;
+    bool unitsInches;
+    bool feedrateValid;
+    float feedrate;
+    // Path blending tolerance (G64 P) - 0 for exact path (G61), negative for the configured tolerance
+    float pathBlendToleranceMM;
+
+    GCodeModalState()
+    {
+        clear();
+    }
+    void clear()
+    {
+        isRelative = false;
+        unitsInches = false;
+        feedrateValid = false;
+        feedrate = 0;
+        pathBlendToleranceMM = -1;
+    }
+};
+
+// A line of G-code after lexing - cmdLetter is 'G' or 'M'
+// Modal G words (e.g. G21 or G91) can be on the same line as the command and are held
+// separately in the order they appear
+struct GCodeLine
+{
+    static const int MAX_MODAL_G_WORDS = 4;
+    char cmdLetter;
+    int cmdNum;
+    int modalGWords[MAX_MODAL_G_WORDS];
+    int numModalGWords;
+    long lineNum;
+    RobotCommandArgs cmdArgs;
+};
+
 class EvaluatorGCode
 {
 
 public:
-    static bool getCmdNumber(const char* pCmdStr, int& cmdNum);
-    static bool getGcodeCmdArgs(const char* pArgStr, RobotCommandArgs& cmdArgs);
+    // Lex a line of G-code (which need not be null terminated) in a single pass without allocating
+    // Handles N line numbers, *checksums, ( ) and ; comments and / block delete and updates the
+    // modal state - moves are set to absolute or relative and given the blend tolerance from the modal state
+    // Returns false if there is no G or M command (including a deleted block), more than one
+    // command that isn't a modal G word or the checksum is wrong
+    static bool parseLine(const char* pLine, int lineLen, GCodeModalState& modalState, GCodeLine& gcodeLine);
+    // Modal G words which can be on a line with another command
+    static bool isModalGWord(int cmdNum);
     // Interpret GCode G commands
-    static bool interpG(String& cmdStr, RobotController* pRobotController, bool takeAction);
+    static bool interpG(GCodeLine& gcodeLine, RobotController* pRobotController, bool takeAction);
     // Interpret GCode M commands
-    static bool interpM(String& cmdStr, RobotController* pRobotController, bool takeAction);
-    // Interpret GCode commands
-    static bool interpretGcode(WorkItem& workItem, RobotController* pRobotController, bool takeAction);
+    static bool interpM(GCodeLine& gcodeLine, RobotController* pRobotController, bool takeAction);
+    // Interpret GCode commands - the modal state is that of the source of the G-code (e.g. a file)
+    static bool interpretGcode(WorkItem& workItem, GCodeModalState& modalState,
+                RobotController* pRobotController, bool takeAction);
+    static bool interpretGcode(const char* pLine, int lineLen, GCodeModalState& modalState,
+                RobotController* pRobotController, bool takeAction);
+
+private:
+    static double parseNumber(const char*& pStr, const char* pEnd);
 };
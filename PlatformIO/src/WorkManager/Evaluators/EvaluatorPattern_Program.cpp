@@ -0,0 +1,480 @@
+// RBotFirmware
+// Rob Dobson 2017-2018
+
+#include "EvaluatorPattern_Program.h"
+#include "EvaluatorPattern_Vars.h"
+#include <math.h>
+#include <algorithm>
+
+// Opcodes
+enum
+{
+    OP_MOV, OP_NEG,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_POW, OP_MOD,
+    OP_EQ, OP_LT, OP_GT, OP_LE, OP_GE, OP_OR, OP_AND,
+    OP_ABS, OP_ACOS, OP_ACOSH, OP_ASIN, OP_ASINH, OP_ATAN, OP_ATANH, OP_CEIL, OP_COS, OP_COSH,
+    OP_EXP, OP_FLOOR, OP_LN, OP_LOG10, OP_LOG2, OP_ROUND, OP_SIN, OP_SINH, OP_SQRT, OP_TAN,
+    OP_TANH, OP_TRUNC,
+    OP_ATAN2, OP_MAX, OP_MIN,
+    OP_RANDOM,
+    OP_CONST_PI, OP_CONST_E
+};
+
+// Built-in functions - as tinyexpr (log is base 10)
+struct PatternBuiltin
+{
+    const char* name;
+    uint8_t op;
+    int arity;
+};
+static const PatternBuiltin PATTERN_BUILTINS[] = {
+    { "abs", OP_ABS, 1 }, { "acos", OP_ACOS, 1 }, { "acosh", OP_ACOSH, 1 }, { "asin", OP_ASIN, 1 },
+    { "asinh", OP_ASINH, 1 }, { "atan", OP_ATAN, 1 }, { "atan2", OP_ATAN2, 2 }, { "atanh", OP_ATANH, 1 },
+    { "ceil", OP_CEIL, 1 }, { "cos", OP_COS, 1 }, { "cosh", OP_COSH, 1 }, { "e", OP_CONST_E, 0 },
+    { "exp", OP_EXP, 1 }, { "floor", OP_FLOOR, 1 }, { "ln", OP_LN, 1 }, { "log", OP_LOG10, 1 },
+    { "log2", OP_LOG2, 1 }, { "log10", OP_LOG10, 1 }, { "max", OP_MAX, 2 }, { "min", OP_MIN, 2 },
+    { "pi", OP_CONST_PI, 0 }, { "pow", OP_POW, 2 }, { "random", OP_RANDOM, 0 }, { "round", OP_ROUND, 1 },
+    { "sin", OP_SIN, 1 }, { "sinh", OP_SINH, 1 }, { "sqrt", OP_SQRT, 1 }, { "tan", OP_TAN, 1 },
+    { "tanh", OP_TANH, 1 }, { "trunc", OP_TRUNC, 1 }
+};
+static const int PATTERN_NUM_BUILTINS = sizeof(PATTERN_BUILTINS) / sizeof(PATTERN_BUILTINS[0]);
+
+EvaluatorPattern_Program::EvaluatorPattern_Program()
+{
+    clear();
+}
+
+void EvaluatorPattern_Program::clear()
+{
+    _instrs.clear();
+    _consts.clear();
+    _readVarIdxs.clear();
+    _assignedVarIdxs.clear();
+    _numTempsInAssignment = 0;
+    _maxTemps = 0;
+    _isLinked = false;
+    _numVarsLinked = 0;
+    _code.clear();
+    _regs.clear();
+}
+
+bool EvaluatorPattern_Program::addAssignment(int varIdx, const char* exprStr, EvaluatorPattern_Vars& vars)
+{
+    if ((varIdx < 0) || (varIdx > REF_IDX_MASK))
+        return false;
+
+    // Compile the expression
+    unsigned int instrsBefore = _instrs.size();
+    unsigned int constsBefore = _consts.size();
+    _numTempsInAssignment = 0;
+    ParseState s;
+    s.pNext = exprStr;
+    s.pVars = &vars;
+    nextToken(s);
+    Operand result = parseList(s);
+    if (s.type != TOK_END)
+    {
+        _instrs.resize(instrsBefore);
+        _consts.resize(constsBefore);
+        return false;
+    }
+
+    // Assign the result - the last instruction can put its result straight into the variable
+    uint16_t varRef = REF_VAR | varIdx;
+    if (!result.isConst && ((result.ref & REF_KIND_MASK) == REF_TEMP) &&
+                (_instrs.size() > instrsBefore) && (_instrs.back().dest == result.ref))
+    {
+        _instrs.back().dest = varRef;
+    }
+    else
+    {
+        uint16_t srcRef = operandRef(result);
+        Instr instr = { OP_MOV, varRef, srcRef, srcRef };
+        _instrs.push_back(instr);
+    }
+    if (_numTempsInAssignment > _maxTemps)
+        _maxTemps = _numTempsInAssignment;
+    if (std::find(_assignedVarIdxs.begin(), _assignedVarIdxs.end(), varIdx) == _assignedVarIdxs.end())
+        _assignedVarIdxs.push_back(varIdx);
+    _isLinked = false;
+    return true;
+}
+
+void EvaluatorPattern_Program::run(EvaluatorPattern_Vars& vars)
+{
+    // Variables may have been added since the program was linked
+    int numVars = vars.getNumVars();
+    if (!_isLinked || (numVars != _numVarsLinked))
+        link(numVars);
+
+    // Load variables, run and store the results
+    double* pRegs = _regs.data();
+    for (int varIdx : _readVarIdxs)
+        pRegs[varIdx] = vars.getValByIdx(varIdx);
+    const Instr* pInstr = _code.data();
+    const Instr* pEnd = pInstr + _code.size();
+    for (; pInstr < pEnd; pInstr++)
+        pRegs[pInstr->dest] = evalOp(pInstr->op, pRegs[pInstr->a], pRegs[pInstr->b]);
+    for (int varIdx : _assignedVarIdxs)
+        vars.setValByIdx(varIdx, pRegs[varIdx]);
+}
+
+void EvaluatorPattern_Program::link(int numVars)
+{
+    _numVarsLinked = numVars;
+    _regs.assign(numVars + _consts.size() + _maxTemps, 0);
+    for (unsigned int i = 0; i < _consts.size(); i++)
+        _regs[numVars + i] = _consts[i];
+    _code.resize(_instrs.size());
+    for (unsigned int i = 0; i < _instrs.size(); i++)
+    {
+        _code[i].op = _instrs[i].op;
+        _code[i].dest = refToReg(_instrs[i].dest);
+        _code[i].a = refToReg(_instrs[i].a);
+        _code[i].b = refToReg(_instrs[i].b);
+    }
+    _isLinked = true;
+}
+
+uint16_t EvaluatorPattern_Program::refToReg(uint16_t ref)
+{
+    uint16_t idx = ref & REF_IDX_MASK;
+    switch (ref & REF_KIND_MASK)
+    {
+        case REF_CONST: return _numVarsLinked + idx;
+        case REF_TEMP: return _numVarsLinked + _consts.size() + idx;
+        default: return idx;
+    }
+}
+
+inline double EvaluatorPattern_Program::evalOp(uint8_t op, double a, double b)
+{
+    switch (op)
+    {
+        case OP_MOV: return a;
+        case OP_NEG: return -a;
+        case OP_ADD: return a + b;
+        case OP_SUB: return a - b;
+        case OP_MUL: return a * b;
+        case OP_DIV: return a / b;
+        case OP_POW: return pow(a, b);
+        case OP_MOD: return fmod(a, b);
+        case OP_EQ: return a == b;
+        case OP_LT: return a < b;
+        case OP_GT: return a > b;
+        case OP_LE: return a <= b;
+        case OP_GE: return a >= b;
+        case OP_OR: return a || b;
+        case OP_AND: return a && b;
+        case OP_ABS: return fabs(a);
+        case OP_ACOS: return acos(a);
+        case OP_ACOSH: return acosh(a);
+        case OP_ASIN: return asin(a);
+        case OP_ASINH: return asinh(a);
+        case OP_ATAN: return atan(a);
+        case OP_ATANH: return atanh(a);
+        case OP_CEIL: return ceil(a);
+        case OP_COS: return cos(a);
+        case OP_COSH: return cosh(a);
+        case OP_EXP: return exp(a);
+        case OP_FLOOR: return floor(a);
+        case OP_LN: return log(a);
+        case OP_LOG10: return log10(a);
+        case OP_LOG2: return log2(a);
+        case OP_ROUND: return round(a);
+        case OP_SIN: return sin(a);
+        case OP_SINH: return sinh(a);
+        case OP_SQRT: return sqrt(a);
+        case OP_TAN: return tan(a);
+        case OP_TANH: return tanh(a);
+        case OP_TRUNC: return trunc(a);
+        case OP_ATAN2: return atan2(a, b);
+        case OP_MAX: return a < b ? b : a;
+        case OP_MIN: return a < b ? a : b;
+        case OP_RANDOM: return rand() / ((double)RAND_MAX);
+        case OP_CONST_PI: return 3.14159265358979323846;
+        case OP_CONST_E: return 2.71828182845904523536;
+    }
+    return NAN;
+}
+
+EvaluatorPattern_Program::Operand EvaluatorPattern_Program::constOperand(double value)
+{
+    Operand operand = { true, value, 0 };
+    return operand;
+}
+
+uint16_t EvaluatorPattern_Program::operandRef(const Operand& operand)
+{
+    if (!operand.isConst)
+        return operand.ref;
+    // Share constant registers
+    for (unsigned int i = 0; i < _consts.size(); i++)
+        if (_consts[i] == operand.value)
+            return REF_CONST | i;
+    _consts.push_back(operand.value);
+    return REF_CONST | (_consts.size() - 1);
+}
+
+EvaluatorPattern_Program::Operand EvaluatorPattern_Program::emit(uint8_t op, const Operand& a, const Operand& b)
+{
+    // Fold constants (random numbers must be generated each time)
+    if (a.isConst && b.isConst && (op != OP_RANDOM))
+        return constOperand(evalOp(op, a.value, b.value));
+
+    // Result goes in a new temporary register
+    uint16_t destRef = REF_TEMP | (_numTempsInAssignment++ & REF_IDX_MASK);
+    uint16_t aRef = (op == OP_RANDOM) ? destRef : operandRef(a);
+    uint16_t bRef = (op == OP_RANDOM) ? destRef : operandRef(b);
+    Instr instr = { op, destRef, aRef, bRef };
+    _instrs.push_back(instr);
+    Operand result = { false, 0, destRef };
+    return result;
+}
+
+void EvaluatorPattern_Program::nextToken(ParseState& s)
+{
+    while (true)
+    {
+        char ch = *s.pNext;
+        if (ch == '\0')
+        {
+            s.type = TOK_END;
+            return;
+        }
+
+        // Number
+        if (((ch >= '0') && (ch <= '9')) || (ch == '.'))
+        {
+            s.value = strtod(s.pNext, (char**)&s.pNext);
+            s.type = TOK_NUMBER;
+            return;
+        }
+
+        // Variable or built-in function
+        if (isalpha(ch))
+        {
+            const char* pStart = s.pNext;
+            while (isalnum(*s.pNext) || (*s.pNext == '_'))
+                s.pNext++;
+            String name(pStart);
+            name.remove(s.pNext - pStart);
+            s.idx = s.pVars->getVariableIdx(name.c_str());
+            if (s.idx >= 0)
+            {
+                s.type = TOK_VARIABLE;
+                return;
+            }
+            for (int i = 0; i < PATTERN_NUM_BUILTINS; i++)
+            {
+                if (name.equals(PATTERN_BUILTINS[i].name))
+                {
+                    s.idx = i;
+                    s.type = TOK_FUNCTION;
+                    return;
+                }
+            }
+            s.type = TOK_ERROR;
+            return;
+        }
+
+        // Operators and punctuation
+        s.pNext++;
+        s.type = TOK_INFIX;
+        switch (ch)
+        {
+            case '+': s.idx = OP_ADD; return;
+            case '-': s.idx = OP_SUB; return;
+            case '*': s.idx = OP_MUL; return;
+            case '/': s.idx = OP_DIV; return;
+            case '^': s.idx = OP_POW; return;
+            case '%': s.idx = OP_MOD; return;
+            case '=':
+                s.idx = OP_EQ;
+                if (*s.pNext == '=')
+                    s.pNext++;
+                return;
+            case '>':
+                s.idx = OP_GT;
+                if (*s.pNext == '=')
+                {
+                    s.idx = OP_GE;
+                    s.pNext++;
+                }
+                return;
+            case '<':
+                s.idx = OP_LT;
+                if (*s.pNext == '=')
+                {
+                    s.idx = OP_LE;
+                    s.pNext++;
+                }
+                return;
+            case '|':
+                s.idx = OP_OR;
+                if (*s.pNext == '|')
+                    s.pNext++;
+                return;
+            case '&':
+                s.idx = OP_AND;
+                if (*s.pNext == '&')
+                    s.pNext++;
+                return;
+            case '(': s.type = TOK_OPEN; return;
+            case ')': s.type = TOK_CLOSE; return;
+            case ',': s.type = TOK_SEP; return;
+            case ' ': case '\t': break;
+            case '\n': case '\r': case '\\': case ';': s.type = TOK_END; return;
+            default: s.type = TOK_ERROR; return;
+        }
+    }
+}
+
+// <list> = <expr> {"," <expr>}
+EvaluatorPattern_Program::Operand EvaluatorPattern_Program::parseList(ParseState& s)
+{
+    Operand result = parseExpr(s);
+    while (s.type == TOK_SEP)
+    {
+        nextToken(s);
+        result = parseExpr(s);
+    }
+    return result;
+}
+
+// <expr> = <term> {("+" | "-" | "==" | "=" | ">" | "<" | ">=" | "<=" | "||" | "&&") <term>}
+EvaluatorPattern_Program::Operand EvaluatorPattern_Program::parseExpr(ParseState& s)
+{
+    Operand result = parseTerm(s);
+    while ((s.type == TOK_INFIX) && (s.idx != OP_MUL) && (s.idx != OP_DIV) && (s.idx != OP_MOD) && (s.idx != OP_POW))
+    {
+        uint8_t op = s.idx;
+        nextToken(s);
+        Operand rhs = parseTerm(s);
+        result = emit(op, result, rhs);
+    }
+    return result;
+}
+
+// <term> = <factor> {("*" | "/" | "%") <factor>}
+EvaluatorPattern_Program::Operand EvaluatorPattern_Program::parseTerm(ParseState& s)
+{
+    Operand result = parseFactor(s);
+    while ((s.type == TOK_INFIX) && ((s.idx == OP_MUL) || (s.idx == OP_DIV) || (s.idx == OP_MOD)))
+    {
+        uint8_t op = s.idx;
+        nextToken(s);
+        Operand rhs = parseFactor(s);
+        result = emit(op, result, rhs);
+    }
+    return result;
+}
+
+// <factor> = <power> {"^" <power>}
+EvaluatorPattern_Program::Operand EvaluatorPattern_Program::parseFactor(ParseState& s)
+{
+    Operand result = parsePower(s);
+    while ((s.type == TOK_INFIX) && (s.idx == OP_POW))
+    {
+        nextToken(s);
+        Operand rhs = parsePower(s);
+        result = emit(OP_POW, result, rhs);
+    }
+    return result;
+}
+
+// <power> = {("-" | "+")} <base>
+EvaluatorPattern_Program::Operand EvaluatorPattern_Program::parsePower(ParseState& s)
+{
+    bool negate = false;
+    while ((s.type == TOK_INFIX) && ((s.idx == OP_ADD) || (s.idx == OP_SUB)))
+    {
+        if (s.idx == OP_SUB)
+            negate = !negate;
+        nextToken(s);
+    }
+    Operand result = parseBase(s);
+    if (negate)
+        result = emit(OP_NEG, result, result);
+    return result;
+}
+
+// <base> = <constant> | <variable> | <function-0> {"(" ")"} | <function-1> <power> |
+//          <function-2> "(" <expr> "," <expr> ")" | "(" <list> ")"
+EvaluatorPattern_Program::Operand EvaluatorPattern_Program::parseBase(ParseState& s)
+{
+    Operand result = constOperand(NAN);
+    switch (s.type)
+    {
+        case TOK_NUMBER:
+            result = constOperand(s.value);
+            nextToken(s);
+            break;
+        case TOK_VARIABLE:
+            result.isConst = false;
+            result.ref = REF_VAR | (s.idx & REF_IDX_MASK);
+            if (std::find(_readVarIdxs.begin(), _readVarIdxs.end(), s.idx) == _readVarIdxs.end())
+                _readVarIdxs.push_back(s.idx);
+            nextToken(s);
+            break;
+        case TOK_FUNCTION:
+        {
+            const PatternBuiltin& builtin = PATTERN_BUILTINS[s.idx];
+            nextToken(s);
+            if (builtin.arity == 0)
+            {
+                result = emit(builtin.op, constOperand(0), constOperand(0));
+                if (s.type == TOK_OPEN)
+                {
+                    nextToken(s);
+                    if (s.type != TOK_CLOSE)
+                        s.type = TOK_ERROR;
+                    else
+                        nextToken(s);
+                }
+            }
+            else if (builtin.arity == 1)
+            {
+                Operand arg = parsePower(s);
+                result = emit(builtin.op, arg, arg);
+            }
+            else
+            {
+                if (s.type != TOK_OPEN)
+                {
+                    s.type = TOK_ERROR;
+                    break;
+                }
+                nextToken(s);
+                Operand arg0 = parseExpr(s);
+                if (s.type != TOK_SEP)
+                {
+                    s.type = TOK_ERROR;
+                    break;
+                }
+                nextToken(s);
+                Operand arg1 = parseExpr(s);
+                if (s.type != TOK_CLOSE)
+                {
+                    s.type = TOK_ERROR;
+                    break;
+                }
+                nextToken(s);
+                result = emit(builtin.op, arg0, arg1);
+            }
+            break;
+        }
+        case TOK_OPEN:
+            nextToken(s);
+            result = parseList(s);
+            if (s.type != TOK_CLOSE)
+                s.type = TOK_ERROR;
+            else
+                nextToken(s);
+            break;
+        default:
+            s.type = TOK_ERROR;
+            break;
+    }
+    return result;
+}
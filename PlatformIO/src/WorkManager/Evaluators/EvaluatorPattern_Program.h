@@ -0,0 +1,108 @@
+// RBotFirmware
+// Rob Dobson 2017-2018
+
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+class EvaluatorPattern_Vars;
+
+// Assignments from a pattern (e.g. all those in the loop) compiled to a register based bytecode
+// which is run in a single pass - the expression syntax is the same as tinyexpr
+// Registers are the pattern variables followed by constants and then intermediate results
+// Sub-expressions which only involve constants are evaluated when compiling
+class EvaluatorPattern_Program
+{
+public:
+    EvaluatorPattern_Program();
+
+    void clear();
+
+    // Compile an expression and add an assignment of its result to a variable
+    // Returns false (leaving the program unchanged) if the expression is invalid
+    bool addAssignment(int varIdx, const char* exprStr, EvaluatorPattern_Vars& vars);
+
+    // Run all the assignments
+    void run(EvaluatorPattern_Vars& vars);
+
+    int getNumInstructions()
+    {
+        return _instrs.size();
+    }
+
+private:
+    // Instruction - the result of the operation on registers a and b is put in register dest
+    struct Instr
+    {
+        uint8_t op;
+        uint16_t dest;
+        uint16_t a;
+        uint16_t b;
+    };
+
+    // Operand references used when compiling - the kind is in the top bits and the
+    // references are turned into register indices when the program is linked
+    static const uint16_t REF_KIND_MASK = 0xc000;
+    static const uint16_t REF_VAR = 0x0000;
+    static const uint16_t REF_CONST = 0x4000;
+    static const uint16_t REF_TEMP = 0x8000;
+    static const uint16_t REF_IDX_MASK = 0x3fff;
+
+    // Result of compiling part of an expression
+    struct Operand
+    {
+        bool isConst;
+        double value;
+        uint16_t ref;
+    };
+
+    // Parser state
+    enum TokenType
+    {
+        TOK_END, TOK_ERROR, TOK_NUMBER, TOK_VARIABLE, TOK_FUNCTION, TOK_INFIX, TOK_OPEN, TOK_CLOSE, TOK_SEP
+    };
+    struct ParseState
+    {
+        const char* pNext;
+        TokenType type;
+        double value;
+        int idx;
+        EvaluatorPattern_Vars* pVars;
+    };
+
+    // Parser
+    void nextToken(ParseState& s);
+    Operand parseList(ParseState& s);
+    Operand parseExpr(ParseState& s);
+    Operand parseTerm(ParseState& s);
+    Operand parseFactor(ParseState& s);
+    Operand parsePower(ParseState& s);
+    Operand parseBase(ParseState& s);
+
+    // Code generation
+    Operand emit(uint8_t op, const Operand& a, const Operand& b);
+    uint16_t operandRef(const Operand& operand);
+    static Operand constOperand(double value);
+
+    // Resolve operand references to registers
+    void link(int numVars);
+    uint16_t refToReg(uint16_t ref);
+
+    // Perform an operation
+    static inline double evalOp(uint8_t op, double a, double b);
+
+    // Compiled code and constants
+    std::vector<Instr> _instrs;
+    std::vector<double> _consts;
+    std::vector<int> _readVarIdxs;
+    std::vector<int> _assignedVarIdxs;
+    int _numTempsInAssignment;
+    int _maxTemps;
+
+    // Linked code and registers
+    bool _isLinked;
+    int _numVarsLinked;
+    std::vector<Instr> _code;
+    std::vector<double> _regs;
+};
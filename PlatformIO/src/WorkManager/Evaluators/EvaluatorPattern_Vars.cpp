@@ -8,6 +8,16 @@
 
 static const char* MODULE_PREFIX = "EvaluatorPattern_Vars: ";
 
+// Names of variables with fixed indices
+static const char* RESERVED_VAR_NAMES[] = { "x", "y", "z", "stop" };
+
+EvaluatorPattern_Vars::EvaluatorPattern_Vars()
+{
+    _nameIndexMask = 0;
+    _numNamesIndexed = 0;
+    cleanUp();
+}
+
 EvaluatorPattern_Vars::~EvaluatorPattern_Vars()
 {
     cleanUp();
@@ -16,18 +26,31 @@ EvaluatorPattern_Vars::~EvaluatorPattern_Vars()
 void EvaluatorPattern_Vars::cleanUp()
 {
     // Clean up variable names and values
-    for (int i = 0; i < _numTeVars; i++)
+    for (unsigned int i = 0; i < _teVars.size(); i++)
     {
-        delete[] _pTeVars[i].name;
-        if (_pTeVarFlags[i] & TEVARS_FREE_VALUE_ADDR_REQD)
-            delete ((double*)_pTeVars[i].address);
+        if (i >= NUM_RESERVED_VARS)
+            delete[] _teVars[i].name;
+        if (_teVarFlags[i] & TEVARS_FREE_VALUE_ADDR_REQD)
+            delete ((double*)_teVars[i].address);
     }
-    // Clean array of variables
-    delete[] _pTeVars;
-    _pTeVars = NULL;
-    delete[] _pTeVarFlags;
-    _pTeVarFlags = NULL;
-    _numTeVars = 0;
+
+    // Reserved variables remain but are undefined
+    _teVars.resize(NUM_RESERVED_VARS);
+    _teVarFlags.resize(NUM_RESERVED_VARS);
+    for (int i = 0; i < NUM_RESERVED_VARS; i++)
+    {
+        _reservedVals[i] = 0;
+        _teVars[i].name = "";
+        _teVars[i].address = &_reservedVals[i];
+        _teVars[i].type = 0;
+        _teVars[i].context = NULL;
+        _teVarFlags[i] = 0;
+    }
+
+    // Clear name index
+    _nameIndex.assign(16, -1);
+    _nameIndexMask = _nameIndex.size() - 1;
+    _numNamesIndexed = 0;
 }
 
 void EvaluatorPattern_Vars::splitAssignmentExpr(const char* inStr, String& varName, String& expr)
@@ -46,84 +69,112 @@ void EvaluatorPattern_Vars::splitAssignmentExpr(const char* inStr, String& varNa
 
 int EvaluatorPattern_Vars::getVariableIdx(const char* name, bool caseInsensitive)
 {
-    for (int i = 0; i < _numTeVars; i++)
+    // Names which only differ in case are in the same chain - when matching case insensitively
+    // the first variable added wins
+    int foundIdx = -1;
+    uint32_t pos = nameHash(name) & _nameIndexMask;
+    while (_nameIndex[pos] >= 0)
     {
-        if ((caseInsensitive && strcasecmp(name, _pTeVars[i].name) == 0) ||
-            (!caseInsensitive && strcmp(name, _pTeVars[i].name) == 0))
+        int varIdx = _nameIndex[pos];
+        if (!caseInsensitive && (strcmp(name, _teVars[varIdx].name) == 0))
+            return varIdx;
+        if (caseInsensitive && (strcasecmp(name, _teVars[varIdx].name) == 0))
         {
-            return i;
+            if ((foundIdx < 0) || (varIdx < foundIdx))
+                foundIdx = varIdx;
         }
+        pos = (pos + 1) & _nameIndexMask;
     }
-    return -1;
+    return foundIdx;
 }
 
 int EvaluatorPattern_Vars::getVariableFlags(int varIdx)
 {
-    if ((varIdx >= 0) && (varIdx < _numTeVars))
-        return _pTeVarFlags[varIdx];
+    if ((varIdx >= 0) && (varIdx < (int)_teVars.size()))
+        return _teVarFlags[varIdx];
     return 0;
 }
 
 String EvaluatorPattern_Vars::getVariableName(int varIdx)
 {
-    if ((varIdx < 0) || (varIdx >= _numTeVars))
+    if ((varIdx < 0) || (varIdx >= (int)_teVars.size()))
         return "";
-    return _pTeVars[varIdx].name;
+    return _teVars[varIdx].name;
+}
+
+bool EvaluatorPattern_Vars::isDefined(int varIdx)
+{
+    return (getVariableFlags(varIdx) & TEVARS_DEFINED) != 0;
 }
 
-int EvaluatorPattern_Vars::addVariablePtr(const char* name, const double* pVal, unsigned int flags)
+// FNV-1a hash of lower-case name
+uint32_t EvaluatorPattern_Vars::nameHash(const char* name)
 {
-    // Check empty
-    int newVarIdx = 0;
-    if (_numTeVars == 0)
+    uint32_t hash = 2166136261u;
+    for (const char* pCh = name; *pCh; pCh++)
     {
-        // Add first variable to array
-        _pTeVars = new te_variable[1];
-        _pTeVarFlags = new unsigned int[1];
-        _numTeVars = 1;
-        newVarIdx = 0;
+        hash ^= (uint8_t)tolower(*pCh);
+        hash *= 16777619u;
     }
-    else
+    return hash;
+}
+
+void EvaluatorPattern_Vars::addToNameIndex(int varIdx)
+{
+    // Keep the index at most half full
+    if ((_numNamesIndexed + 1) * 2 > (int)_nameIndex.size())
+    {
+        _nameIndex.assign(_nameIndex.size() * 2, -1);
+        _nameIndexMask = _nameIndex.size() - 1;
+        _numNamesIndexed = 0;
+        for (unsigned int i = 0; i < _teVars.size(); i++)
+            if ((_teVarFlags[i] & TEVARS_DEFINED) && ((int)i != varIdx))
+                addToNameIndex(i);
+    }
+    uint32_t pos = nameHash(_teVars[varIdx].name) & _nameIndexMask;
+    while (_nameIndex[pos] >= 0)
+        pos = (pos + 1) & _nameIndexMask;
+    _nameIndex[pos] = varIdx;
+    _numNamesIndexed++;
+}
+
+int EvaluatorPattern_Vars::addVariable(const char* name, double val)
+{
+    // Reserved variables use their fixed slot
+    int newVarIdx = -1;
+    for (int i = 0; i < NUM_RESERVED_VARS; i++)
     {
-        // Copy existing
-        te_variable* new_pTeVars = new te_variable[_numTeVars+1];
-        unsigned int* new_pTeVarFlags = new unsigned int[_numTeVars+1];
-        for (int i = 0; i < _numTeVars; i++)
+        if (strcmp(name, RESERVED_VAR_NAMES[i]) == 0)
         {
-            new_pTeVars[i] = _pTeVars[i];
-            new_pTeVarFlags[i] = _pTeVarFlags[i];
+            newVarIdx = i;
+            _teVars[i].name = RESERVED_VAR_NAMES[i];
+            _teVarFlags[i] = TEVARS_DEFINED;
+            _reservedVals[i] = val;
+            break;
         }
-        delete[] _pTeVars;
-        delete[] _pTeVarFlags;
-        _pTeVars = new_pTeVars;
-        _pTeVarFlags = new_pTeVarFlags;
-        newVarIdx = _numTeVars;
-        _numTeVars++;
     }
-    // Check added ok
-    if (!_pTeVars)
+
+    // Others are added to the table (which grows geometrically)
+    if (newVarIdx < 0)
     {
-        _numTeVars = 0;
-        Log.error("%sfailed to add variable\n", MODULE_PREFIX);
-        return -1;
+        char* newName = new char[strlen(name)+1];
+        strcpy(newName, name);
+        double* pVal = new double;
+        *pVal = val;
+        te_variable newVar = { newName, pVal, 0, NULL };
+        _teVars.push_back(newVar);
+        _teVarFlags.push_back(TEVARS_FREE_VALUE_ADDR_REQD | TEVARS_DEFINED);
+        newVarIdx = _teVars.size() - 1;
     }
-    // Add the variable name
-    char* newName = new char[strlen(name)+1];
-    strcpy(newName, name);
-    _pTeVars[newVarIdx].name = newName;
-    // Add the value reference
-    _pTeVars[newVarIdx].address = pVal;
-    _pTeVars[newVarIdx].type = 0;
-    _pTeVars[newVarIdx].context = NULL;
-    _pTeVarFlags[newVarIdx] = flags;
+    addToNameIndex(newVarIdx);
 
     // Show vars
 #ifdef DEBUG_EVALUATOR_EXPRESSIONS
-    Log.trace("%sNumVars = %d\n", MODULE_PREFIX, _numTeVars);
-    for (int i = 0; i < _numTeVars; i++)
+    Log.trace("%sNumVars = %d\n", MODULE_PREFIX, _teVars.size());
+    for (unsigned int i = 0; i < _teVars.size(); i++)
     {
-    	Log.trace("%sVar %d %s = %F flags %x context %d\n", MODULE_PREFIX, i, _pTeVars[i].name,
-                *((double*)(_pTeVars[i].address)), _pTeVarFlags[i], _pTeVars[i].context);
+    	Log.trace("%sVar %d %s = %F flags %x\n", MODULE_PREFIX, i, _teVars[i].name,
+                *((double*)(_teVars[i].address)), _teVarFlags[i]);
     }
 #endif
     return newVarIdx;
@@ -136,14 +187,10 @@ int EvaluatorPattern_Vars::addConstant(const char* name, double val)
     if (varIdx >= 0)
         return varIdx;
 
-    // Create storage (will be freed on cleanup)
-    double* pVal = new double;
-    *pVal = val;
-    unsigned int flags = TEVARS_FREE_VALUE_ADDR_REQD;
-    varIdx = addVariablePtr(name, pVal, flags);
+    varIdx = addVariable(name, val);
 #ifdef DEBUG_EVALUATOR_EXPRESSIONS
-    Log.trace("%sAddConst name %s val %F varIdx %d flags 0x%x numVars %d\n", MODULE_PREFIX,
-            name, val, varIdx, flags, _numTeVars);   
+    Log.trace("%sAddConst name %s val %F varIdx %d numVars %d\n", MODULE_PREFIX,
+            name, val, varIdx, _teVars.size());
 #endif
     return varIdx;
 }
@@ -158,19 +205,14 @@ int EvaluatorPattern_Vars::addAssignment(const char* inStr, String& outExpr)
         int varIdx = getVariableIdx(varName.c_str());
         if (varIdx >= 0)
         {
-            *((double*)(_pTeVars[varIdx].address)) = 0;
+            setValByIdx(varIdx, 0);
         }
         else
         {
-            // Create the value for this variable
-            double* pVal = new double;
-            *pVal = 0;
-            // Create the variable using this value
-            unsigned int flags = TEVARS_FREE_VALUE_ADDR_REQD;
-            varIdx = addVariablePtr(varName.c_str(), pVal, flags);
+            varIdx = addVariable(varName.c_str(), 0);
 #ifdef DEBUG_EVALUATOR_EXPRESSIONS
-            Log.trace("%sAddAssign var %s, expr %s, varIdx %d, flags 0x%x, numVars %d\n", MODULE_PREFIX,
-                varName.c_str(), outExpr.c_str(), varIdx, flags, _numTeVars);
+            Log.trace("%sAddAssign var %s, expr %s, varIdx %d, numVars %d\n", MODULE_PREFIX,
+                varName.c_str(), outExpr.c_str(), varIdx, _teVars.size());
 #endif
         }
 
@@ -181,12 +223,12 @@ int EvaluatorPattern_Vars::addAssignment(const char* inStr, String& outExpr)
 
 te_variable* EvaluatorPattern_Vars::getVars()
 {
-    return _pTeVars;
+    return _teVars.data();
 }
 
 int EvaluatorPattern_Vars::getNumVars()
 {
-    return _numTeVars;
+    return _teVars.size();
 }
 
 double EvaluatorPattern_Vars::getVal(const char* varName, bool& isValid, bool caseInsensitive)
@@ -198,7 +240,7 @@ double EvaluatorPattern_Vars::getVal(const char* varName, bool& isValid, bool ca
         isValid = false;
         return 0;
     }
-    return *((double*)(_pTeVars[varIdx].address));
+    return *((double*)(_teVars[varIdx].address));
 }
 
 void EvaluatorPattern_Vars::setVal(char* varName, double val, bool caseInsensitive)
@@ -206,10 +248,15 @@ void EvaluatorPattern_Vars::setVal(char* varName, double val, bool caseInsensiti
     int varIdx = getVariableIdx(varName, caseInsensitive);
     if (varIdx == -1)
         return;
-    *((double*)(_pTeVars[varIdx].address)) = val;
+    *((double*)(_teVars[varIdx].address)) = val;
+}
+
+double EvaluatorPattern_Vars::getValByIdx(int varIdx)
+{
+    return *((double*)(_teVars[varIdx].address));
 }
 
 void EvaluatorPattern_Vars::setValByIdx(int varIdx, double val)
 {
-    *((double*)(_pTeVars[varIdx].address)) = val;
+    *((double*)(_teVars[varIdx].address)) = val;
 }
@@ -4,36 +4,53 @@
 #pragma once
 
 #include <Arduino.h>
+#include <vector>
 #include "tinyexpr.h"
 
 class EvaluatorPattern_Vars
 {
 public:
-    EvaluatorPattern_Vars()
-    {
-        _pTeVars = NULL;
-        _pTeVarFlags = NULL;
-        _numTeVars = 0;
-    }
+    // Variables used to form each point have fixed indices (they are only found by
+    // name once they have been assigned)
+    static const int VAR_IDX_X = 0;
+    static const int VAR_IDX_Y = 1;
+    static const int VAR_IDX_Z = 2;
+    static const int VAR_IDX_STOP = 3;
+    static const int NUM_RESERVED_VARS = 4;
+
+    EvaluatorPattern_Vars();
 	~EvaluatorPattern_Vars();
 
     void splitAssignmentExpr(const char* inStr, String& varName, String& expr);
     int getVariableIdx(const char* name, bool caseInsensitive = false);
     int getVariableFlags(int varIdx);
     String getVariableName(int varIdx);
+    bool isDefined(int varIdx);
     int addAssignment(const char* inStr, String& outExpr);
     int addConstant(const char* name, double val);
     te_variable* getVars();
 	int getNumVars();
 	double getVal(const char* varName, bool& isValid, bool caseInsensitive = false);
 	void setVal(char* varName, double val, bool caseInsensitive = false);
+	double getValByIdx(int varIdx);
 	void setValByIdx(int varIdx, double val);
 	void cleanUp();
-    
+
 private:
-    int addVariablePtr(const char* name, const double* pVal, unsigned int flags);
-    te_variable* _pTeVars;
-    unsigned int* _pTeVarFlags;
-    int _numTeVars;
+    int addVariable(const char* name, double val);
+    static uint32_t nameHash(const char* name);
+    void addToNameIndex(int varIdx);
+
+    // Variables (reserved ones first) - values are held separately so their addresses
+    // don't change when the table grows
+    std::vector<te_variable> _teVars;
+    std::vector<unsigned int> _teVarFlags;
+    double _reservedVals[NUM_RESERVED_VARS];
     static constexpr int TEVARS_FREE_VALUE_ADDR_REQD = 1;
+    static constexpr int TEVARS_DEFINED = 2;
+
+    // Hashed index of variable names (hash is case insensitive) - open addressing with linear probing
+    std::vector<int> _nameIndex;
+    uint32_t _nameIndexMask;
+    int _numNamesIndexed;
 };
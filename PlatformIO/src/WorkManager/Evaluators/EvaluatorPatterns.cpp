@@ -5,6 +5,8 @@
 
 #include "EvaluatorPatterns.h"
 #include "../WorkManager.h"
+#include "JsonDocumentView.h"
+#include "Utils.h"
 
 static const char* MODULE_PREFIX = "EvaluatorPatterns: ";
 
@@ -12,6 +14,11 @@ EvaluatorPatterns::EvaluatorPatterns(FileManager& fileManager, WorkManager& Work
     _fileManager(fileManager), _workManager(WorkManager)
 {
     _isRunning = false;
+    _xVarIdx = -1;
+    _yVarIdx = -1;
+    _stopVarIdx = -1;
+    _pointsPerService = DEFAULT_POINTS_PER_SERVICE;
+    _maxServiceUs = DEFAULT_MAX_SERVICE_US;
 }
 
 EvaluatorPatterns::~EvaluatorPatterns()
@@ -24,6 +31,13 @@ void EvaluatorPatterns::setConfig(const char* configStr, const char* robotAttrib
     // Store the config string
     _jsonConfigStr = configStr;
     _robotAttribStr = robotAttributes;
+    JsonDocumentView configDoc(configStr);
+    _pointsPerService = configDoc.getLong("patternPointsPerService", DEFAULT_POINTS_PER_SERVICE);
+    if (_pointsPerService < 1)
+        _pointsPerService = 1;
+    _maxServiceUs = configDoc.getLong("patternMaxServiceUs", DEFAULT_MAX_SERVICE_US);
+    Log.trace("%ssetConfig pointsPerService %d maxServiceUs %d\n", MODULE_PREFIX,
+                _pointsPerService, _maxServiceUs);
     // Initalise random seed
     srand(micros());
 }
@@ -78,29 +92,13 @@ void EvaluatorPatterns::addExpression(const char* exprStr, bool isInitialValue)
         // Add the assignment
         int varIdx = _patternVars.addAssignment(inExpr.c_str(), outExpr);
 
-        // Store the compiled expression, variable index and whether an initial value
+        // Compile the expression into the setup or loop program
         if (varIdx >= 0)
         {
-            // Compile expression
-            int err = 0;
-            te_variable* vars = _patternVars.getVars();
-            te_expr* compiledExpr = te_compile(outExpr.c_str(), vars, _patternVars.getNumVars(), &err);
-            Log.trace("%scompile %s hex %x %x %x %x %x %x result %s err %d\n", MODULE_PREFIX, outExpr.c_str(),
-                        outExpr.c_str()[0], outExpr.c_str()[1], outExpr.c_str()[2],
-                        outExpr.c_str()[3], outExpr.c_str()[4], outExpr.c_str()[5],
-                        (compiledExpr ? "OK" : "FAIL"), err);
- 
-            // Store the expression and assigned variable index
-            if (compiledExpr)
-            {
-                VarIdxAndCompiledExpr varIdxAndCompExpr;
-                varIdxAndCompExpr._pCompExpr = compiledExpr;
-                varIdxAndCompExpr._varIdx = varIdx;
-                varIdxAndCompExpr._isInitialValue = isInitialValue;
-                _varIdxAndCompiledExprs.push_back(varIdxAndCompExpr);
-                Log.trace("%saddLoop addedCompiledExpr (Count=%d)\n", MODULE_PREFIX, 
-                            _varIdxAndCompiledExprs.size());
-            }
+            EvaluatorPattern_Program& program = isInitialValue ? _setupProgram : _loopProgram;
+            bool compiledOk = program.addAssignment(varIdx, outExpr.c_str(), _patternVars);
+            Log.trace("%scompile %s result %s (Instrs=%d)\n", MODULE_PREFIX, outExpr.c_str(),
+                        (compiledOk ? "OK" : "FAIL"), program.getNumInstructions());
         }
 
         // Next expression - skip separator (in case of escaped chars need to skip two chars)
@@ -114,58 +112,44 @@ void EvaluatorPatterns::addExpression(const char* exprStr, bool isInitialValue)
 void EvaluatorPatterns::cleanUp()
 {
     _patternVars.cleanUp();
-    for (unsigned int i = 0; i < _varIdxAndCompiledExprs.size(); i++)
-        te_free(_varIdxAndCompiledExprs[i]._pCompExpr);
-    _varIdxAndCompiledExprs.clear();
+    _setupProgram.clear();
+    _loopProgram.clear();
+    _xVarIdx = -1;
+    _yVarIdx = -1;
+    _stopVarIdx = -1;
     _isRunning = false;
 }
 
 void EvaluatorPatterns::evalExpressions(bool procInitialValues, bool procLoopValues)
 {
 #ifdef DEBUG_EVALUATOR_PATTERN
-    Log.trace("%snumExprs %d\n", MODULE_PREFIX, _varIdxAndCompiledExprs.size());
-#endif
-    // Go through all the expressions and evaluate
-    for (unsigned int i = 0; i < _varIdxAndCompiledExprs.size(); i++)
-    {
-        // Variable index and type
-        int varIdx = _varIdxAndCompiledExprs[i]._varIdx;
-        bool isInitialValue = _varIdxAndCompiledExprs[i]._isInitialValue;
-        // Check if it is an initial value - in which case don't evaluate
-        if (!((isInitialValue && procInitialValues) || (!isInitialValue && procLoopValues)))
-        {
-#ifdef DEBUG_EVALUATOR_PATTERN
-            Log.trace("%sexpr continuing procInit %d procLoop %d isInit %d\n",
-                        MODULE_PREFIX, procInitialValues, procLoopValues, isInitialValue);
-#endif
-            continue;
-        }
-        // Compute value of expression
-        double val = te_eval(_varIdxAndCompiledExprs[i]._pCompExpr);
-        _patternVars.setValByIdx(varIdx, val);
-#ifdef DEBUG_EVALUATOR_PATTERN
-        Log.trace("%sexpr %d: %s varIdx %d exprRslt %F isInitialValue=%d\n", MODULE_PREFIX,
-                             i, _patternVars.getVariableName(varIdx).c_str(), varIdx, val, isInitialValue);
+    Log.trace("%sinstrs setup %d loop %d\n", MODULE_PREFIX,
+                _setupProgram.getNumInstructions(), _loopProgram.getNumInstructions());
 #endif
-    }
+    // Each program evaluates all of its assignments in a single pass
+    if (procInitialValues)
+        _setupProgram.run(_patternVars);
+    if (procLoopValues)
+        _loopProgram.run(_patternVars);
 }
 
 // Get XY coordinates of point
 // Return false if invalid
 bool EvaluatorPatterns::getPoint(AxisFloats &pt)
 {
-    bool xValid = false;
-    bool yValid = false;
-    pt._pt[0] = _patternVars.getVal("x", xValid, true);
-    pt._pt[1] = _patternVars.getVal("y", yValid, true);
-    return xValid && yValid;
+    if ((_xVarIdx < 0) || (_yVarIdx < 0))
+        return false;
+    pt._pt[0] = _patternVars.getValByIdx(_xVarIdx);
+    pt._pt[1] = _patternVars.getValByIdx(_yVarIdx);
+    return true;
 }
 
 bool EvaluatorPatterns::getStopVar(bool& stopVar)
 {
-    bool stopValid = false;
-    stopVar = _patternVars.getVal("stop", stopValid, true) != 0.0;
-    return stopValid;
+    if (_stopVarIdx < 0)
+        return false;
+    stopVar = _patternVars.getValByIdx(_stopVarIdx) != 0.0;
+    return true;
 }
 
 void EvaluatorPatterns::start()
@@ -182,47 +166,57 @@ void EvaluatorPatterns::stop()
 
 void EvaluatorPatterns::service()
 {
-    // Check running
-    if (!_isRunning)
-        return;
+    // Generate a batch of points - until the queue is full or time is up
+    uint32_t startUs = micros();
+    for (int i = 0; i < _pointsPerService; i++)
+    {
+        // Check running
+        if (!_isRunning)
+            return;
 
-    // Check if the work manager can accept new stuff
-    if (!_workManager.canAcceptWorkItem())
-        return;
+        // Check if the work manager can accept new stuff
+        if (!_workManager.canAcceptMove())
+            return;
 
-    // Evaluate expressions
-    evalExpressions(false, true);
+        // Check time taken
+        if ((i > 0) && Utils::isTimeout(micros(), startUs, _maxServiceUs))
+            return;
 
-    // Get next point
-    AxisFloats pt;
-    bool isValid = getPoint(pt);
-    if (!isValid)
-    {
-        Log.notice("%sstopped x and y must be specified\n", MODULE_PREFIX);
-        _isRunning = false;
-        return;
-    }
-    char cmdStr[100];
-    sprintf(cmdStr, "G0 X%F Y%F", pt._pt[0], pt._pt[1]);
-    // Log.verbose("%scmdInterp %s\n", MODULE_PREFIX, cmdStr);
-    String retStr;
-    WorkItem workItem(cmdStr);
-    _workManager.addWorkItem(workItem, retStr);
-
-    // Check if we reached a limit
-    bool stopReqd = 0;
-    isValid = getStopVar(stopReqd);
-    if (!isValid)
-    {
-        Log.notice("%sstopped stop variable not specified\n", MODULE_PREFIX);
-        _isRunning = false;
-        return;
-    }
-    else if (stopReqd)
-    {
-        Log.notice("%sPatternEval stopped stop == true\n", MODULE_PREFIX);
-        _isRunning = false;
-        return;
+        // Evaluate expressions
+        evalExpressions(false, true);
+
+        // Get next point
+        AxisFloats pt;
+        bool isValid = getPoint(pt);
+        if (!isValid)
+        {
+            Log.notice("%sstopped x and y must be specified\n", MODULE_PREFIX);
+            _isRunning = false;
+            return;
+        }
+        // Equivalent of G0 X Y without formatting and parsing G-code
+        RobotCommandArgs moveArgs;
+        moveArgs.setAxisValMM(0, pt._pt[0], true);
+        moveArgs.setAxisValMM(1, pt._pt[1], true);
+        moveArgs.setMoveRapid(true);
+        // Log.verbose("%smove X%F Y%F\n", MODULE_PREFIX, pt._pt[0], pt._pt[1]);
+        _workManager.addMove(moveArgs);
+
+        // Check if we reached a limit
+        bool stopReqd = 0;
+        isValid = getStopVar(stopReqd);
+        if (!isValid)
+        {
+            Log.notice("%sstopped stop variable not specified\n", MODULE_PREFIX);
+            _isRunning = false;
+            return;
+        }
+        else if (stopReqd)
+        {
+            Log.notice("%sPatternEval stopped stop == true\n", MODULE_PREFIX);
+            _isRunning = false;
+            return;
+        }
     }
 }
 
@@ -277,6 +271,11 @@ bool EvaluatorPatterns::execWorkItem(WorkItem& workItem)
     addExpression(setupExprs.c_str(), true);
     addExpression(loopExprs.c_str(), false);
 
+    // Variables that make up each point
+    _xVarIdx = _patternVars.getVariableIdx("x", true);
+    _yVarIdx = _patternVars.getVariableIdx("y", true);
+    _stopVarIdx = _patternVars.getVariableIdx("stop", true);
+
     // Start the pattern evaluation process
     start();
     return true;
@@ -4,7 +4,7 @@
 #pragma once
 
 #include "EvaluatorPattern_Vars.h"
-#include "tinyexpr.h"
+#include "EvaluatorPattern_Program.h"
 #include <vector>
 #include "AxisValues.h"
 
@@ -62,16 +62,20 @@ private:
     // All variables used in the pattern
     EvaluatorPattern_Vars _patternVars;
 
-    // Store for a variable index and compiled expression that evaluates to that variable
-    typedef struct VarIdxAndCompiledExpr
-    {
-        te_expr* _pCompExpr;
-        int _varIdx;
-        bool _isInitialValue;
-    } VarIdxAndCompiledExpr;
+    // Compiled setup (initial value) and loop assignments
+    EvaluatorPattern_Program _setupProgram;
+    EvaluatorPattern_Program _loopProgram;
 
-    // List of variable indices and compiled expressions
-    std::vector<VarIdxAndCompiledExpr> _varIdxAndCompiledExprs;
+    // Indices of the variables that make up each point (-1 if not defined by the pattern)
+    int _xVarIdx;
+    int _yVarIdx;
+    int _stopVarIdx;
+
+    // Points generated per service call - limited by queue space and time taken
+    static const int DEFAULT_POINTS_PER_SERVICE = 10;
+    static const int DEFAULT_MAX_SERVICE_US = 2000;
+    int _pointsPerService;
+    uint32_t _maxServiceUs;
 
     // Indicator that the current pattern is running
     bool _isRunning;
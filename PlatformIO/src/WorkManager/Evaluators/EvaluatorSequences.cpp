@@ -20,6 +20,10 @@ EvaluatorSequences::EvaluatorSequences(FileManager& fileManager, WorkManager& wo
     _shuffleMode = false;
     _repeatMode = false;
     _lineCount = 0;
+    _indexLineStart = 0;
+    _indexLineBlank = true;
+    _indexHasShuffle = _indexHasNoShuffle = false;
+    _indexHasRepeat = _indexHasNoRepeat = false;
 }
 
 void EvaluatorSequences::setConfig(const char* configStr)
@@ -61,62 +65,143 @@ bool EvaluatorSequences::isValid(WorkItem& workItem)
     return rslt;
 }
 
-// Count lines
-int EvaluatorSequences::countLines(String& lines)
+// Index lines - a line is blank if it contains nothing but a carriage return
+void EvaluatorSequences::indexLines(const char* pData, int dataLen, int dataPos, bool finalBlock)
 {
-    int lineCount = 0;
-    bool lineBlank = true;
-    const char* pStr = lines.c_str();
-    while(true)
+    for (int i = 0; i < dataLen; i++)
     {
-        if ((*pStr == '\n') || (*pStr == 0))
+        char ch = pData[i];
+        if (ch == '\n')
         {
-            if (!lineBlank)
-                lineCount++;
-            lineBlank = true;
-            if (*pStr == 0)
-                break;
+            indexLineEnd(dataPos + i);
+            continue;
         }
-        else
+        if (ch != '\r')
+            _indexLineBlank = false;
+        _indexLineText += ch;
+
+        // Mode keywords can be anywhere in a line so check the text before it is cut back
+        // (keeping enough of the end to match a keyword which spans the cut)
+        if (_indexLineText.length() >= MAX_SEQUENCE_LINE_LEN)
         {
-            if (*pStr != '\r')
-                lineBlank = false;
+            indexModeKeywords();
+            _indexLineText.remove(0, _indexLineText.length() - (MAX_MODE_KEYWORD_LEN - 1));
         }
-        pStr++;
     }
-    return lineCount;
+    if (finalBlock)
+        indexLineEnd(dataPos + dataLen);
+}
+
+void EvaluatorSequences::indexLineEnd(int lineEndPos)
+{
+    if (!_indexLineBlank)
+    {
+        SequenceLine line = { (uint32_t)_indexLineStart, (uint32_t)(lineEndPos - _indexLineStart) };
+        _lines.push_back(line);
+        indexModeKeywords();
+    }
+    _indexLineStart = lineEndPos + 1;
+    _indexLineBlank = true;
+    _indexLineText = "";
+}
+
+// Check for mode settings in the text of the line being indexed
+void EvaluatorSequences::indexModeKeywords()
+{
+    if (_indexLineText.indexOf("ShuffleMode") >= 0)
+        _indexHasShuffle = true;
+    if (_indexLineText.indexOf("NoShuffleMode") >= 0)
+        _indexHasNoShuffle = true;
+    if (_indexLineText.indexOf("RepeatMode") >= 0)
+        _indexHasRepeat = true;
+    if (_indexLineText.indexOf("NoRepeatMode") >= 0)
+        _indexHasNoRepeat = true;
+}
+
+String EvaluatorSequences::getLine(int lineIdx)
+{
+    const SequenceLine& line = _lines[lineIdx];
+    if (_commandList.length() > 0)
+        return _commandList.substring(line.startPos, line.startPos + line.len);
+
+    // Read from file
+    char lineBuf[MAX_SEQUENCE_LINE_LEN + 1];
+    int lineLen = line.len < MAX_SEQUENCE_LINE_LEN ? line.len : MAX_SEQUENCE_LINE_LEN;
+    int bytesRead = _fileManager.getFileSection("", _fileName, line.startPos, (uint8_t*)lineBuf, lineLen);
+    if (bytesRead < 0)
+        return "";
+    lineBuf[bytesRead] = 0;
+    return lineBuf;
 }
 
 // Process WorkItem
 bool EvaluatorSequences::execWorkItem(WorkItem& workItem)
 {
-    // Find the command info
-    String fileName = workItem.getString();
-    _commandList = _fileManager.getFileContents("", fileName, MAX_SEQUENCE_FILE_LEN);
+    // Short sequences are read into memory and longer ones are read a line at a time
+    _fileName = workItem.getString();
+    _commandList = "";
+    int fileLen = 0;
+    if (!_fileManager.getFileInfo("", _fileName, fileLen) || (fileLen <= 0))
+    {
+        Log.trace("%sexecWorkItem Not Found %s\n", MODULE_PREFIX, _fileName.c_str());
+        return false;
+    }
+    if (fileLen < MAX_SEQUENCE_FILE_LEN - 1)
+        _commandList = _fileManager.getFileContents("", _fileName, MAX_SEQUENCE_FILE_LEN);
+
+    // Index the lines
+    _lines.clear();
+    _indexLineStart = 0;
+    _indexLineBlank = true;
+    _indexLineText = "";
+    _indexHasShuffle = _indexHasNoShuffle = false;
+    _indexHasRepeat = _indexHasNoRepeat = false;
     if (_commandList.length() > 0)
     {
-        _inProgress = true;
-        _shuffleMode = _defaultShuffleMode;
-        _repeatMode = _defaultRepeatMode;
-        _lineCount = countLines(_commandList);
-        if (_commandList.indexOf("ShuffleMode") >= 0)
-            _shuffleMode = true;
-        if (_commandList.indexOf("NoShuffleMode") >= 0)
-            _shuffleMode = false;
-        if (_commandList.indexOf("RepeatMode") >= 0)
-            _repeatMode = true;
-        if (_commandList.indexOf("NoRepeatMode") >= 0)
-            _repeatMode = false;
-        _linesDone = 0;
-        _reqLineIdx = 0;
-        if (_shuffleMode)
-            _reqLineIdx = rand() % _lineCount;
-        Log.trace("%sexecWorkItem len %d lineCount %d reqLineIdx %d shuffleMode %s repeatMode %s\n", MODULE_PREFIX, 
-                _commandList.length(), _lineCount, _reqLineIdx, _shuffleMode ? "Y" : "N",  _repeatMode ? "Y" : "N");
-        return true;
+        indexLines(_commandList.c_str(), _commandList.length(), 0, true);
+    }
+    else
+    {
+        static const int INDEX_BLOCK_LEN = 512;
+        char blockBuf[INDEX_BLOCK_LEN];
+        int blockPos = 0;
+        while (blockPos < fileLen)
+        {
+            int bytesRead = _fileManager.getFileSection("", _fileName, blockPos, (uint8_t*)blockBuf, INDEX_BLOCK_LEN);
+            if (bytesRead <= 0)
+                break;
+            indexLines(blockBuf, bytesRead, blockPos, false);
+            blockPos += bytesRead;
+        }
+        indexLines(blockBuf, 0, blockPos, true);
     }
-    Log.trace("%sexecWorkItem Not Found %s\n", MODULE_PREFIX, _commandList.c_str());
-    return false;
+    _lineCount = _lines.size();
+    if (_lineCount == 0)
+    {
+        Log.trace("%sexecWorkItem no lines in %s\n", MODULE_PREFIX, _fileName.c_str());
+        return false;
+    }
+
+    // Modes
+    _inProgress = true;
+    _shuffleMode = _defaultShuffleMode;
+    _repeatMode = _defaultRepeatMode;
+    if (_indexHasShuffle)
+        _shuffleMode = true;
+    if (_indexHasNoShuffle)
+        _shuffleMode = false;
+    if (_indexHasRepeat)
+        _repeatMode = true;
+    if (_indexHasNoRepeat)
+        _repeatMode = false;
+    _linesDone = 0;
+    _reqLineIdx = 0;
+    if (_shuffleMode)
+        _reqLineIdx = rand() % _lineCount;
+    Log.trace("%sexecWorkItem len %d lineCount %d reqLineIdx %d shuffleMode %s repeatMode %s inMemory %s\n", MODULE_PREFIX,
+            fileLen, _lineCount, _reqLineIdx, _shuffleMode ? "Y" : "N",  _repeatMode ? "Y" : "N",
+            _commandList.length() > 0 ? "Y" : "N");
+    return true;
 }
 
 void EvaluatorSequences::service()
@@ -128,74 +213,41 @@ void EvaluatorSequences::service()
     // Check if operative
     if (!_inProgress)
         return;
-        
-    // Get required line
-    const char* pCommandList = _commandList.c_str();
-    const char* pStr = pCommandList;
-    int lineStartPos = 0;
-    int sepIdx = 0;
-    bool lineBlank = true;
-    while(true)
+
+    // Check line valid
+    if ((_reqLineIdx < 0) || (_reqLineIdx >= _lineCount))
     {
-        if ((*pStr == '\n') || (*pStr == 0))
-        {
-            if (!lineBlank)
-                sepIdx++;
-            if ((sepIdx == _reqLineIdx+1) || (*pStr == 0))
-                break;
-            lineBlank = true;
-            lineStartPos = pStr - pCommandList;
-        }
-        else
-        {
-            if (*pStr != '\r')
-                lineBlank = false;
-        }
-        pStr++;
+        _inProgress = false;
+        Log.trace("%sservice reqLineIdx %d not found so stopping\n", MODULE_PREFIX,
+                _reqLineIdx);
+        return;
     }
-    if (sepIdx == _reqLineIdx+1)
+
+    // Line to process
+    String newCmd = getLine(_reqLineIdx);
+    newCmd.trim();
+    Log.trace("%sservice reqLineIdx %d cmd %s\n", MODULE_PREFIX,
+            _reqLineIdx, newCmd.c_str());
+    if (newCmd.length() > 0)
     {
-        // Line to process
-        String newCmd = _commandList.substring(lineStartPos, pStr-pCommandList);
-        newCmd.trim();
-        // Separator found so add command
-        Log.trace("%sservice reqLineIdx %d cmd %s\n", MODULE_PREFIX, 
-                _reqLineIdx, newCmd.c_str());
-        if (newCmd.length() > 0)
-        {
-            String retStr;
-            WorkItem workItem(newCmd);
-            _workManager.addWorkItem(workItem, retStr, _reqLineIdx);
-        }
-        // Bump
-        _linesDone++;
-        if ((_linesDone == _lineCount) && !_repeatMode)
-        {
-            _inProgress = false;
-            Log.trace("%sservice linesDone %d lineCount %d no repeat so stopping\n", MODULE_PREFIX, 
-                _linesDone, _lineCount);
-        }
-        // Next req item
-        _reqLineIdx++;
-        if (_reqLineIdx >= _lineCount)
-            _reqLineIdx = 0;
-        if (_shuffleMode)
-            _reqLineIdx = rand() % _lineCount;
+        String retStr;
+        WorkItem workItem(newCmd);
+        _workManager.addWorkItem(workItem, retStr, _reqLineIdx);
     }
-    else
+    // Bump
+    _linesDone++;
+    if ((_linesDone == _lineCount) && !_repeatMode)
     {
-        // Separator not found so stop
         _inProgress = false;
-        Log.trace("%sservice reqLineIdx %d not found so stopping\n", MODULE_PREFIX, 
-                _reqLineIdx);
+        Log.trace("%sservice linesDone %d lineCount %d no repeat so stopping\n", MODULE_PREFIX,
+            _linesDone, _lineCount);
     }
-
-    // if (millis() > _lastMillis + 10000)
-    // {
-    //     _lastMillis = millis();
-    //     Log.trace("%sprocess cmdStr %s cmdIdx %d numToProc %d isEmpty %d\n", MODULE_PREFIX, _commandList.c_str(), _curCmdIdx, _numCmdsToProcess,
-    //                     _workManager.queueIsEmpty());
-    // }
+    // Next req item
+    _reqLineIdx++;
+    if (_reqLineIdx >= _lineCount)
+        _reqLineIdx = 0;
+    if (_shuffleMode)
+        _reqLineIdx = rand() % _lineCount;
 }
 
 void EvaluatorSequences::stop()
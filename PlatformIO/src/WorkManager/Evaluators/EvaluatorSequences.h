@@ -3,6 +3,9 @@
 
 #pragma once
 
+#include <Arduino.h>
+#include <vector>
+
 class WorkManager;
 class WorkItem;
 class FileManager;
@@ -10,7 +13,11 @@ class FileManager;
 class EvaluatorSequences
 {
 public:
+    // Files longer than this are read from the file system a line at a time
     static const int MAX_SEQUENCE_FILE_LEN = 2000;
+    static const int MAX_SEQUENCE_LINE_LEN = 200;
+    // Length of the longest mode keyword (NoShuffleMode)
+    static const int MAX_MODE_KEYWORD_LEN = 13;
 
     EvaluatorSequences(FileManager& fileManager, WorkManager& workManager);
 
@@ -41,8 +48,13 @@ public:
     void stop();
     
 private:
-    // Count lines
-    int countLines(String& lines);
+    // Index the lines in a block of the sequence (blocks must be passed in order)
+    void indexLines(const char* pData, int dataLen, int dataPos, bool finalBlock);
+    void indexLineEnd(int lineEndPos);
+    void indexModeKeywords();
+
+    // Get a line of the sequence
+    String getLine(int lineIdx);
 
     // Full configuration JSON
     String _jsonConfigStr;
@@ -51,8 +63,25 @@ private:
     FileManager& _fileManager;
     WorkManager& _workManager;
 
-    // List of commands to add to workflow - delimited string
+    // List of commands to add to workflow - delimited string (empty if the file is read
+    // a line at a time)
     String _commandList;
+    String _fileName;
+
+    // Start and length of each non-blank line
+    struct SequenceLine
+    {
+        uint32_t startPos;
+        uint32_t len;
+    };
+    std::vector<SequenceLine> _lines;
+
+    // State while indexing
+    int _indexLineStart;
+    bool _indexLineBlank;
+    String _indexLineText;
+    bool _indexHasShuffle, _indexHasNoShuffle;
+    bool _indexHasRepeat, _indexHasNoRepeat;
 
     // Busy and current line
     int _inProgress;
@@ -4,7 +4,7 @@
 #include <Arduino.h>
 #include <ArduinoLog.h>
 #include "EvaluatorThetaRhoLine.h"
-#include "RdJson.h"
+#include "JsonDocumentView.h"
 #include "Utils.h"
 #include "../WorkManager.h"
 
@@ -32,15 +32,18 @@ EvaluatorThetaRhoLine::EvaluatorThetaRhoLine(WorkManager& workManager) :
 
 void EvaluatorThetaRhoLine::setConfig(const char *configStr, const char* robotAttributes)
 {
+    JsonDocumentView configDoc(configStr);
+    JsonDocumentView robotAttribDoc(robotAttributes);
+
     // Set the theta-rho angle step
-    _stepAngle = AxisUtils::d2r(RdJson::getDouble("thrStepDegs", AxisUtils::r2d(DEFAULT_STEP_ANGLE), configStr));
-    _stepAdaptation = RdJson::getLong("thrStepAdaptation", 1, configStr) != 0;
-    _continueFromPrevious = RdJson::getLong("thrContinue", 1, configStr) != 0;
+    _stepAngle = AxisUtils::d2r(configDoc.getDouble("thrStepDegs", AxisUtils::r2d(DEFAULT_STEP_ANGLE)));
+    _stepAdaptation = configDoc.getLong("thrStepAdaptation", 1) != 0;
+    _continueFromPrevious = configDoc.getLong("thrContinue", 1) != 0;
     // Set the size of the max radius
-    double sizeX = RdJson::getDouble("sizeX", 0, robotAttributes);
-    double sizeY = RdJson::getDouble("sizeY", 0, robotAttributes);
-    double originX = RdJson::getDouble("originX", 0, robotAttributes);
-    double originY = RdJson::getDouble("originY", 0, robotAttributes);
+    double sizeX = robotAttribDoc.getDouble("sizeX", 0);
+    double sizeY = robotAttribDoc.getDouble("sizeY", 0);
+    double originX = robotAttribDoc.getDouble("originX", 0);
+    double originY = robotAttribDoc.getDouble("originY", 0);
     _bedRadiusMM = std::min(sizeX, sizeY) / 2;
     _centreOffsetX = sizeX / 2 - originX;
     _centreOffsetY = sizeY / 2 - originY;
@@ -63,10 +66,21 @@ const char *EvaluatorThetaRhoLine::getConfig()
 // Check if valid
 bool EvaluatorThetaRhoLine::isValid(WorkItem &workItem)
 {
-    // Check if theta-rho
-    String cmdStr = workItem.getString();
-    cmdStr.trim();
-    return cmdStr.startsWith("_THRLINE");
+    const char* pCmdStr = workItem.getCString();
+    return isThetaRhoLine(pCmdStr, strlen(pCmdStr));
+}
+
+// Check if theta-rho - only the first cmdLen chars of the command are looked at
+bool EvaluatorThetaRhoLine::isThetaRhoLine(const char* pCmdStr, int cmdLen)
+{
+    static const char* THR_LINE_PREFIX = "_THRLINE";
+    static const int THR_LINE_PREFIX_LEN = strlen(THR_LINE_PREFIX);
+    while ((cmdLen > 0) && isspace(*pCmdStr))
+    {
+        pCmdStr++;
+        cmdLen--;
+    }
+    return (cmdLen >= THR_LINE_PREFIX_LEN) && (strncmp(pCmdStr, THR_LINE_PREFIX, THR_LINE_PREFIX_LEN) == 0);
 }
 
 // Process WorkItem
@@ -83,26 +97,21 @@ bool EvaluatorThetaRhoLine::execWorkItem(WorkItem &workItem)
 #endif
 
     // Check for an uninterpolated line
-    if (workItem.getString().startsWith("_THRLINE_"))
+    if (strncmp(workItem.getCString(), "_THRLINE_", strlen("_THRLINE_")) == 0)
     {
         _isInterpolating = false;
-        // Next iteration
-        char lineBuf[100];
         // Calculate coords
         double x,y;
         calcXYPos(newTheta, newRho, x, y);
-        sprintf(lineBuf, "G0 X%0.3f Y%0.3f", x, y);
-        String retStr;
-        WorkItem workItem(lineBuf);
 #ifdef THETA_RHO_DEBUG
-        Log.trace("%sexecWorkItem thrNonInterp %s\n", MODULE_PREFIX, lineBuf);
+        Log.trace("%sexecWorkItem thrNonInterp X%F Y%F\n", MODULE_PREFIX, x, y);
 #endif
-        _workManager.addWorkItem(workItem, retStr);
+        addMoveToXY(x, y);
         return true;
     }
 
     // Check for first line of interpolated file
-    if (workItem.getString().startsWith("_THRLINE0_"))
+    if (strncmp(workItem.getCString(), "_THRLINE0_", strlen("_THRLINE0_")) == 0)
     {
         if (_continueFromPrevious)
         {
@@ -196,7 +205,7 @@ void EvaluatorThetaRhoLine::service()
         }
 
         // See if we can add to the queue
-        if (!_workManager.canAcceptWorkItem())
+        if (!_workManager.canAcceptMove())
             return;
 
         // Step
@@ -206,18 +215,13 @@ void EvaluatorThetaRhoLine::service()
         _curTheta += _thetaInc;
         _curRho += _rhoInc;
 
-        // Next iteration
-        char lineBuf[100];
         // Calculate coords
         double x,y;
         calcXYPos(_curTheta, _curRho, x, y);
-        sprintf(lineBuf, "G0 X%0.3f Y%0.3f", x, y);
-        String retStr;
-        WorkItem workItem(lineBuf);
 #ifdef THETA_RHO_DEBUG
-        Log.trace("%sservice %s\n", MODULE_PREFIX, lineBuf);
+        Log.trace("%sservice X%F Y%F\n", MODULE_PREFIX, x, y);
 #endif
-        _workManager.addWorkItem(workItem, retStr);
+        addMoveToXY(x, y);
     }
 }
 
@@ -230,4 +234,14 @@ void EvaluatorThetaRhoLine::calcXYPos(double theta, double rho, double& x, doubl
 {
     x = sin(theta) * rho * _bedRadiusMM + _centreOffsetX;
     y = cos(theta) * rho * _bedRadiusMM + _centreOffsetY;
-}
\ No newline at end of file
+}
+
+void EvaluatorThetaRhoLine::addMoveToXY(double x, double y)
+{
+    // Equivalent of G0 X Y without formatting and parsing G-code
+    RobotCommandArgs moveArgs;
+    moveArgs.setAxisValMM(0, x, true);
+    moveArgs.setAxisValMM(1, y, true);
+    moveArgs.setMoveRapid(true);
+    _workManager.addMove(moveArgs);
+}
@@ -20,6 +20,7 @@ public:
 
     // Check valid
     bool isValid(WorkItem& workItem);
+    static bool isThetaRhoLine(const char* pCmdStr, int cmdLen);
 
     // Process WorkItem
     bool execWorkItem(WorkItem& workItem);
@@ -63,5 +64,6 @@ private:
     static const int PROCESS_STEPS_PER_SERVICE = 20;
 
     void calcXYPos(double theta, double rho, double& x, double& y);
+    void addMoveToXY(double x, double y);
 
 };
\ No newline at end of file
@@ -0,0 +1,75 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include <Arduino.h>
+#include "RobotCommandArgs.h"
+#include "../RobotMotion/MotionControl/MotionRingBuffer.h"
+#include "RdJson.h"
+#include <vector>
+
+// Queue of moves generated by evaluators - these go straight to the robot controller rather
+// than being formatted as G-code and parsed again
+class MoveCommandQueue
+{
+private:
+    MotionRingBufferPosn _queuePosn;
+    std::vector<RobotCommandArgs> _queue;
+    static const unsigned int _moveQueueMaxLenDefault = 50;
+
+public:
+    MoveCommandQueue() : _queuePosn(0)
+    {
+    }
+
+    // Set configuration - the max length is set by "maxLen" in the queue config
+    void init(const char* configStr, const char* queueName)
+    {
+        String queueCfg = RdJson::getString(queueName, "{}", configStr);
+        int maxLen = (int) RdJson::getLong("maxLen", _moveQueueMaxLenDefault, queueCfg.c_str());
+        // Ring buffer needs one extra slot
+        _queue.resize(maxLen + 1);
+        _queuePosn.init(maxLen + 1);
+    }
+
+    bool isFull()
+    {
+        return !_queuePosn.canPut();
+    }
+
+    bool isEmpty()
+    {
+        return !_queuePosn.canGet();
+    }
+
+    void clear()
+    {
+        _queuePosn.clear();
+    }
+
+    // Add to queue
+    bool add(const RobotCommandArgs& moveArgs)
+    {
+        if (!_queuePosn.canPut())
+            return false;
+        _queue[_queuePosn.posToPut()] = moveArgs;
+        _queuePosn.hasPut();
+        return true;
+    }
+
+    // Get from queue
+    bool get(RobotCommandArgs& moveArgs)
+    {
+        if (!_queuePosn.canGet())
+            return false;
+        moveArgs = _queue[_queuePosn.posToGet()];
+        _queuePosn.hasGot();
+        return true;
+    }
+
+    int size()
+    {
+        return _queuePosn.count();
+    }
+};
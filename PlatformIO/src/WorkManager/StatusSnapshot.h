@@ -0,0 +1,50 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include <atomic>
+
+// Latest value of some status published by one task and read by others without locking
+// The publisher is never held up - a reader retries if the value changes while it is being copied
+// The sequence number is odd while the value is being changed
+template<typename T>
+class StatusSnapshot
+{
+  private:
+    std::atomic<uint32_t> _seqNum;
+    T _value;
+    static const int MAX_READ_RETRIES = 10;
+
+  public:
+    StatusSnapshot()
+    {
+        _seqNum = 0;
+    }
+
+    // Publish - only to be called by one task
+    void publish(const T& value)
+    {
+        uint32_t seqNum = _seqNum.load(std::memory_order_relaxed);
+        _seqNum.store(seqNum + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _value = value;
+        _seqNum.store(seqNum + 2, std::memory_order_release);
+    }
+
+    // Read - returns false if nothing has been published or the value couldn't be read consistently
+    bool read(T& value)
+    {
+        for (int i = 0; i < MAX_READ_RETRIES; i++)
+        {
+            uint32_t seqNum = _seqNum.load(std::memory_order_acquire);
+            if (seqNum & 1)
+                continue;
+            value = _value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_seqNum.load(std::memory_order_relaxed) == seqNum)
+                return seqNum != 0;
+        }
+        return false;
+    }
+};
@@ -0,0 +1,77 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include <Arduino.h>
+#include "../RobotMotion/MotionControl/MotionRingBuffer.h"
+#include <vector>
+
+// Queue of commands from the network services (web server, MQTT, serial console and scheduler)
+// to the task which services the workflow and robot
+// The producers are serialised with a mutex as they run in more than one task but the service
+// task side is lock-free so it is never held up by network activity
+class WorkCommandQueue
+{
+  private:
+    struct WorkCommand
+    {
+        String _cmdStr;
+        int _cmdIdx;
+    };
+    MotionRingBufferPosn _queuePosn;
+    std::vector<WorkCommand> _queue;
+    SemaphoreHandle_t _putMutex;
+
+  public:
+    WorkCommandQueue() : _queuePosn(0)
+    {
+        _putMutex = xSemaphoreCreateMutex();
+    }
+
+    void init(int queueSize)
+    {
+        _queue.resize(queueSize);
+        _queuePosn.init(queueSize);
+    }
+
+    // Add to queue - returns false if full
+    bool put(const String& cmdStr, int cmdIdx)
+    {
+        bool rslt = false;
+        xSemaphoreTake(_putMutex, portMAX_DELAY);
+        if (_queuePosn.canPut())
+        {
+            WorkCommand& workCommand = _queue[_queuePosn.posToPut()];
+            workCommand._cmdStr = cmdStr;
+            workCommand._cmdIdx = cmdIdx;
+            _queuePosn.hasPut();
+            rslt = true;
+        }
+        xSemaphoreGive(_putMutex);
+        return rslt;
+    }
+
+    // Get the next command - service task only
+    bool get(String& cmdStr, int& cmdIdx)
+    {
+        if (!_queuePosn.canGet())
+            return false;
+        WorkCommand& workCommand = _queue[_queuePosn.posToGet()];
+        cmdStr = workCommand._cmdStr;
+        cmdIdx = workCommand._cmdIdx;
+        // Release the string memory before handing the slot back
+        workCommand._cmdStr = "";
+        _queuePosn.hasGot();
+        return true;
+    }
+
+    // Discard waiting commands - service task only as this takes them from the consumer side
+    void clear()
+    {
+        String cmdStr;
+        int cmdIdx = 0;
+        while (get(cmdStr, cmdIdx))
+            ;
+    }
+};
@@ -3,34 +3,83 @@
 
 #pragma once
 
+// Type of work item - this decides which evaluator handles it and is worked out once
+// when the item is queued
+enum WorkItemType
+{
+    WORK_ITEM_TYPE_UNCLASSIFIED,
+    WORK_ITEM_TYPE_GCODE,
+    // G-code from a file being run - this has its own modal state
+    WORK_ITEM_TYPE_FILE_GCODE,
+    WORK_ITEM_TYPE_PATTERN,
+    WORK_ITEM_TYPE_THETA_RHO_LINE,
+    WORK_ITEM_TYPE_FILE,
+    WORK_ITEM_TYPE_SEQUENCE
+};
+
 class WorkItem
 {
 private:
     String _str;
+    // Text owned elsewhere (e.g. by the work item queue) - NULL when the text is in _str
+    const char* _pView;
+    WorkItemType _type;
 
 public:
     WorkItem()
     {
         _str = "";
+        _pView = NULL;
+        _type = WORK_ITEM_TYPE_UNCLASSIFIED;
     }
 
     WorkItem(const char* pCmdStr)
     {
         _str = pCmdStr;
+        _pView = NULL;
+        _type = WORK_ITEM_TYPE_UNCLASSIFIED;
     }
 
     WorkItem(const String& cmdStr)
     {
         _str = cmdStr;
+        _pView = NULL;
+        _type = WORK_ITEM_TYPE_UNCLASSIFIED;
+    }
+
+    // Refer to text owned elsewhere without copying it - the text must remain
+    // unchanged while the work item is in use
+    void setView(const char* pCmdStr)
+    {
+        _str = "";
+        _pView = pCmdStr;
+    }
+
+    WorkItemType getType()
+    {
+        return _type;
+    }
+
+    void setType(WorkItemType type)
+    {
+        _type = type;
     }
 
     const char* getCString()
     {
+        if (_pView)
+            return _pView;
         return _str.c_str();
     }
 
+    // The text of a view is only copied if it is needed as a String
     const String& getString()
     {
+        if (_pView)
+        {
+            _str = _pView;
+            _pView = NULL;
+        }
         return _str;
     }
 };
@@ -3,21 +3,37 @@
 
 #pragma once
 
+#include <Arduino.h>
 #include "WorkItem.h"
-#include <queue>
 #include "RdJson.h"
+#include "../RobotMotion/MotionControl/MotionRingBuffer.h"
+#include <vector>
 
+// Queue of work items - the text of each item is held in a fixed arena so that queueing
+// doesn't allocate from the heap - peek() returns a view of the text which remains valid
+// until the item is removed or the queue is cleared
 class WorkItemQueue
 {
 private:
-    std::queue<WorkItem> _workItemQueue;
+    // Position of each item's text in the arena (the text is null terminated)
+    MotionRingBufferPosn _slotPosn;
+    std::vector<uint16_t> _slots;
+    std::vector<uint8_t> _slotTypes;
+    std::vector<char> _arena;
+    unsigned int _arenaPutPos;
+    // Changes whenever the item at the head changes (on remove or clear)
+    uint32_t _headSeq;
     unsigned int _workItemQueueMaxLen;
     static const unsigned int _workItemQueueMaxLenDefault = 50;
+    static const unsigned int ARENA_BYTES_PER_ITEM = 100;
+    static const unsigned int ARENA_MAX_BYTES = 0xffff;
 
 public:
-    WorkItemQueue()
+    WorkItemQueue() : _slotPosn(0)
     {
-        _workItemQueueMaxLen = _workItemQueueMaxLenDefault;
+        _arenaPutPos = 0;
+        _headSeq = 0;
+        _workItemQueueMaxLen = 0;
     }
 
     ~WorkItemQueue()
@@ -30,8 +46,18 @@ public:
         String queueCfg = RdJson::getString(queueName, "{}", configStr);
 
 //        Log.notice("Configuring WorkItemQueue from %s\n", configStr);
-        _workItemQueueMaxLen = (int) RdJson::getLong("maxLen",
+        unsigned int maxLen = (int) RdJson::getLong("maxLen",
                                             _workItemQueueMaxLenDefault, queueCfg.c_str());
+        // Only reallocate if the size changes
+        if (maxLen != _workItemQueueMaxLen)
+        {
+            _workItemQueueMaxLen = maxLen;
+            _slots.resize(maxLen + 1);
+            _slotTypes.resize(maxLen + 1);
+            _slotPosn.init(maxLen + 1);
+            unsigned int arenaBytes = maxLen * ARENA_BYTES_PER_ITEM;
+            _arena.resize(arenaBytes < ARENA_MAX_BYTES ? arenaBytes : ARENA_MAX_BYTES);
+        }
         clear();
 //        Log.notice("MaxLen %d\n", _workItemQueueMaxLen);
     }
@@ -39,87 +65,142 @@ public:
     // Check if queue full
     bool isFull()
     {
-        return (_workItemQueue.size() >= _workItemQueueMaxLen);
+        return !_slotPosn.canPut();
     }
 
     // Check if queue empty
     bool isEmpty()
     {
-        return (_workItemQueue.size() == 0);
+        return !_slotPosn.canGet();
     }
 
     // Clear the queue
     void clear()
     {
-        // Log.notice("Clearing Command Queue size %d max %d\n", _workItemQueue.size(), _workItemQueueMaxLen);
-        while(!_workItemQueue.empty()) 
-            _workItemQueue.pop();
-        // Log.notice("Cleared Command Queue size %d max %d\n", _workItemQueue.size(), _workItemQueueMaxLen);
+        _slotPosn.clear();
+        _arenaPutPos = 0;
+        _headSeq++;
     }
 
-    // Add to queue
+    // Add to queue - fails if there are too many items or not enough space for the text
     bool add(const char* pWorkItemStr)
+    {
+        return add(pWorkItemStr, strlen(pWorkItemStr));
+    }
+
+    // Add part of a string to the queue (the text is copied straight into the arena) along
+    // with the type of work item
+    bool add(const char* pWorkItemStr, unsigned int workItemLen,
+                WorkItemType workItemType = WORK_ITEM_TYPE_UNCLASSIFIED)
     {
         // Check if queue is full
-        if (_workItemQueue.size() >= _workItemQueueMaxLen)
+        if (!_slotPosn.canPut())
+            return false;
+
+        // Find space in the arena - the text of an item is never split so if there isn't
+        // room at the end of the arena the item goes at the start (if that is free)
+        unsigned int spaceReqd = workItemLen + 1;
+        unsigned int arenaPos = 0;
+        if (_slotPosn.canGet())
+        {
+            unsigned int arenaGetPos = _slots[_slotPosn.posToGet()];
+            if (_arenaPutPos >= arenaGetPos)
+            {
+                if (_arenaPutPos + spaceReqd <= _arena.size())
+                    arenaPos = _arenaPutPos;
+                else if (spaceReqd < arenaGetPos)
+                    arenaPos = 0;
+                else
+                    return false;
+            }
+            else
+            {
+                if (_arenaPutPos + spaceReqd >= arenaGetPos)
+                    return false;
+                arenaPos = _arenaPutPos;
+            }
+        }
+        else if (spaceReqd > _arena.size())
         {
-        //    Log.notice("Command Queue FULL size %d max %d\n", _workItemQueue.size(), _workItemQueueMaxLen);
             return false;
         }
 
         // Queue up the item
-        _workItemQueue.push(WorkItem(pWorkItemStr));
+        memcpy(_arena.data() + arenaPos, pWorkItemStr, workItemLen);
+        _arena[arenaPos + workItemLen] = 0;
+        _slots[_slotPosn.posToPut()] = arenaPos;
+        _slotTypes[_slotPosn.posToPut()] = workItemType;
+        _arenaPutPos = arenaPos + spaceReqd;
+        _slotPosn.hasPut();
         return true;
     }
 
-    // Peek the queue
+    // Peek the queue - returns NULL if empty
+    const char* peek()
+    {
+        if (!_slotPosn.canGet())
+            return NULL;
+        return _arena.data() + _slots[_slotPosn.posToGet()];
+    }
+
+    // Peek the queue - the work item is a view of the queued text
     bool peek(WorkItem& workItem)
     {
-        // Check if queue is empty
-        if (_workItemQueue.empty())
-        {
+        const char* pWorkItemStr = peek();
+        if (!pWorkItemStr)
             return false;
-        }
-
-        // read the item
-        workItem = _workItemQueue.front();
+        workItem.setView(pWorkItemStr);
+        workItem.setType((WorkItemType)_slotTypes[_slotPosn.posToGet()]);
         return true;
     }
 
-    // Get from queue
-    bool get(WorkItem& workItem)
+    // Remove the item at the head of the queue
+    bool remove()
     {
-        // Check if queue is empty
-        if (_workItemQueue.empty())
-        {
+        if (!_slotPosn.canGet())
             return false;
-        }
-
-        // read the item and remove
-        workItem = _workItemQueue.front();
-        _workItemQueue.pop();
+        _slotPosn.hasGot();
+        _headSeq++;
+        // Start the arena afresh when empty
+        if (!_slotPosn.canGet())
+            _arenaPutPos = 0;
         return true;
     }
 
-    // Get from queue
-    bool get(String& workItemStr)
+    // Sequence number of the item at the head - used to check an item peeked earlier is still at the head
+    uint32_t getHeadSeq()
     {
-        // Check if queue is empty
-        if (_workItemQueue.empty())
-        {
+        return _headSeq;
+    }
+
+    // Remove the item at the head only if it is the one with the sequence number given - the queue
+    // may have been cleared (and added to) while the item was being handled
+    bool removeIfHead(uint32_t headSeq)
+    {
+        if (headSeq != _headSeq)
             return false;
-        }
+        return remove();
+    }
 
-        // read the item and remove
-        workItemStr = _workItemQueue.front().getString();
-        _workItemQueue.pop();
-        return true;
+    // Get from queue - this copies the text
+    bool get(String& workItemStr)
+    {
+        const char* pWorkItemStr = peek();
+        if (!pWorkItemStr)
+            return false;
+        workItemStr = pWorkItemStr;
+        return remove();
     }
 
     // Get size
     int size()
     {
-        return _workItemQueue.size();
+        return _slotPosn.count();
     }
 
+    // Size of arena
+    unsigned int arenaSize()
+    {
+        return _arena.size();
+    }
 };
@@ -7,6 +7,7 @@
 #include "RestAPISystem.h"
 #include "Evaluators/EvaluatorGCode.h"
 #include "RobotConfigurations.h"
+#include "JsonDocumentView.h"
 
 static const char* MODULE_PREFIX = "WorkManager: ";
 
@@ -31,6 +32,12 @@ WorkManager::WorkManager(ConfigBase& mainConfig,
 {
     _statusReportLastCheck = 0;
     _statusLastHashVal = 0;
+    _serviceTaskHandle = NULL;
+    _commandQueue.init(COMMAND_QUEUE_LEN);
+    _immediateCommandQueue.init(IMMEDIATE_COMMAND_QUEUE_LEN);
+    _robotStatusLastPublishMs = 0;
+    _reconfigureRequested = false;
+    _robotConfigMutex = xSemaphoreCreateMutex();
 #ifdef DEBUG_WORK_ITEM_SERVICE
     _debugLastWorkServiceMs = 0;
 #endif
@@ -48,11 +55,19 @@ void WorkManager::queryStatus(String &respStr)
     innerJsonStr += healthStrSystem;
     // Robot info
     RobotCommandArgs cmdArgs;
-    _robotController.getCurStatus(cmdArgs);
+    getRobotStatus(cmdArgs);
     String healthStrRobot = cmdArgs.toJSON(false);
     if ((innerJsonStr.length() > 0) && (healthStrRobot.length() > 0))
         innerJsonStr += ",";
     innerJsonStr += healthStrRobot;
+    // File simplification
+    FilesSimplifyStatus simplifyStatus;
+    getSimplifyStatus(simplifyStatus);
+    String simplifyStr;
+    simplifyStatus.toJSON(simplifyStr);
+    if ((innerJsonStr.length() > 0) && (simplifyStr.length() > 0))
+        innerJsonStr += ",";
+    innerJsonStr += simplifyStr;
     String ledStrip = _ledStrip.getConfigStrPtr();
     // Log.trace("%squeryStatus innerJsonLen %d ledStripLen %d ledStrip <%s>\n", MODULE_PREFIX, innerJsonStr.length(), ledStrip.length(), ledStrip.c_str());
     if ((innerJsonStr.length() > 0) && (ledStrip.length() > 2))
@@ -87,12 +102,24 @@ bool WorkManager::canAcceptWorkItem()
 
 bool WorkManager::queueIsEmpty()
 {
-    return _workItemQueue.isEmpty();
+    return _workItemQueue.isEmpty() && _moveQueue.isEmpty();
+}
+
+bool WorkManager::canAcceptMove()
+{
+    return !_moveQueue.isFull();
+}
+
+bool WorkManager::addMove(const RobotCommandArgs& moveArgs)
+{
+    return _moveQueue.add(moveArgs);
 }
 
 void WorkManager::getRobotConfig(String &respStr)
 {
+    xSemaphoreTake(_robotConfigMutex, portMAX_DELAY);
     respStr = _robotConfig.getConfigString();
+    xSemaphoreGive(_robotConfigMutex);
 }
 
 bool WorkManager::setLedStripConfig(const uint8_t* pData, int len) {
@@ -116,62 +143,82 @@ bool WorkManager::setRobotConfig(const uint8_t *pData, int len)
         return false;
     memcpy(pTmp, pData, len);
     pTmp[len] = 0;
-    // Make sure string is terminated
+    // Make sure string is terminated - the config is stored permanently
+    xSemaphoreTake(_robotConfigMutex, portMAX_DELAY);
     _robotConfig.setConfigData(pTmp);
-    delete[] pTmp;
-    // Reconfigure the robot
-    reconfigure();
-    // Store the configuration permanently
     _robotConfig.writeConfig();
+    xSemaphoreGive(_robotConfigMutex);
+    delete[] pTmp;
+    // Reconfigure the robot - this is done by the service task if called from another task
+    if (isOtherTask())
+    {
+        _reconfigureRequested = true;
+        xTaskNotifyGive(_serviceTaskHandle);
+    }
+    else
+        reconfigure();
     return true;
 }
 
-void WorkManager::processSingle(const char *pCmdStr, String &retStr)
+// Check if a command (which may not be null terminated) matches a string (case insensitive)
+static bool cmdMatches(const char* pCmdStr, int cmdLen, const char* pMatchStr)
+{
+    return (strncasecmp(pCmdStr, pMatchStr, cmdLen) == 0) && (pMatchStr[cmdLen] == 0);
+}
+
+void WorkManager::processSingle(const char *pCmdStr, int cmdLen, String &retStr, WorkItemType itemType)
 {
     const char *okRslt = "{\"rslt\":\"ok\"}";
     retStr = "{\"rslt\":\"none\"}";
 
     // Check if this is an immediate command
-    if (strcasecmp(pCmdStr, "pause") == 0)
+    if (cmdMatches(pCmdStr, cmdLen, "pause"))
     {
         _robotController.pause(true);
         retStr = okRslt;
     }
-    else if (strcasecmp(pCmdStr, "sleep") == 0)
+    else if (cmdMatches(pCmdStr, cmdLen, "sleep"))
     {
         _robotController.pause(true);
         _ledStrip.setSleepMode(true);
         retStr = okRslt;
     }
-    else if (strcasecmp(pCmdStr, "resume") == 0)
+    else if (cmdMatches(pCmdStr, cmdLen, "resume"))
     {
         _robotController.pause(false);
         _ledStrip.setSleepMode(false);
         retStr = okRslt;
     }
-    else if (strcasecmp(pCmdStr, "playpause") == 0)
+    else if (cmdMatches(pCmdStr, cmdLen, "playpause"))
     {
         // Toggle pause state
         _robotController.pause(!_robotController.isPaused());
         retStr = okRslt;
     }
-    else if (strcasecmp(pCmdStr, "stop") == 0)
+    else if (cmdMatches(pCmdStr, cmdLen, "stop"))
     {
         _robotController.stop();
+        // Commands sent from other tasks before the stop and still waiting are dropped too
+        _commandQueue.clear();
         _workItemQueue.clear();
+        _moveQueue.clear();
         evaluatorsStop();
+        _gcodeModalState.clear();
+        _fileGCodeModalState.clear();
         retStr = okRslt;
     }
     else
     {
         // Send the line to the workflow manager
-        if (strlen(pCmdStr) != 0)
+        if (cmdLen != 0)
         {
 #ifdef DEBUG_WORK_ITEM_SERVICE
-            Log.trace("%sprocessSingle add %s\n", MODULE_PREFIX, 
-                        pCmdStr);
+            Log.trace("%sprocessSingle add %.*s\n", MODULE_PREFIX, 
+                        cmdLen, pCmdStr);
 #endif
-            bool rslt = _workItemQueue.add(pCmdStr);
+            if (itemType == WORK_ITEM_TYPE_UNCLASSIFIED)
+                itemType = classifyWorkItem(pCmdStr, cmdLen);
+            bool rslt = _workItemQueue.add(pCmdStr, cmdLen, itemType);
             if (!rslt)
             {
                 retStr = "{\"rslt\":\"busy\"}";
@@ -187,138 +234,176 @@ void WorkManager::processSingle(const char *pCmdStr, String &retStr)
 }
 
 void WorkManager::addWorkItem(WorkItem& workItem, String &retStr, int cmdIdx)
+{
+    // Work items from other tasks are queued for the service task - the result only indicates
+    // whether the item could be queued
+    if (isOtherTask())
+    {
+        WorkCommandQueue& commandQueue = isImmediateCommand(workItem.getCString()) ?
+                        _immediateCommandQueue : _commandQueue;
+        if (commandQueue.put(workItem.getString(), cmdIdx))
+        {
+            // Wake the service task if it is waiting
+            xTaskNotifyGive(_serviceTaskHandle);
+            retStr = "{\"rslt\":\"ok\"}";
+        }
+        else
+            retStr = "{\"rslt\":\"busy\"}";
+        return;
+    }
+    addWorkItemDirect(workItem, retStr, cmdIdx);
+}
+
+void WorkManager::addWorkItemDirect(WorkItem& workItem, String &retStr, int cmdIdx)
 {
     // Handle the case of a single string
-    if (strstr(workItem.getCString(), ";") == NULL)
+    const char *pCurStr = workItem.getCString();
+    if (strstr(pCurStr, ";") == NULL)
     {
-        return processSingle(workItem.getCString(), retStr);
+        return processSingle(pCurStr, strlen(pCurStr), retStr, workItem.getType());
     }
 
-    // Handle multiple commands (semicolon delimited)
+    // Handle multiple commands (semicolon delimited) - each command is passed on in place
+    // and only copied when it is queued
 #ifdef DEBUG_WORK_ITEM_SERVICE
-    Log.trace("%s addWorkItem %s\n", MODULE_PREFIX, workItem.getCString());
+    Log.trace("%s addWorkItem %s\n", MODULE_PREFIX, pCurStr);
 #endif
     const int MAX_TEMP_CMD_STR_LEN = 1000;
-    const char *pCurStr = workItem.getCString();
-    const char *pCurStrEnd = pCurStr;
     int curCmdIdx = 0;
     while (true)
     {
-        // Find line end
-        if ((*pCurStrEnd == ';') || (*pCurStrEnd == '\0'))
+        // Find command end
+        const char *pCurStrEnd = pCurStr;
+        while ((*pCurStrEnd != ';') && (*pCurStrEnd != '\0'))
+            pCurStrEnd++;
+        int stLen = pCurStrEnd - pCurStr;
+        if ((stLen == 0) || (stLen > MAX_TEMP_CMD_STR_LEN))
+            break;
+
+        // process
+        if (cmdIdx == -1 || cmdIdx == curCmdIdx)
         {
-            // Extract the line
-            int stLen = pCurStrEnd - pCurStr;
-            if ((stLen == 0) || (stLen > MAX_TEMP_CMD_STR_LEN))
-                break;
-
-            // Alloc
-            char *pCurCmd = new char[stLen + 1];
-            if (!pCurCmd)
-                break;
-            for (int i = 0; i < stLen; i++)
-                pCurCmd[i] = *pCurStr++;
-            pCurCmd[stLen] = 0;
-
-            // process
-            if (cmdIdx == -1 || cmdIdx == curCmdIdx)
-            {
 #ifdef DEBUG_WORK_ITEM_SERVICE
-                Log.trace("%ssingle %d %s\n", MODULE_PREFIX, stLen, pCurCmd);
-#endif            
-                processSingle(pCurCmd, retStr);
-            }
-            delete[] pCurCmd;
-
-            // Move on
-            curCmdIdx++;
-            if (*pCurStrEnd == '\0')
-                break;
-            pCurStr = pCurStrEnd + 1;
+            Log.trace("%ssingle %d %.*s\n", MODULE_PREFIX, stLen, stLen, pCurStr);
+#endif
+            processSingle(pCurStr, stLen, retStr, workItem.getType());
         }
-        pCurStrEnd++;
+
+        // Move on
+        curCmdIdx++;
+        if (*pCurStrEnd == '\0')
+            break;
+        pCurStr = pCurStrEnd + 1;
     }
 }
 
-bool WorkManager::canBeProcessed(WorkItem& workItem)
+WorkItemType WorkManager::classifyWorkItem(const char* pCmdStr, int cmdLen)
 {
-    // See if it is a pattern evaluator work item
-    if (_evaluatorPatterns.isValid(workItem))
-        return !_evaluatorPatterns.isBusy();
-
-    // See if it is a theta-rho evaluator work item
-    if (_evaluatorThetaRhoLine.isValid(workItem))
-        return !_evaluatorThetaRhoLine.isBusy();
+    // Only the first cmdLen chars are the command (it may be one of several in a string)
+    while ((cmdLen > 0) && isspace(*pCmdStr))
+    {
+        pCmdStr++;
+        cmdLen--;
+    }
 
-    // See if it is a file to process
+    // Theta-rho lines are generated by the file evaluator in large numbers so check these first
+    if (EvaluatorThetaRhoLine::isThetaRhoLine(pCmdStr, cmdLen))
+        return WORK_ITEM_TYPE_THETA_RHO_LINE;
+
+    // G-code starting with a word like G1 or M84 isn't a file name
+    if (isGCodeWord(pCmdStr, cmdLen))
+        return WORK_ITEM_TYPE_GCODE;
+
+    // Other evaluators need a file name (with extension)
+    if ((cmdLen > MAX_WORK_ITEM_FILE_NAME_LEN) || !memchr(pCmdStr, '.', cmdLen))
+        return WORK_ITEM_TYPE_GCODE;
+    char fileName[MAX_WORK_ITEM_FILE_NAME_LEN + 1];
+    memcpy(fileName, pCmdStr, cmdLen);
+    fileName[cmdLen] = 0;
+    WorkItem workItem(fileName);
+    if (_evaluatorPatterns.isValid(workItem))
+        return WORK_ITEM_TYPE_PATTERN;
     if (_evaluatorFiles.isValid(workItem))
-        return !_evaluatorFiles.isBusy();
-
-    // See if it is command sequence
+        return WORK_ITEM_TYPE_FILE;
     if (_evaluatorSequences.isValid(workItem))
-        return !_evaluatorSequences.isBusy();
-
-    // Assume it is gcode
-    return _robotController.canAcceptCommand();
+        return WORK_ITEM_TYPE_SEQUENCE;
+    return WORK_ITEM_TYPE_GCODE;
 }
 
-bool WorkManager::execWorkItem(WorkItem& workItem)
+// Check if the command starts with a G-code word (a letter then a number) on its own - file
+// names like G1.gcode are not G-code words as the number is followed by more than whitespace
+bool WorkManager::isGCodeWord(const char* pCmdStr, int cmdLen)
 {
-    // See if the command is a pattern generator
-    bool handledOk = false;
-    // See if it is a pattern evaluator
-    if (_evaluatorPatterns.isValid(workItem))
+    if ((cmdLen < 2) || !isalpha(pCmdStr[0]))
+        return false;
+    int numLen = 0;
+    for (int chIdx = 1; chIdx < cmdLen; chIdx++)
     {
-        handledOk = _evaluatorPatterns.execWorkItem(workItem);
-#ifdef DEBUG_WORK_ITEM_SERVICE
-        Log.trace("%sexecWorkIterm %s isPattern handledOk = %s\n", MODULE_PREFIX, 
-                workItem.getCString(), handledOk ? "YES" : "NO");
-#endif
-        if (handledOk)
-            return handledOk;
+        char ch = pCmdStr[chIdx];
+        if (isspace(ch))
+            break;
+        if (!isdigit(ch) && (ch != '.') && (ch != '-') && (ch != '+'))
+            return false;
+        numLen++;
     }
-    // See if it is a theta-rho line
-    if (_evaluatorThetaRhoLine.isValid(workItem))
+    return numLen > 0;
+}
+
+bool WorkManager::canBeProcessed(WorkItem& workItem)
+{
+    if (workItem.getType() == WORK_ITEM_TYPE_UNCLASSIFIED)
+        workItem.setType(classifyWorkItem(workItem.getCString(), strlen(workItem.getCString())));
+    switch (workItem.getType())
     {
-        handledOk = _evaluatorThetaRhoLine.execWorkItem(workItem);
-#ifdef DEBUG_WORK_ITEM_SERVICE
-        Log.trace("%sexecWorkIterm %s isTHR handledOk = %s\n", MODULE_PREFIX, 
-                workItem.getCString(), handledOk ? "YES" : "NO");
-#endif
-        if (handledOk)
-            return handledOk;
+        case WORK_ITEM_TYPE_PATTERN:
+            return !_evaluatorPatterns.isBusy();
+        case WORK_ITEM_TYPE_THETA_RHO_LINE:
+            return !_evaluatorThetaRhoLine.isBusy() && canAcceptMove();
+        case WORK_ITEM_TYPE_FILE:
+            return !_evaluatorFiles.isBusy();
+        case WORK_ITEM_TYPE_SEQUENCE:
+            return !_evaluatorSequences.isBusy();
+        default:
+            return _robotController.canAcceptCommand();
     }
-    // See if it is a file to process
-    if (_evaluatorFiles.isValid(workItem))
+}
+
+bool WorkManager::execWorkItem(WorkItem& workItem)
+{
+    // Handle with the evaluator for this type of work item - returns false for G-code
+    bool handledOk = false;
+    switch (workItem.getType())
     {
-        handledOk = _evaluatorFiles.execWorkItem(workItem);
-#ifdef DEBUG_WORK_ITEM_SERVICE
-        Log.trace("%sexecWorkIterm %s isFile handledOk = %s\n", MODULE_PREFIX, 
-                workItem.getCString(), handledOk ? "YES" : "NO");
-#endif
-        if (handledOk)
-            return handledOk;
+        case WORK_ITEM_TYPE_PATTERN:
+            handledOk = _evaluatorPatterns.execWorkItem(workItem);
+            break;
+        case WORK_ITEM_TYPE_THETA_RHO_LINE:
+            handledOk = _evaluatorThetaRhoLine.execWorkItem(workItem);
+            break;
+        case WORK_ITEM_TYPE_FILE:
+            handledOk = _evaluatorFiles.execWorkItem(workItem);
+            // Each file starts from the default modal state
+            if (handledOk)
+                _fileGCodeModalState.clear();
+            break;
+        case WORK_ITEM_TYPE_SEQUENCE:
+            handledOk = _evaluatorSequences.execWorkItem(workItem);
+            break;
+        default:
+            break;
     }
-    // See if it is a command sequence
-    if (_evaluatorSequences.isValid(workItem))
-    {
-        handledOk = _evaluatorSequences.execWorkItem(workItem);
 #ifdef DEBUG_WORK_ITEM_SERVICE
-        Log.trace("%sexecWorkIterm %s isSequence handledOk = %s\n", MODULE_PREFIX, 
-                workItem.getCString(), handledOk ? "YES" : "NO");
+    Log.trace("%sexecWorkItem %s type %d handledOk = %s\n", MODULE_PREFIX,
+            workItem.getCString(), workItem.getType(), handledOk ? "YES" : "NO");
 #endif
-        if (handledOk)
-            return handledOk;
-    }
-    // Not handled
-    return false;
+    return handledOk;
 }
 
-void WorkManager::service()
+bool WorkManager::service()
 {
 #ifdef DEBUG_WORK_ITEM_SERVICE
     if (!Utils::isTimeout(millis(), _debugLastWorkServiceMs, DEBUG_BETWEEN_WORK_ITEM_SERVICES_MS))
-        return;
+        return false;
     _debugLastWorkServiceMs = millis();
     {
     WorkItem workItem;
@@ -337,72 +422,173 @@ void WorkManager::service()
     // Note that the following debug code breaks stopping the robot
     // This is because the stop can come during the debug loop and would clear the queue
     // but the debug loop ends up replacing the items that were removed!
-    std::queue<WorkItem> newQ;
     int qSize = _workItemQueue.size();
     for (int i = 0; i < qSize; i++)
     {
-        WorkItem it;
-        _workItemQueue.get(it);
-        newQ.push(it);
-        Log.trace("QUEUE ITEM %d = %s\n", i, it.getCString());
-    }
-    for (int i = 0; i < qSize; i++)
-    {
-        WorkItem it = newQ.front();
-        _workItemQueue.add(it.getCString());
-        newQ.pop();
+        WorkItem queuedItem;
+        _workItemQueue.peek(queuedItem);
+        const char* pItemStr = queuedItem.getCString();
+        Log.trace("QUEUE ITEM %d = %s type %d\n", i, pItemStr, queuedItem.getType());
+        _workItemQueue.add(pItemStr, strlen(pItemStr), queuedItem.getType());
+        _workItemQueue.remove();
     }
     }
 #endif
 
+    // Handle commands and reconfiguration requested from other tasks
+    bool workDone = false;
+    if (_serviceTaskHandle)
+    {
+        if (_reconfigureRequested)
+        {
+            _reconfigureRequested = false;
+            reconfigure();
+            workDone = true;
+        }
+        if (serviceCommandQueue())
+            workDone = true;
+    }
+
     // Pump the workflow here
     // Check if the RobotController can accept more
     if (_robotController.canAcceptCommand())
     {
-        // Peek at next work item
+        // Moves from evaluators go first as they were generated from work items already taken
+        // from the queue
+        RobotCommandArgs moveArgs;
         WorkItem workItem;
-        bool rslt = _workItemQueue.peek(workItem);
+        bool rslt = false;
+        uint32_t headSeq = _workItemQueue.getHeadSeq();
+        if (_moveQueue.get(moveArgs))
+        {
+            _robotController.moveTo(moveArgs);
+            workDone = true;
+        }
+        else
+            rslt = _workItemQueue.peek(workItem);
         if (rslt)
         {
-            // Check if this work item can be processed
+            // Check if this work item can be processed - the work item is a view of the text
+            // in the queue so it is only removed once it has been handled
             if (canBeProcessed(workItem))
             {
-                rslt = _workItemQueue.get(workItem);
-                if (rslt)
-                {
-                    // Check for extended commands
-                    rslt = execWorkItem(workItem);
+                // Check for extended commands
+                rslt = execWorkItem(workItem);
 
 #ifdef DEBUG_WORK_ITEM_SERVICE
-                    Log.trace("%sgetWorkflow execRslt=%d (waiting %d), %s\n", MODULE_PREFIX,
-                            rslt,
-                            _workItemQueue.size(),
-                            workItem.getString().c_str());
+                Log.trace("%sgetWorkflow execRslt=%d (waiting %d), %s\n", MODULE_PREFIX,
+                        rslt,
+                        _workItemQueue.size(),
+                        workItem.getCString());
 #endif
-                    // Check for GCode
-                    if (!rslt)
-                        EvaluatorGCode::interpretGcode(workItem, &_robotController, true);
+                // Check for GCode - handling the item may have cleared the queue (e.g. on stop) in
+                // which case the item is no longer at the head and anything queued since is kept
+                if (!rslt && (_workItemQueue.getHeadSeq() == headSeq))
+                {
+                    GCodeModalState& modalState = (workItem.getType() == WORK_ITEM_TYPE_FILE_GCODE) ?
+                                _fileGCodeModalState : _gcodeModalState;
+                    EvaluatorGCode::interpretGcode(workItem, modalState, &_robotController, true);
                 }
+                _workItemQueue.removeIfHead(headSeq);
+                workDone = true;
             }
         }
     }
 
-    // Service evaluators
+    // Service evaluators - they only add to the queues so anything added is work done
+    int queuedBefore = _moveQueue.size() + _workItemQueue.size();
     evaluatorsService();
+    if (_moveQueue.size() + _workItemQueue.size() != queuedBefore)
+        workDone = true;
+
+    // Publish robot status for other tasks
+    if (_serviceTaskHandle && Utils::isTimeout(millis(), _robotStatusLastPublishMs, ROBOT_STATUS_PUBLISH_MS))
+    {
+        _robotStatusLastPublishMs = millis();
+        RobotCommandArgs cmdArgs;
+        _robotController.getCurStatus(cmdArgs);
+        _robotStatus.publish(cmdArgs);
+        FilesSimplifyStatus simplifyStatus;
+        _evaluatorFiles.getSimplifyStatus(simplifyStatus);
+        _simplifyStatus.publish(simplifyStatus);
+    }
+    return workDone;
+}
+
+void WorkManager::setServiceTask()
+{
+    _serviceTaskHandle = xTaskGetCurrentTaskHandle();
+}
+
+bool WorkManager::isOtherTask()
+{
+    return _serviceTaskHandle && (xTaskGetCurrentTaskHandle() != _serviceTaskHandle);
+}
+
+bool WorkManager::isImmediateCommand(const char* pCmdStr)
+{
+    return (strcasecmp(pCmdStr, "pause") == 0) || (strcasecmp(pCmdStr, "sleep") == 0) ||
+            (strcasecmp(pCmdStr, "resume") == 0) || (strcasecmp(pCmdStr, "playpause") == 0) ||
+            (strcasecmp(pCmdStr, "stop") == 0);
+}
+
+bool WorkManager::serviceCommandQueue()
+{
+    // Immediate commands are always handled first so that a backlog of other commands can't
+    // hold up a stop or pause
+    String cmdStr, retStr;
+    int cmdIdx = -1;
+    bool cmdsHandled = false;
+    while (_immediateCommandQueue.get(cmdStr, cmdIdx))
+    {
+        WorkItem workItem;
+        workItem.setView(cmdStr.c_str());
+        addWorkItemDirect(workItem, retStr, cmdIdx);
+        cmdsHandled = true;
+    }
+
+    // Move other commands to the work item queue while there is space
+    while (canAcceptWorkItem() && _commandQueue.get(cmdStr, cmdIdx))
+    {
+        WorkItem workItem;
+        workItem.setView(cmdStr.c_str());
+        addWorkItemDirect(workItem, retStr, cmdIdx);
+        cmdsHandled = true;
+    }
+    return cmdsHandled;
+}
+
+void WorkManager::getRobotStatus(RobotCommandArgs& cmdArgs)
+{
+    if (isOtherTask())
+        _robotStatus.read(cmdArgs);
+    else
+        _robotController.getCurStatus(cmdArgs);
+}
+
+void WorkManager::getSimplifyStatus(FilesSimplifyStatus& status)
+{
+    if (isOtherTask())
+        _simplifyStatus.read(status);
+    else
+        _evaluatorFiles.getSimplifyStatus(status);
 }
 
 void WorkManager::reconfigure()
 {
     // Get the config data
+    xSemaphoreTake(_robotConfigMutex, portMAX_DELAY);
     String configData = _robotConfig.getConfigString();
+    xSemaphoreGive(_robotConfigMutex);
+    JsonDocumentView configDoc(configData.c_str());
 
     // See if robotConfig is present
-    String robotConfigStr = RdJson::getString("/robotConfig", "", configData.c_str());
+    String robotConfigStr = configDoc.getString("/robotConfig", "");
     if (robotConfigStr.length() <= 0)
     {
         Log.notice("%sNo robotConfig found - defaulting\n", MODULE_PREFIX);
         // See if there is a robotType specified in the config
-        String robotType = RdJson::getString("/robotType", "", configData.c_str());
+        String robotType = configDoc.getString("/robotType", "");
         if (robotType.length() <= 0)
             // If not see if there is a default robot type
             robotType = RdJson::getString("/defaultRobotType", "", _systemConfig.getConfigCStrPtr());
@@ -416,6 +602,7 @@ void WorkManager::reconfigure()
     // Init robot controller and workflow manager
     _robotController.init(robotConfigStr.c_str());
     _workItemQueue.init(robotConfigStr.c_str(), "workItemQueue");
+    _moveQueue.init(robotConfigStr.c_str(), "moveQueue");
     // Set config into evaluators
     String robotAttributes;
     _robotController.getRobotAttributes(robotAttributes);
@@ -488,7 +675,7 @@ void WorkManager::evaluatorsSetConfig(const char* configJson, const char* jsonPa
     String evaluatorConfig = RdJson::getString(jsonPath, "{}", configJson);
     _evaluatorPatterns.setConfig(evaluatorConfig.c_str(), robotAttributes);
     _evaluatorSequences.setConfig(evaluatorConfig.c_str());
-    _evaluatorFiles.setConfig(evaluatorConfig.c_str());
+    _evaluatorFiles.setConfig(evaluatorConfig.c_str(), robotAttributes);
     _evaluatorThetaRhoLine.setConfig(evaluatorConfig.c_str(), robotAttributes);
 }
 
@@ -513,7 +700,7 @@ bool WorkManager::checkStatusChanged()
 
     // Check for robot status changes
     RobotCommandArgs cmdArgs;
-    _robotController.getCurStatus(cmdArgs);
+    getRobotStatus(cmdArgs);
 
     // Check if anything changed
     statusChanged |= (_statusLastHashVal != statusNewHash) | (_statusLastCmdArgs != cmdArgs);
@@ -532,5 +719,7 @@ String WorkManager::getDebugStr()
 {
     String returnStr = (_workItemQueue.isFull() ? " QFULL:" : " QOK:");
     returnStr += _workItemQueue.size();
+    returnStr += " MQ:";
+    returnStr += _moveQueue.size();
     return returnStr;
 }
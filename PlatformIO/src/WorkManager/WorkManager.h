@@ -8,11 +8,16 @@
 #include <Arduino.h>
 #include "LedStrip.h"
 #include "WorkItemQueue.h"
+#include "MoveCommandQueue.h"
+#include "WorkCommandQueue.h"
+#include "StatusSnapshot.h"
 #include "Evaluators/EvaluatorPatterns.h"
 #include "Evaluators/EvaluatorSequences.h"
 #include "Evaluators/EvaluatorFiles.h"
 #include "Evaluators/EvaluatorThetaRhoLine.h"
+#include "Evaluators/EvaluatorGCode.h"
 #include "RobotCommandArgs.h"
+#include <atomic>
 
 class ConfigBase;
 class RobotController;
@@ -29,6 +34,7 @@ private:
     RobotController& _robotController;
     LedStrip& _ledStrip;
     WorkItemQueue _workItemQueue;
+    MoveCommandQueue _moveQueue;
     RestAPISystem& _restAPISystem;
     FileManager& _fileManager;
     CommandScheduler& _commandScheduler;
@@ -39,6 +45,10 @@ private:
     EvaluatorFiles _evaluatorFiles;
     EvaluatorThetaRhoLine _evaluatorThetaRhoLine;
 
+    // G-code modal state (G90/G91, G20/G21, feedrate) for commands and for the file being run
+    GCodeModalState _gcodeModalState;
+    GCodeModalState _fileGCodeModalState;
+
     // Status updates
     RobotCommandArgs _statusLastCmdArgs;
     unsigned long _statusLastHashVal;
@@ -49,6 +59,22 @@ private:
     // A status update will always be sent (even if no change) after this time
     const unsigned long STATUS_ALWAYS_UPDATE_MS = 10000;
 
+    // Service task - when set, commands and status from other tasks go through lock-free queues
+    TaskHandle_t _serviceTaskHandle;
+    WorkCommandQueue _commandQueue;
+    static const int COMMAND_QUEUE_LEN = 20;
+    // Immediate commands (stop, pause, etc) are queued separately so they don't wait behind other commands
+    WorkCommandQueue _immediateCommandQueue;
+    static const int IMMEDIATE_COMMAND_QUEUE_LEN = 5;
+    StatusSnapshot<RobotCommandArgs> _robotStatus;
+    StatusSnapshot<FilesSimplifyStatus> _simplifyStatus;
+    unsigned long _robotStatusLastPublishMs;
+    // Time between publishing robot status from the service task
+    const unsigned long ROBOT_STATUS_PUBLISH_MS = 50;
+    std::atomic<bool> _reconfigureRequested;
+    // Robot config can be set from other tasks while the service task reads it
+    SemaphoreHandle_t _robotConfigMutex;
+
     // Debug
 #ifdef DEBUG_WORK_ITEM_SERVICE
     uint32_t _debugLastWorkServiceMs;
@@ -70,8 +96,11 @@ public:
     // Queue info
     bool queueIsEmpty();
 
-    // Call frequently to pump the queue
-    void service();
+    // Call frequently to pump the queue - returns true if any work was done
+    bool service();
+
+    // Set the task which calls service() - this must be called from that task
+    void setServiceTask();
 
     // Configuration of the robot
     void getRobotConfig(String& respStr);
@@ -90,6 +119,12 @@ public:
     // Add a work item to the queue
     void addWorkItem(WorkItem& workItem, String &retStr, int cmdIdx = -1);
 
+    // Check if a move can be accepted from an evaluator
+    bool canAcceptMove();
+
+    // Add a move from an evaluator - this bypasses G-code
+    bool addMove(const RobotCommandArgs& moveArgs);
+
     // Check status changed
     bool checkStatusChanged();
 
@@ -100,8 +135,8 @@ private:
     // Execute an item of work
     bool execWorkItem(WorkItem& workItem);
 
-    // Process a single 
-    void processSingle(const char *pCmdStr, String &retStr);
+    // Process a single - the work item is classified unless its type is already known
+    void processSingle(const char *pCmdStr, int cmdLen, String &retStr, WorkItemType itemType);
 
     // Stop Evaluators
     void evaluatorsStop();
@@ -117,4 +152,26 @@ private:
 
     // Can be processed
     bool canBeProcessed(WorkItem& workItem);
+
+    // Work out which evaluator (if any) handles a work item
+    WorkItemType classifyWorkItem(const char* pCmdStr, int cmdLen);
+    static bool isGCodeWord(const char* pCmdStr, int cmdLen);
+    // Longer work items aren't checked as file names
+    static const int MAX_WORK_ITEM_FILE_NAME_LEN = 100;
+
+    // Check if called from a task other than the service task
+    bool isOtherTask();
+
+    // Handle commands queued from other tasks - returns true if any were handled
+    bool serviceCommandQueue();
+
+    // Check if a command is handled immediately rather than being queued
+    static bool isImmediateCommand(const char* pCmdStr);
+
+    // Get robot status - from the snapshot when called from another task
+    void getRobotStatus(RobotCommandArgs& cmdArgs);
+    void getSimplifyStatus(FilesSimplifyStatus& status);
+
+    // Add a work item (from the service task)
+    void addWorkItemDirect(WorkItem& workItem, String &retStr, int cmdIdx);
 };
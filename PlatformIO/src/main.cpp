@@ -192,10 +192,33 @@ void debugLoopInfoCallback(String &infoStr)
         infoStr = wifiManager.getHostname() + " V" + String(systemVersion) + " SSID " + WiFi.SSID() + " IP " + WiFi.localIP().toString() + " Heap " + String(ESP.getFreeHeap());
     else
         infoStr = "WiFi Disabled, Heap " + String(ESP.getFreeHeap());
+}
+DebugLoopTimer debugLoopTimer(10000, debugLoopInfoCallback);
+
+// Debug loop timer and callback function for the motion task
+void motionLoopInfoCallback(String &infoStr)
+{
+    infoStr = "Motion";
     infoStr += _workManager.getDebugStr();
     infoStr += _robotController.getDebugStr();
 }
-DebugLoopTimer debugLoopTimer(10000, debugLoopInfoCallback);
+DebugLoopTimer motionLoopTimer(10000, motionLoopInfoCallback);
+
+// Tasks - the workflow, evaluators and robot controller are serviced by a high priority task on the
+// application core so that slow network activity can't starve the planner - network services run
+// in a task on the protocol core (where the WiFi stack runs)
+static const int MOTION_TASK_CORE = 1;
+static const int MOTION_TASK_PRIORITY = 5;
+static const int MOTION_TASK_STACK_SIZE = 10000;
+static const int NETWORK_TASK_CORE = 0;
+static const int NETWORK_TASK_PRIORITY = 1;
+static const int NETWORK_TASK_STACK_SIZE = 8192;
+
+// Max time the motion task keeps servicing work before letting other tasks run
+static const uint32_t MOTION_TASK_MAX_BUSY_US = 2000;
+void motionTask(void *pvParameters);
+void networkTask(void *pvParameters);
+void networkService();
 
 // Setup
 void setup()
@@ -280,21 +303,85 @@ void setup()
     debugLoopTimer.blockAdd(9, "Sched");
     debugLoopTimer.blockAdd(10, "WifiLed");
     debugLoopTimer.blockAdd(11, "Status");
-    debugLoopTimer.blockAdd(12, "Flow");
-    debugLoopTimer.blockAdd(13, "Robot");
-    debugLoopTimer.blockAdd(14, "LedStrip");
+    debugLoopTimer.blockAdd(12, "LedStrip");
 
     // Reconfigure the robot and other settings
     _workManager.reconfigure();
 
+    // Add debug blocks for motion task
+    motionLoopTimer.blockAdd(0, "LoopTimer");
+    motionLoopTimer.blockAdd(1, "Flow");
+    motionLoopTimer.blockAdd(2, "Robot");
+
     // Handle statup commands
     _workManager.handleStartupCommands();
+
+    // Start tasks
+    xTaskCreatePinnedToCore(motionTask, "Motion", MOTION_TASK_STACK_SIZE, NULL, MOTION_TASK_PRIORITY, NULL, MOTION_TASK_CORE);
+    xTaskCreatePinnedToCore(networkTask, "Network", NETWORK_TASK_STACK_SIZE, NULL, NETWORK_TASK_PRIORITY, NULL, NETWORK_TASK_CORE);
 }
 
-// Loop
+// Loop - everything is handled by the tasks
 void loop()
 {
+    vTaskDelete(NULL);
+}
+
+// Motion task
+void motionTask(void *pvParameters)
+{
+    // Commands and status from other tasks now go through queues
+    _workManager.setServiceTask();
+
+    while (true)
+    {
+        // Debug loop Timing
+        motionLoopTimer.blockStart(0);
+        motionLoopTimer.service();
+        motionLoopTimer.blockEnd(0);
+
+        // Keep going while work is getting done (up to a time limit)
+        uint32_t startUs = micros();
+        bool workDone = false;
+        do
+        {
+            // Service the command interface (which pumps the workflow queue)
+            motionLoopTimer.blockStart(1);
+            workDone = _workManager.service();
+            motionLoopTimer.blockEnd(1);
+
+            // Service the robot controller
+            motionLoopTimer.blockStart(2);
+            _robotController.service();
+            motionLoopTimer.blockEnd(2);
+        } while (workDone && (micros() - startUs < MOTION_TASK_MAX_BUSY_US));
+
+        // Yield if the time limit was reached while work was still getting done - otherwise nothing
+        // can progress (e.g. the pipeline is full) so wait for up to a tick or until a command is
+        // queued from another task - yielding would only hand over to tasks of the same or higher
+        // priority and starve the rest of this core
+        if (workDone)
+            taskYIELD();
+        else
+            ulTaskNotifyTake(pdTRUE, 1);
+    }
+}
+
+// Network task
+void networkTask(void *pvParameters)
+{
+    while (true)
+    {
+        networkService();
 
+        // Let lower priority tasks run
+        vTaskDelay(1);
+    }
+}
+
+// Network services
+void networkService()
+{
     // Debug loop Timing
     debugLoopTimer.blockStart(0);
     debugLoopTimer.service();
@@ -365,21 +452,10 @@ void loop()
     }
     debugLoopTimer.blockEnd(11);
 
-    // Service the command interface (which pumps the workflow queue)
-    debugLoopTimer.blockStart(12);
-    _workManager.service();
-    debugLoopTimer.blockEnd(12);
-
-    // Service the robot controller
-    debugLoopTimer.blockStart(13);
-    _robotController.service();
-    debugLoopTimer.blockEnd(13);
-
     // Service the LED Strip
-    debugLoopTimer.blockStart(14);
+    debugLoopTimer.blockStart(12);
     ledStrip.service();
-    debugLoopTimer.blockEnd(14);
-
+    debugLoopTimer.blockEnd(12);
 }
 
 #endif // UNIT_TEST
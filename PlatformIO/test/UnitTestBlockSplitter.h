@@ -0,0 +1,200 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../src/RobotMotion/MotionControl/MotionBlockSplitter.h"
+#include "../src/RobotMotion/Robots/RobotSandTableScara.h"
+#include <ArduinoLog.h>
+#include <vector>
+
+// Same arms as the SandTableScaraPiHat configurations
+static const char* UnitTestBlockSplitter_Config = R"strDelim(
+    {"axis0":{"maxSpeed":75.0,"maxAcc":150.0,"stepsPerRot":9600,"maxVal":92.5},
+     "axis1":{"maxSpeed":75.0,"maxAcc":150.0,"stepsPerRot":9600,"maxVal":92.5}}
+    )strDelim";
+
+// Tests/TestThetaRho/testThetaRho10Spiral.thr and testThetaRho100Spiral.thr
+static const char* UnitTestBlockSplitter_Spiral10 = "0 0\n62.8 1\n";
+static const char* UnitTestBlockSplitter_Spiral100 = "0, 0\n628, 1\n";
+
+// Every 20th point of Tests/TestThetaRho/sandify-star.thr
+static const char* UnitTestBlockSplitter_Star =
+    "1.57080 0.03889\n-0.45711 0.08246\n-2.36167 0.06841\n-3.88254 0.09967\n-5.18006 0.11558\n-6.41804 0.12259\n"
+    "-7.53487 0.11330\n-8.49077 0.10361\n-9.37282 0.15417\n-10.41903 0.21876\n-11.39317 0.15139\n-12.04338 0.15162\n"
+    "-12.95065 0.25125\n-13.78776 0.15102\n-14.36764 0.21526\n-15.29420 0.20725\n-15.79192 0.18785\n-16.65034 0.25106\n"
+    "-17.15980 0.17991\n-17.94172 0.27681\n-18.43591 0.18706\n-19.21042 0.29301\n-19.66756 0.20126\n-20.44125 0.29000\n"
+    "-20.83213 0.23115\n-21.62605 0.26902\n-21.96969 0.28032\n-22.73549 0.23373\n-23.12902 0.34215\n-23.75056 0.19994\n"
+    "-24.29517 0.36762\n-24.69343 0.24416\n-25.40522 0.29891\n-25.71783 0.33551\n-26.35828 0.22763\n-26.82708 0.40006\n"
+    "-27.18011 0.27336\n-27.86548 0.29574\n-28.17419 0.40424\n-28.65624 0.23875\n-29.24317 0.35595\n-29.50997 0.37255\n"
+    "-30.06073 0.23877\n-30.55997 0.40019\n-30.81989 0.36071\n-31.39733 0.25847\n-31.84121 0.42594\n-32.09435 0.36712\n"
+    "-32.65764 0.26619\n-33.09547 0.43251\n-33.33362 0.39136\n-33.84795 0.26207\n-34.32272 0.42025\n-34.54673 0.43430\n"
+    "-35.00008 0.27554\n-35.51529 0.39055\n-35.74637 0.49744\n-36.08958 0.32227\n-36.67588 0.35491\n-36.95842 0.53981\n"
+    "-37.20688 0.38461\n-37.76031 0.30997\n-38.14018 0.47807\n-38.33990 0.47134\n-38.74138 0.30953\n-39.26520 0.40300\n"
+    "-39.49680 0.58333\n-39.75177 0.39793\n-40.28003 0.32532\n-40.65140 0.49142\n-40.83750 0.52112\n-41.17253 0.35064\n"
+    "-41.70373 0.38431\n-41.98141 0.56525\n-42.18414 0.47174\n-42.60479 0.31984\n-43.06743 0.44168\n-43.28766 0.63000\n"
+    "-43.51581 0.44315\n-43.97902 0.32988\n-44.38185 0.48419\n-44.57568 0.61599\n-44.82058 0.43306\n-45.29564 0.34968\n"
+    "-45.66413 0.50929\n-45.84712 0.62176\n-46.09169 0.43980\n-46.55682 0.35741\n-46.92085 0.51617\n-47.10172 0.64708\n"
+    "-47.32979 0.46306\n-47.76596 0.35316\n-48.15231 0.50511\n-48.34213 0.69222\n-48.54210 0.50385\n-48.93767 0.35684\n"
+    "-49.35323 0.47746\n-49.57230 0.66256\n-49.73920 0.56397\n-50.05784 0.40080\n-50.51109 0.43633\n-50.77785 0.61104\n"
+    "-50.93142 0.64520\n-51.17390 0.46700\n-51.60253 0.38832\n-51.94946 0.54393\n-52.13017 0.73464\n-52.30390 0.55849\n"
+    "-52.63895 0.40231\n-53.06390 0.46674\n-53.31068 0.64334\n-53.45577 0.67624\n-53.68222 0.49671\n-54.07856 0.39198\n"
+    "-54.43988 0.54040\n-54.63155 0.72745\n-54.78031 0.62564\n-55.05255 0.45741\n-55.49231 0.44447\n-55.77803 0.61000\n"
+    "-55.93028 0.77565\n-56.10364 0.58659\n-56.41968 0.43048\n-56.84079 0.48904\n-57.08346 0.66332\n-57.22067 0.75190\n"
+    "-57.40952 0.56689\n-57.75251 0.41970\n-58.14621 0.52017\n-58.36677 0.69843\n-58.49782 0.74800\n-58.69201 0.56498\n"
+    "-59.04152 0.42150\n-59.41946 0.53561\n-59.63275 0.71460\n-59.76047 0.76353\n-59.94918 0.58007\n-60.28514 0.43446\n"
+    "-60.66416 0.53489\n-60.88275 0.71171\n";
+
+class UnitTestBlockSplitter
+{
+public:
+    static constexpr float TOLERANCE_MM = 0.2f;
+    static constexpr float FIXED_BLOCK_MM = 1.0f;
+    static constexpr float THR_STEP_RADS = M_PI / 64;
+    static constexpr float BED_RADIUS_MM = 184.0f;
+    static constexpr float CENTRE_ZONE_MM = 1.0f;
+    static constexpr float STEP_ROUNDING_MM = 0.05f;
+    // Points within each block measured - more than the splitter checks
+    static const int NUM_MEASURE_PTS = 7;
+
+    AxesParams _axesParams;
+    ptToActuatorFnType _ptToActuatorFn;
+    actuatorToPtFnType _actuatorToPtFn;
+    correctStepOverflowFnType _correctStepOverflowFn;
+
+    void setupAxes()
+    {
+        _axesParams.clearAxes();
+        String axisJSON;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            _axesParams.configureAxis(UnitTestBlockSplitter_Config, axisIdx, axisJSON);
+        _ptToActuatorFn = RobotSandTableScara::testGetPtToActuator();
+        _actuatorToPtFn = RobotSandTableScara::testGetActuatorToPt();
+        _correctStepOverflowFn = RobotSandTableScara::testGetCorrectStepOverflow();
+    }
+
+    // Convert theta-rho to XY points - lines are either interpolated in steps of theta or
+    // left as straight XY lines between the points
+    void thrToXY(const char* pThr, bool interpolate, std::vector<AxisFloats>& pts)
+    {
+        float prevTheta = 0, prevRho = 0;
+        bool isFirst = true;
+        const char* pStr = pThr;
+        while (*pStr)
+        {
+            char* pNext = nullptr;
+            float theta = strtod(pStr, &pNext);
+            while ((*pNext == ',') || (*pNext == ' '))
+                pNext++;
+            float rho = strtod(pNext, &pNext);
+            pStr = strchr(pNext, '\n');
+            pStr = pStr ? pStr + 1 : pNext + strlen(pNext);
+            int numSteps = (isFirst || !interpolate) ? 1 : std::max(1, int(ceilf(fabsf(theta - prevTheta) / THR_STEP_RADS)));
+            for (int stepIdx = 1; stepIdx <= numSteps; stepIdx++)
+            {
+                float t = (numSteps == 1) ? theta : prevTheta + (theta - prevTheta) * stepIdx / numSteps;
+                float r = (numSteps == 1) ? rho : prevRho + (rho - prevRho) * stepIdx / numSteps;
+                pts.push_back(AxisFloats(sinf(t) * r * BED_RADIUS_MM, cosf(t) * r * BED_RADIUS_MM));
+            }
+            prevTheta = theta;
+            prevRho = rho;
+            isFirst = false;
+        }
+    }
+
+    bool isNearCentre(AxisFloats& pt)
+    {
+        return (fabsf(pt.getVal(0)) <= CENTRE_ZONE_MM) && (fabsf(pt.getVal(1)) <= CENTRE_ZONE_MM);
+    }
+
+    // Move as the planner would and measure how far the actuator path strays from the line
+    // the splitter is set up for
+    void addBlock(MotionBlockSplitter& splitter, AxisFloats& lineStart, AxisFloats& lineEnd,
+                AxisFloats& blockEnd, AxisPosition& curPos, float& maxDevMM)
+    {
+        AxisFloats endActuator;
+        TEST_ASSERT_TRUE(_ptToActuatorFn(blockEnd, endActuator, curPos, _axesParams, false));
+        // Points near the centre are moved to the centre by the kinematics so they aren't measured
+        if (!isNearCentre(lineStart) && !isNearCentre(lineEnd))
+            maxDevMM = std::max(maxDevMM, splitter.blockDeviationMM(curPos, blockEnd, _axesParams, NUM_MEASURE_PTS));
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            curPos._stepsFromHome.setVal(axisIdx, int32_t(roundf(endActuator.getVal(axisIdx))));
+        curPos._axisPositionMM = blockEnd;
+        _correctStepOverflowFn(curPos, _axesParams);
+    }
+
+    // Split every move into fixed length blocks or adaptively
+    void splitMoves(std::vector<AxisFloats>& pts, bool adaptive, int& numBlocks, float& maxDevMM)
+    {
+        MotionBlockSplitter splitter;
+        splitter.setTransforms(_ptToActuatorFn, _actuatorToPtFn);
+        AxisPosition curPos;
+        curPos.clear();
+        curPos._axisPositionMM.set(0, 0);
+        numBlocks = 0;
+        maxDevMM = 0;
+        for (AxisFloats& lineEnd : pts)
+        {
+            AxisFloats lineStart = curPos._axisPositionMM;
+            AxisFloats blockEnd;
+            splitter.setup(lineStart, lineEnd, TOLERANCE_MM, false);
+            if (adaptive)
+            {
+                while (!splitter.isDone())
+                {
+                    splitter.nextBlockEnd(curPos, _axesParams, blockEnd);
+                    addBlock(splitter, lineStart, lineEnd, blockEnd, curPos, maxDevMM);
+                    numBlocks++;
+                }
+            }
+            else
+            {
+                float lineLen = sqrtf(powf(lineEnd.getVal(0) - lineStart.getVal(0), 2) +
+                            powf(lineEnd.getVal(1) - lineStart.getVal(1), 2));
+                int numFixed = std::max(1, int(ceilf(lineLen / FIXED_BLOCK_MM)));
+                for (int blockIdx = 1; blockIdx <= numFixed; blockIdx++)
+                {
+                    blockEnd = lineStart + (lineEnd - lineStart) * (float(blockIdx) / numFixed);
+                    addBlock(splitter, lineStart, lineEnd, blockEnd, curPos, maxDevMM);
+                    numBlocks++;
+                }
+            }
+        }
+    }
+
+    // Adaptive splitting keeps within tolerance using fewer blocks than fixed length splitting
+    void testThrFiles()
+    {
+        setupAxes();
+        struct
+        {
+            const char* _name;
+            const char* _thr;
+            bool _interpolate;
+        } thrFiles[] = {
+            { "testThetaRho10Spiral", UnitTestBlockSplitter_Spiral10, true },
+            { "testThetaRho100Spiral", UnitTestBlockSplitter_Spiral100, true },
+            { "sandify-star", UnitTestBlockSplitter_Star, true },
+            { "sandify-star XY lines", UnitTestBlockSplitter_Star, false }
+        };
+        for (auto& thrFile : thrFiles)
+        {
+            std::vector<AxisFloats> pts;
+            thrToXY(thrFile._thr, thrFile._interpolate, pts);
+            int fixedBlocks = 0, adaptiveBlocks = 0;
+            float fixedDevMM = 0, adaptiveDevMM = 0;
+            splitMoves(pts, false, fixedBlocks, fixedDevMM);
+            splitMoves(pts, true, adaptiveBlocks, adaptiveDevMM);
+            Serial.printf("UnitTestBlockSplitter %s moves %d fixed %.1fmm blocks %d maxDev %.3fmm adaptive %.2fmm blocks %d maxDev %.3fmm\n",
+                        thrFile._name, pts.size(), FIXED_BLOCK_MM, fixedBlocks, fixedDevMM,
+                        TOLERANCE_MM, adaptiveBlocks, adaptiveDevMM);
+            TEST_ASSERT_TRUE(adaptiveBlocks < fixedBlocks);
+            // Allow for positions being rounded to whole steps
+            TEST_ASSERT_TRUE(adaptiveDevMM <= TOLERANCE_MM + STEP_ROUNDING_MM);
+        }
+    }
+
+    void runTests()
+    {
+        testThrFiles();
+    }
+};
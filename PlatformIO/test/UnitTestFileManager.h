@@ -0,0 +1,141 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "FileManager.h"
+#include "ConfigBase.h"
+#include <ArduinoLog.h>
+
+class UnitTestFileManager
+{
+public:
+    static const int BENCHMARK_NUM_LINES = 5000;
+    static const int LINE_BUF_MAXLEN = 1000;
+
+    FileManager _fileManager;
+
+    UnitTestFileManager()
+    {
+        ConfigBase config("{\"fileManager\":{\"spiffsEnabled\":1,\"spiffsFormatIfCorrupt\":1}}");
+        _fileManager.setup(config);
+    }
+
+    // Write a theta-rho file with a comment line, a CRLF line ending and no newline at the end
+    bool writeThrFile(const char* pFilename, int numLines)
+    {
+        FILE* pFile = fopen(pFilename, "wb");
+        if (!pFile)
+            return false;
+        fprintf(pFile, "# Test pattern\n");
+        fprintf(pFile, "0.00000 0.00000\r\n");
+        for (int i = 1; i < numLines - 2; i++)
+            fprintf(pFile, "%0.5f %0.5f\n", i * 0.0123, (i % 1000) / 1000.0);
+        fprintf(pFile, "%0.5f %0.5f", numLines * 0.0123, 1.0);
+        fclose(pFile);
+        return true;
+    }
+
+    // Simple hash of the lines read so the two paths can be compared
+    uint32_t hashLine(uint32_t hash, const char* pLine)
+    {
+        while (*pLine)
+            hash = hash * 31 + *pLine++;
+        return hash * 31 + '\n';
+    }
+
+    // Lines are handed out without line endings and the final chunk follows the last line
+    void testReadByLine()
+    {
+        TEST_ASSERT_TRUE(writeThrFile("/spiffs/__test__.thr", 5));
+        TEST_ASSERT_TRUE(_fileManager.chunkedFileStart("spiffs", "/__test__.thr", true, this));
+        const char* expectedLines[] = { "# Test pattern", "0.00000 0.00000", "0.01230 0.00100", "0.02460 0.00200", "0.06150 1.00000" };
+        String filename;
+        int fileLen = 0, chunkPos = 0, chunkLen = 0;
+        bool finalChunk = false;
+        for (const char* pExpected : expectedLines)
+        {
+            uint8_t* pLine = _fileManager.chunkFileNext(this, filename, fileLen, chunkPos, chunkLen, finalChunk);
+            TEST_ASSERT_NOT_NULL(pLine);
+            TEST_ASSERT_FALSE(finalChunk);
+            TEST_ASSERT_EQUAL_STRING(pExpected, (char*)pLine);
+            TEST_ASSERT_EQUAL_INT(strlen(pExpected), chunkLen);
+        }
+        _fileManager.chunkFileNext(this, filename, fileLen, chunkPos, chunkLen, finalChunk);
+        TEST_ASSERT_TRUE(finalChunk);
+        TEST_ASSERT_EQUAL_INT(0, chunkLen);
+        TEST_ASSERT_NULL(_fileManager.chunkFileNext(this, filename, fileLen, chunkPos, chunkLen, finalChunk));
+
+        // The session belongs to its owner until it is ended
+        int otherOwner = 0;
+        TEST_ASSERT_FALSE(_fileManager.chunkedFileStart("spiffs", "/__test__.thr", true, &otherOwner));
+        _fileManager.chunkedFileEnd(&otherOwner);
+        TEST_ASSERT_TRUE(_fileManager.chunkedFileStart("spiffs", "/__test__.thr", true, this));
+        TEST_ASSERT_NULL(_fileManager.chunkFileNext(&otherOwner, filename, fileLen, chunkPos, chunkLen, finalChunk));
+        TEST_ASSERT_NOT_NULL(_fileManager.chunkFileNext(this, filename, fileLen, chunkPos, chunkLen, finalChunk));
+        _fileManager.chunkedFileEnd(this);
+        TEST_ASSERT_TRUE(_fileManager.chunkedFileStart("spiffs", "/__test__.thr", true, &otherOwner));
+        _fileManager.chunkedFileEnd(&otherOwner);
+        _fileManager.deleteFile("spiffs", "/__test__.thr");
+    }
+
+    // Read a long theta-rho file line by line opening the file for each line (the previous
+    // chunked file implementation) and with the file kept open and read ahead
+    void benchmark()
+    {
+        const char* pFilename = "/spiffs/__bench__.thr";
+        TEST_ASSERT_TRUE(writeThrFile(pFilename, BENCHMARK_NUM_LINES));
+
+        // Previous implementation - open, seek, read a line and close for every line
+        char lineBuf[LINE_BUF_MAXLEN];
+        uint32_t startUs = micros();
+        uint32_t reopenHash = 0;
+        int reopenLines = 0;
+        long filePos = 0;
+        while (true)
+        {
+            FILE* pFile = fopen(pFilename, "r");
+            TEST_ASSERT_NOT_NULL(pFile);
+            if (filePos != 0)
+                TEST_ASSERT_EQUAL_INT(0, fseek(pFile, filePos, SEEK_SET));
+            char* pLine = _fileManager.readLineFromFile(lineBuf, LINE_BUF_MAXLEN-1, pFile);
+            filePos = ftell(pFile);
+            fclose(pFile);
+            if (!pLine)
+                break;
+            reopenHash = hashLine(reopenHash, pLine);
+            reopenLines++;
+        }
+        uint32_t reopenUs = micros() - startUs;
+
+        // Chunked file session
+        startUs = micros();
+        uint32_t sessionHash = 0;
+        int sessionLines = 0;
+        TEST_ASSERT_TRUE(_fileManager.chunkedFileStart("spiffs", "/__bench__.thr", true, this));
+        String filename;
+        int fileLen = 0, chunkPos = 0, chunkLen = 0;
+        bool finalChunk = false;
+        while (true)
+        {
+            uint8_t* pLine = _fileManager.chunkFileNext(this, filename, fileLen, chunkPos, chunkLen, finalChunk);
+            if (!pLine || finalChunk)
+                break;
+            sessionHash = hashLine(sessionHash, (char*)pLine);
+            sessionLines++;
+        }
+        uint32_t sessionUs = micros() - startUs;
+        _fileManager.deleteFile("spiffs", "/__bench__.thr");
+
+        TEST_ASSERT_EQUAL_INT(BENCHMARK_NUM_LINES, reopenLines);
+        TEST_ASSERT_EQUAL_INT(BENCHMARK_NUM_LINES, sessionLines);
+        TEST_ASSERT_EQUAL_UINT32(reopenHash, sessionHash);
+        Serial.printf("UnitTestFileManager benchmark %d lines (%d bytes) open per line %uus, read ahead %uus\n",
+                    BENCHMARK_NUM_LINES, fileLen, reopenUs, sessionUs);
+    }
+
+    void runTests()
+    {
+        testReadByLine();
+        benchmark();
+    }
+};
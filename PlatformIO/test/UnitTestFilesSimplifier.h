@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../src/WorkManager/Evaluators/EvaluatorFiles_Simplifier.h"
+#include <ArduinoLog.h>
+#include <vector>
+
+class UnitTestFilesSimplifier
+{
+public:
+    static constexpr double TOLERANCE_MM = 0.1;
+    static const int NUM_CIRCLE_PTS = 1000;
+    static constexpr double CIRCLE_RADIUS_MM = 100;
+
+    EvaluatorFiles_Simplifier _simplifier;
+
+    // Lines are the index of the point so points which were dropped can be found
+    void drain(std::vector<int>& keptIdxs)
+    {
+        String line;
+        while (_simplifier.getNextLine(line))
+            keptIdxs.push_back(line.toInt());
+    }
+
+    // Dense points on a circle are reduced and the points removed stay within tolerance of the result
+    void testCircle()
+    {
+        _simplifier.setTolerance(TOLERANCE_MM);
+        _simplifier.clear(true);
+        std::vector<double> ptX, ptY;
+        std::vector<int> keptIdxs;
+        for (int ptIdx = 0; ptIdx < NUM_CIRCLE_PTS; ptIdx++)
+        {
+            double angle = ptIdx * 2 * M_PI / NUM_CIRCLE_PTS;
+            ptX.push_back(CIRCLE_RADIUS_MM * cos(angle));
+            ptY.push_back(CIRCLE_RADIUS_MM * sin(angle));
+            _simplifier.addPoint(ptX.back(), ptY.back(), String(ptIdx), false);
+            drain(keptIdxs);
+        }
+        _simplifier.flush();
+        drain(keptIdxs);
+        TEST_ASSERT_EQUAL_INT(NUM_CIRCLE_PTS, _simplifier.getNumPointsIn());
+        TEST_ASSERT_EQUAL_INT(keptIdxs.size(), _simplifier.getNumPointsOut());
+        TEST_ASSERT_EQUAL_INT(0, keptIdxs.front());
+        TEST_ASSERT_EQUAL_INT(NUM_CIRCLE_PTS - 1, keptIdxs.back());
+        Log.notice("UnitTestFilesSimplifier circle %d points simplified to %d\n", NUM_CIRCLE_PTS, keptIdxs.size());
+        TEST_ASSERT_TRUE(keptIdxs.size() < NUM_CIRCLE_PTS / 4);
+
+        // Check distance of each removed point from the simplified line
+        for (unsigned int keptIdx = 1; keptIdx < keptIdxs.size(); keptIdx++)
+        {
+            int startIdx = keptIdxs[keptIdx - 1];
+            int endIdx = keptIdxs[keptIdx];
+            TEST_ASSERT_TRUE(endIdx > startIdx);
+            double segX = ptX[endIdx] - ptX[startIdx];
+            double segY = ptY[endIdx] - ptY[startIdx];
+            double segLen = sqrt(segX * segX + segY * segY);
+            for (int ptIdx = startIdx + 1; ptIdx < endIdx; ptIdx++)
+            {
+                double dist = fabs((ptX[ptIdx] - ptX[startIdx]) * segY - (ptY[ptIdx] - ptY[startIdx]) * segX) / segLen;
+                TEST_ASSERT_TRUE(dist <= TOLERANCE_MM);
+            }
+        }
+    }
+
+    // Points which must be kept and other lines are output in order
+    void testOtherLines()
+    {
+        _simplifier.setTolerance(TOLERANCE_MM);
+        _simplifier.clear(true);
+        std::vector<int> keptIdxs;
+        _simplifier.addPoint(0, 0, "0", false);
+        _simplifier.addPoint(1, 0, "1", false);
+        _simplifier.addPoint(2, 0, "2", true);
+        _simplifier.addPoint(3, 0, "3", false);
+        _simplifier.addPoint(4, 0, "4", false);
+        _simplifier.addOtherLine("5");
+        _simplifier.addPoint(6, 0, "6", false);
+        _simplifier.addPoint(7, 0, "7", false);
+        _simplifier.flush();
+        drain(keptIdxs);
+        std::vector<int> expected = { 0, 1, 2, 4, 5, 6, 7 };
+        TEST_ASSERT_EQUAL_INT(expected.size(), keptIdxs.size());
+        for (unsigned int idx = 0; idx < expected.size(); idx++)
+            TEST_ASSERT_EQUAL_INT(expected[idx], keptIdxs[idx]);
+
+        // Disabled
+        _simplifier.setTolerance(0);
+        _simplifier.clear(true);
+        keptIdxs.clear();
+        for (int ptIdx = 0; ptIdx < 5; ptIdx++)
+            _simplifier.addPoint(ptIdx, 0, String(ptIdx), false);
+        drain(keptIdxs);
+        TEST_ASSERT_EQUAL_INT(5, keptIdxs.size());
+    }
+
+    void runTests()
+    {
+        testCircle();
+        testOtherLines();
+    }
+};
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../src/WorkManager/Evaluators/EvaluatorGCode.h"
+#include "../src/RobotMotion/MotionControl/MotionArc.h"
+#include <ArduinoLog.h>
+#include <vector>
+
+class UnitTestGCode
+{
+public:
+    static const int BENCHMARK_NUM_LINES = 1000;
+    static const int BENCHMARK_REPEATS = 1000;
+
+    // Lines are lexed into commands and args and the modal state is carried between lines
+    void testLexer()
+    {
+        GCodeModalState modalState;
+        GCodeLine gcodeLine;
+
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G0 X100 Y-100.5", 15, modalState, gcodeLine));
+        TEST_ASSERT_EQUAL_INT('G', gcodeLine.cmdLetter);
+        TEST_ASSERT_EQUAL_INT(0, gcodeLine.cmdNum);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 100, gcodeLine.cmdArgs.getValMM(0));
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, -100.5, gcodeLine.cmdArgs.getValMM(1));
+        TEST_ASSERT_FALSE(gcodeLine.cmdArgs.isValid(2));
+        TEST_ASSERT_FALSE(gcodeLine.cmdArgs.isFeedrateValid());
+
+        // Length limits the line - no space needed between words
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("g1x5y6;G0 Z9", 6, modalState, gcodeLine));
+        TEST_ASSERT_EQUAL_INT(1, gcodeLine.cmdNum);
+        TEST_ASSERT_TRUE(gcodeLine.cmdArgs.isValid(1));
+        TEST_ASSERT_FALSE(gcodeLine.cmdArgs.isValid(2));
+
+        // Axis letters without a value (used for homing)
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G28 XY", 6, modalState, gcodeLine));
+        TEST_ASSERT_TRUE(gcodeLine.cmdArgs.isValid(0) && gcodeLine.cmdArgs.isValid(1));
+        TEST_ASSERT_FALSE(gcodeLine.cmdArgs.isValid(2));
+
+        // Comments
+        const char* commentLine = "  (start) G1 (X5) Y7 ; Z9";
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine(commentLine, strlen(commentLine), modalState, gcodeLine));
+        TEST_ASSERT_FALSE(gcodeLine.cmdArgs.isValid(0));
+        TEST_ASSERT_TRUE(gcodeLine.cmdArgs.isValid(1));
+        TEST_ASSERT_FALSE(gcodeLine.cmdArgs.isValid(2));
+        TEST_ASSERT_FALSE(EvaluatorGCode::parseLine("; G1 X1", 7, modalState, gcodeLine));
+        TEST_ASSERT_FALSE(EvaluatorGCode::parseLine("", 0, modalState, gcodeLine));
+
+        // Line numbers and checksums
+        const char* numberedLine = "N10 G1 X1";
+        uint8_t checksum = 0;
+        for (const char* pCh = numberedLine; *pCh; pCh++)
+            checksum ^= *pCh;
+        String goodLine = String(numberedLine) + "*" + String(checksum);
+        String badLine = String(numberedLine) + "*" + String((checksum + 1) & 0xff);
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine(goodLine.c_str(), goodLine.length(), modalState, gcodeLine));
+        TEST_ASSERT_EQUAL_INT(10, gcodeLine.lineNum);
+        TEST_ASSERT_FALSE(EvaluatorGCode::parseLine(badLine.c_str(), badLine.length(), modalState, gcodeLine));
+
+        // Feedrate is modal for G1
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G1 X1 F1200", 11, modalState, gcodeLine));
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G1 X2", 5, modalState, gcodeLine));
+        TEST_ASSERT_TRUE(gcodeLine.cmdArgs.isFeedrateValid());
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 1200, gcodeLine.cmdArgs.getFeedrate());
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G0 X2", 5, modalState, gcodeLine));
+        TEST_ASSERT_FALSE(gcodeLine.cmdArgs.isFeedrateValid());
+
+        // Units and distance mode
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G20", 3, modalState, gcodeLine));
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G1 X2", 5, modalState, gcodeLine));
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 50.8, gcodeLine.cmdArgs.getValMM(0));
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G91 G21", 7, modalState, gcodeLine));
+        TEST_ASSERT_TRUE(modalState.isRelative);
+        TEST_ASSERT_FALSE(modalState.unitsInches);
+        TEST_ASSERT_EQUAL_INT(91, gcodeLine.cmdNum);
+        TEST_ASSERT_EQUAL_INT(1, gcodeLine.numModalGWords);
+        TEST_ASSERT_EQUAL_INT(21, gcodeLine.modalGWords[0]);
+
+        // Modal G words are held apart from the command whatever the order
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G90 G1 X1 G21", 13, modalState, gcodeLine));
+        TEST_ASSERT_EQUAL_INT(1, gcodeLine.cmdNum);
+        TEST_ASSERT_EQUAL_INT(2, gcodeLine.numModalGWords);
+        TEST_ASSERT_EQUAL_INT(90, gcodeLine.modalGWords[0]);
+        TEST_ASSERT_EQUAL_INT(21, gcodeLine.modalGWords[1]);
+        TEST_ASSERT_FALSE(modalState.isRelative);
+
+        // Moves take absolute or relative from the modal state of their own source
+        GCodeModalState otherModalState;
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G91", 3, otherModalState, gcodeLine));
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G1 X1", 5, otherModalState, gcodeLine));
+        TEST_ASSERT_EQUAL_INT(RobotMoveTypeArg_Relative, gcodeLine.cmdArgs.getMoveType());
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G1 X1", 5, modalState, gcodeLine));
+        TEST_ASSERT_EQUAL_INT(RobotMoveTypeArg_Absolute, gcodeLine.cmdArgs.getMoveType());
+
+        // Block delete
+        TEST_ASSERT_FALSE(EvaluatorGCode::parseLine("/G1 X5", 6, modalState, gcodeLine));
+        TEST_ASSERT_FALSE(EvaluatorGCode::parseLine(" /G91", 5, modalState, gcodeLine));
+        TEST_ASSERT_FALSE(modalState.isRelative);
+
+        // Lines with more than one command which isn't modal can't be executed
+        TEST_ASSERT_FALSE(EvaluatorGCode::parseLine("G0 G1 X1", 8, modalState, gcodeLine));
+        TEST_ASSERT_FALSE(EvaluatorGCode::parseLine("G28 M84", 7, modalState, gcodeLine));
+
+        // Path blending tolerance is modal and set on each move
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G64 P0.2", 8, modalState, gcodeLine));
+        TEST_ASSERT_EQUAL_INT(64, gcodeLine.cmdNum);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 0.2, modalState.pathBlendToleranceMM);
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G1 X1", 5, modalState, gcodeLine));
+        TEST_ASSERT_TRUE(gcodeLine.cmdArgs.isPathBlendValid());
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 0.2, gcodeLine.cmdArgs.getPathBlendTolerance());
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G61 G1 X2", 9, modalState, gcodeLine));
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 0, gcodeLine.cmdArgs.getPathBlendTolerance());
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G64", 3, modalState, gcodeLine));
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G1 X3", 5, modalState, gcodeLine));
+        TEST_ASSERT_TRUE(gcodeLine.cmdArgs.getPathBlendTolerance() < 0);
+    }
+
+    // Arcs are parsed with I/J or R and split into segments within the chord tolerance
+    void testArcs()
+    {
+        GCodeModalState modalState;
+        GCodeLine gcodeLine;
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G2 X10 Y0 I5 J0 F600", 20, modalState, gcodeLine));
+        TEST_ASSERT_EQUAL_INT(2, gcodeLine.cmdNum);
+        TEST_ASSERT_TRUE(gcodeLine.cmdArgs.isArcCentreValid());
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 5, gcodeLine.cmdArgs.getArcCentreOffset(0));
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G3 X0 Y10 R-10", 14, modalState, gcodeLine));
+        TEST_ASSERT_TRUE(gcodeLine.cmdArgs.isArcRadiusValid());
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, -10, gcodeLine.cmdArgs.getArcRadius());
+        TEST_ASSERT_EQUAL_INT(RobotMoveTypeArg_Absolute, gcodeLine.cmdArgs.getMoveType());
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 600, gcodeLine.cmdArgs.getFeedrate());
+        TEST_ASSERT_TRUE(EvaluatorGCode::parseLine("G1 X1 R", 7, modalState, gcodeLine));
+        TEST_ASSERT_FALSE(gcodeLine.cmdArgs.isArcRadiusValid());
+        TEST_ASSERT_EQUAL_INT(RobotMoveTypeArg_Relative, gcodeLine.cmdArgs.getMoveType());
+
+        // Semicircle clockwise - every segment end is on the arc and chords are within tolerance
+        const float tolerance = 0.01f;
+        AxisFloats startPos(0, 0, 0);
+        AxisFloats endPos(10, 0, 2);
+        MotionArc arc;
+        TEST_ASSERT_TRUE(arc.setupFromCentre(startPos, endPos, 5, 0, true));
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, -M_PI, arc.getSweepRads());
+        int numSegments = arc.getNumSegments(tolerance, 0);
+        TEST_ASSERT_TRUE(numSegments > 10 && numSegments < 100);
+        AxisFloats prevPt = startPos;
+        for (int i = 0; i < numSegments; i++)
+        {
+            AxisFloats pt;
+            arc.getSegmentEnd(i, numSegments, pt);
+            TEST_ASSERT_FLOAT_WITHIN(1e-3, 5, hypotf(pt.getVal(0) - 5, pt.getVal(1)));
+            TEST_ASSERT_TRUE(pt.getVal(1) >= -1e-4);
+            TEST_ASSERT_FLOAT_WITHIN(1e-3, 2.0 * (i + 1) / numSegments, pt.getVal(2));
+            float midX = (pt.getVal(0) + prevPt.getVal(0)) / 2;
+            float midY = (pt.getVal(1) + prevPt.getVal(1)) / 2;
+            TEST_ASSERT_TRUE(5 - hypotf(midX - 5, midY) <= tolerance + 1e-4);
+            prevPt = pt;
+        }
+        TEST_ASSERT_TRUE(prevPt == endPos);
+        TEST_ASSERT_TRUE(arc.getNumSegments(tolerance, 0.1) >= int(ceil(5 * M_PI / 0.1)));
+
+        // Radius form - positive for the short way round and negative for the long way
+        AxisFloats diagPos(10, 10, 0);
+        TEST_ASSERT_TRUE(arc.setupFromRadius(startPos, diagPos, 10, true));
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, -M_PI / 2, arc.getSweepRads());
+        TEST_ASSERT_TRUE(arc.setupFromRadius(startPos, diagPos, -10, true));
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, -3 * M_PI / 2, arc.getSweepRads());
+        TEST_ASSERT_TRUE(arc.setupFromRadius(startPos, diagPos, 10, false));
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, M_PI / 2, arc.getSweepRads());
+        TEST_ASSERT_FALSE(arc.setupFromRadius(startPos, diagPos, 2, true));
+
+        // Same start and end is a full circle
+        TEST_ASSERT_TRUE(arc.setupFromCentre(startPos, startPos, 0, 5, false));
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 2 * M_PI, arc.getSweepRads());
+    }
+
+    // Lex the lines of a buffer
+    uint32_t lexLines(const char* pBuf, int bufLen, int& numLines, int& numCmds, double& sumX)
+    {
+        GCodeModalState modalState;
+        GCodeLine gcodeLine;
+        numLines = 0;
+        numCmds = 0;
+        sumX = 0;
+        uint32_t startUs = micros();
+        const char* pEnd = pBuf + bufLen;
+        const char* pLine = pBuf;
+        while (pLine < pEnd)
+        {
+            const char* pLineEnd = (const char*)memchr(pLine, '\n', pEnd - pLine);
+            if (!pLineEnd)
+                pLineEnd = pEnd;
+            if (EvaluatorGCode::parseLine(pLine, pLineEnd - pLine, modalState, gcodeLine))
+            {
+                numCmds++;
+                sumX += gcodeLine.cmdArgs.getValMM(0);
+            }
+            numLines++;
+            pLine = pLineEnd + 1;
+        }
+        return micros() - startUs;
+    }
+
+    // Lex Tests/TestGCode/test1.gcode and a large generated file
+    void benchmark()
+    {
+        static const char* test1GCode = "G28\nG0 X100 Y100\nG0 X100 Y-100\nG0 X-100 Y-100\nG0 X-100 Y100\nG0 X100 Y100\n";
+        int numLines = 0, numCmds = 0;
+        double sumX = 0;
+        uint32_t elapsedUs = 0;
+        for (int i = 0; i < BENCHMARK_REPEATS; i++)
+            elapsedUs += lexLines(test1GCode, strlen(test1GCode), numLines, numCmds, sumX);
+        TEST_ASSERT_EQUAL_INT(6, numLines);
+        TEST_ASSERT_EQUAL_INT(6, numCmds);
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 100, sumX);
+        Serial.printf("UnitTestGCode benchmark test1.gcode %u lines/s\n",
+                    (uint32_t)(numLines * BENCHMARK_REPEATS * 1000000.0 / (elapsedUs ? elapsedUs : 1)));
+
+        // Generated file with line numbers, checksums and comments
+        std::vector<char> genGCode;
+        genGCode.reserve(BENCHMARK_NUM_LINES * 48);
+        char lineBuf[80];
+        double expectedSumX = 0;
+        for (int i = 0; i < BENCHMARK_NUM_LINES; i++)
+        {
+            int x = (i * 37) % 20000 - 10000;
+            expectedSumX += x / 100.0;
+            int len = snprintf(lineBuf, sizeof(lineBuf), "N%d G1 X%.2f Y%.1f F3000 (seg %d)",
+                        i, x / 100.0, (i % 300) - 150.5, i);
+            uint8_t checksum = 0;
+            for (int j = 0; j < len; j++)
+                checksum ^= lineBuf[j];
+            len += snprintf(lineBuf + len, sizeof(lineBuf) - len, "*%d\n", checksum);
+            genGCode.insert(genGCode.end(), lineBuf, lineBuf + len);
+        }
+        elapsedUs = 0;
+        for (int i = 0; i < BENCHMARK_REPEATS / 50; i++)
+            elapsedUs += lexLines(genGCode.data(), genGCode.size(), numLines, numCmds, sumX);
+        TEST_ASSERT_EQUAL_INT(BENCHMARK_NUM_LINES, numLines);
+        TEST_ASSERT_EQUAL_INT(BENCHMARK_NUM_LINES, numCmds);
+        TEST_ASSERT_FLOAT_WITHIN(1e-2, expectedSumX, sumX);
+        Serial.printf("UnitTestGCode benchmark %d generated lines (%d bytes) %u lines/s\n",
+                    numLines, genGCode.size(),
+                    (uint32_t)(numLines * (BENCHMARK_REPEATS / 50) * 1000000.0 / (elapsedUs ? elapsedUs : 1)));
+    }
+
+    void runTests()
+    {
+        testLexer();
+        testArcs();
+        benchmark();
+    }
+};
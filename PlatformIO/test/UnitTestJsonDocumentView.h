@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "RdJson.h"
+#include "JsonDocumentView.h"
+#include "../src/RobotConfigurations.h"
+#include <ArduinoLog.h>
+
+class UnitTestJsonDocumentView
+{
+public:
+    static const int BENCHMARK_REPEATS = 10;
+
+    // Values are the same as those returned by RdJson
+    void testMatchesRdJson()
+    {
+        const char* testJson = "{\"a\":1,\"b\":{\"c\":\"str\",\"d\":[10,{\"e\":2.5},[3,4],\"f\"],\"a\":3},"
+                               "\"g\":[{\"h\":5},{\"h\":6}],\"a\":7, \"obj\" : { \"x\" : 1 , \"y\" : [ 1 , 2 ] }}";
+        const char* paths[] = { "a", "/a", "b", "b/c", "b/a", "b/d", "b/d[0]", "b/d[1]", "b/d[1]/e",
+                                "b/d[2]", "b/d[3]", "g[1]/h", "g[0]", "obj", "obj/y", "", "/",
+                                "missing", "b/missing", "a/c", "g/h" };
+        JsonDocumentView jsonDoc(testJson);
+        TEST_ASSERT_TRUE(jsonDoc.isValid());
+        for (const char* pPath : paths)
+        {
+            bool docValid = false, rdJsonValid = false;
+            String docStr = jsonDoc.getString(pPath, "DEFAULT", docValid);
+            String rdJsonStr = RdJson::getString(pPath, "DEFAULT", testJson, rdJsonValid);
+            TEST_ASSERT_EQUAL_MESSAGE(rdJsonValid, docValid, pPath);
+            TEST_ASSERT_EQUAL_STRING_MESSAGE(rdJsonStr.c_str(), docStr.c_str(), pPath);
+        }
+        TEST_ASSERT_EQUAL_INT(1, jsonDoc.getLong("a", 0));
+        TEST_ASSERT_EQUAL_FLOAT(2.5, jsonDoc.getDouble("b/d[1]/e", 0));
+        TEST_ASSERT_EQUAL_INT(-1, jsonDoc.getLong("b/missing", -1));
+
+        // Array index out of range (RdJson runs on past the end of the array in this case)
+        TEST_ASSERT_EQUAL_INT(-1, jsonDoc.getLong("b/d[9]", -1));
+
+        // Invalid JSON
+        JsonDocumentView badJsonDoc("{\"a\":");
+        TEST_ASSERT_FALSE(badJsonDoc.isValid());
+        TEST_ASSERT_EQUAL_INT(3, badJsonDoc.getLong("a", 3));
+    }
+
+    // Read the values used when the robot is reconfigured from each built-in robot configuration
+    // using RdJson and then using a single JsonDocumentView for each configuration
+    void benchmark()
+    {
+        static const char* axisParams[] = { "maxSpeed", "maxAcc", "maxJerk", "stepsPerRot", "unitsPerRot", "maxRPM",
+                    "minVal", "maxVal", "isDominantAxis", "isPrimaryAxis", "isServoAxis", "homeOffsetVal", "homeOffSteps",
+                    "stepPin", "dirnPin", "dirnRev", "servoPin", "endStop0/sensePin", "endStop0/actLvl",
+                    "endStop1/sensePin", "endStop1/actLvl", "IRUN", "IHOLD", "CHOPCONF", "chipDriverIdx" };
+        static const char* geomParams[] = { "robotGeom", "pipelineLen", "blockDistanceMM", "allowOutOfBounds",
+                    "junctionDeviation", "perStepAccel", "scheduledStepping", "stepEventQueueLen",
+                    "homing/homingSeq", "homing/maxHomingSecs", "motionController/chip", "stepEnablePin", "stepEnLev",
+                    "stepDisableSecs" };
+        static const char* otherParams[] = { "robotType", "cmdsAtStart", "workItemQueue/maxLen",
+                    "evaluators/thrStepDegs", "evaluators/thrStepAdaptation", "evaluators/thrContinue",
+                    "evaluators/seqShuffleMode", "evaluators/seqRepeatMode" };
+
+        // Form the list of paths
+        std::vector<String> paths;
+        for (const char* pParam : otherParams)
+            paths.push_back(pParam);
+        for (const char* pParam : geomParams)
+            paths.push_back(String("robotGeom/") + pParam);
+        for (int axisIdx = 0; axisIdx < 3; axisIdx++)
+            for (const char* pParam : axisParams)
+                paths.push_back(String("robotGeom/axis") + String(axisIdx) + "/" + pParam);
+
+        uint32_t rdJsonUs = 0;
+        uint32_t jsonDocUs = 0;
+        for (int configIdx = 0; configIdx < RobotConfigurations::_numRobotConfigurations; configIdx++)
+        {
+            const char* pConfig = RobotConfigurations::_robotConfigs[configIdx];
+            std::vector<String> rdJsonVals(paths.size());
+            std::vector<String> jsonDocVals(paths.size());
+
+            uint32_t startUs = micros();
+            for (int rep = 0; rep < BENCHMARK_REPEATS; rep++)
+                for (unsigned int i = 0; i < paths.size(); i++)
+                    rdJsonVals[i] = RdJson::getString(paths[i].c_str(), "", pConfig);
+            rdJsonUs += micros() - startUs;
+
+            startUs = micros();
+            for (int rep = 0; rep < BENCHMARK_REPEATS; rep++)
+            {
+                JsonDocumentView jsonDoc(pConfig);
+                for (unsigned int i = 0; i < paths.size(); i++)
+                    jsonDocVals[i] = jsonDoc.getString(paths[i].c_str(), "");
+            }
+            jsonDocUs += micros() - startUs;
+
+            for (unsigned int i = 0; i < paths.size(); i++)
+                TEST_ASSERT_EQUAL_STRING_MESSAGE(rdJsonVals[i].c_str(), jsonDocVals[i].c_str(), paths[i].c_str());
+        }
+        Serial.printf("UnitTestJsonDocumentView benchmark %d robot configs %d values each RdJson %uus JsonDocumentView %uus per reconfigure\n",
+                    RobotConfigurations::_numRobotConfigurations, paths.size(),
+                    rdJsonUs / BENCHMARK_REPEATS, jsonDocUs / BENCHMARK_REPEATS);
+    }
+
+    void runTests()
+    {
+        testMatchesRdJson();
+        benchmark();
+    }
+};
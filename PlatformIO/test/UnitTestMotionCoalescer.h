@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../src/RobotMotion/MotionControl/MotionCoalescer.h"
+#include <ArduinoLog.h>
+
+static const char* UnitTestMotionCoalescer_Config = R"strDelim(
+    {"axis0":{"maxSpeed":100.0,"maxAcc":10.0,"stepsPerRot":3200,"unitsPerRot":32},
+     "axis1":{"maxSpeed":100.0,"maxAcc":10.0,"stepsPerRot":3200,"unitsPerRot":32}}
+    )strDelim";
+
+class UnitTestMotionCoalescer
+{
+public:
+    static constexpr float TOLERANCE_MM = 0.05f;
+
+    AxesParams _axesParams;
+    MotionCoalescer _coalescer;
+    RobotCommandArgs _args;
+
+    void setup()
+    {
+        _axesParams.clearAxes();
+        String axisJSON;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            _axesParams.configureAxis(UnitTestMotionCoalescer_Config, axisIdx, axisJSON);
+        _coalescer.configure(TOLERANCE_MM);
+        _args.clear();
+        AxisFloats startPos(0, 0);
+        AxisFloats endPos(1, 0);
+        _coalescer.start(_args, startPos, endPos, true);
+    }
+
+    bool extend(float x, float y)
+    {
+        AxisFloats endPos(x, y);
+        return _coalescer.extend(_args, endPos, _axesParams);
+    }
+
+    // Moves are merged while all points passed through stay within tolerance of the merged line
+    void testCollinear()
+    {
+        setup();
+        TEST_ASSERT_TRUE(extend(2, 0.01f));
+        TEST_ASSERT_TRUE(extend(3, 0));
+        TEST_ASSERT_FALSE(extend(4, 0.2f));
+        TEST_ASSERT_EQUAL_INT(3, _coalescer.getNumMerged());
+        TEST_ASSERT_FLOAT_WITHIN(1e-4, 3, _coalescer.getEndPos().getVal(0));
+
+        // A gentle curve is merged until its earlier points are out of tolerance
+        setup();
+        TEST_ASSERT_TRUE(extend(2, 0.03f));
+        TEST_ASSERT_TRUE(extend(3, 0.09f));
+        TEST_ASSERT_FALSE(extend(4, 0.18f));
+
+        // Reversing along the line isn't merged
+        setup();
+        TEST_ASSERT_FALSE(extend(0.5f, 0));
+    }
+
+    // Moves with different parameters are not merged
+    void testCompatibility()
+    {
+        setup();
+        _args.setFeedrate(10);
+        TEST_ASSERT_FALSE(extend(2, 0));
+        _args.clear();
+        _args.setTestAllEndStops();
+        TEST_ASSERT_FALSE(extend(2, 0));
+        _args.clear();
+        _args.setIsArc(true);
+        TEST_ASSERT_FALSE(extend(2, 0));
+        _args.clear();
+        TEST_ASSERT_TRUE(extend(2, 0));
+
+        // Disabled
+        _coalescer.configure(0);
+        TEST_ASSERT_FALSE(_coalescer.isEnabled());
+        TEST_ASSERT_FALSE(_coalescer.isPending());
+    }
+
+    void runTests()
+    {
+        testCollinear();
+        testCompatibility();
+    }
+};
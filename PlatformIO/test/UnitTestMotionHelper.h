@@ -0,0 +1,161 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../src/RobotMotion/MotionControl/MotionHelper.h"
+#include "../src/RobotMotion/Robots/RobotXYBot.h"
+#include <ArduinoLog.h>
+#include <vector>
+
+// Short pipeline and 1mm blocks so a coalesced move has blocks left to add when the pipeline is full
+static const char* UnitTestMotionHelper_Config = R"strDelim(
+    {"robotGeom":{"pipelineLen":5,"blockDistanceMM":1,"coalesceToleranceMM":0.1,
+     "axis0":{"maxSpeed":100.0,"maxAcc":100.0,"stepsPerRot":3200,"unitsPerRot":32},
+     "axis1":{"maxSpeed":100.0,"maxAcc":100.0,"stepsPerRot":3200,"unitsPerRot":32}}}
+    )strDelim";
+
+// No coalescing or block splitting so blocks are the moves and the arcs rounding their corners
+static const char* UnitTestMotionHelper_BlendConfig = R"strDelim(
+    {"robotGeom":{"pipelineLen":50,
+     "axis0":{"maxSpeed":100.0,"maxAcc":100.0,"stepsPerRot":3200,"unitsPerRot":32},
+     "axis1":{"maxSpeed":100.0,"maxAcc":100.0,"stepsPerRot":3200,"unitsPerRot":32}}}
+    )strDelim";
+
+class UnitTestMotionHelper
+{
+public:
+    static const int MAX_SERVICE_LOOPS = 200;
+
+    MotionHelper _motionHelper;
+
+    // Paused so blocks stay in the pipeline until taken by the test
+    void setup(const char* pConfig = UnitTestMotionHelper_Config)
+    {
+        _motionHelper.setTransforms(RobotXYBot::ptToActuator, RobotXYBot::actuatorToPt,
+                    RobotXYBot::correctStepOverflow, nullptr, nullptr);
+        _motionHelper.configure(pConfig);
+        _motionHelper.pause(true);
+    }
+
+    bool moveTo(float x, float y, int cmdIdx)
+    {
+        RobotCommandArgs args;
+        args.setAxisValMM(0, x, true);
+        args.setAxisValMM(1, y, true);
+        args.setNumberedCommandIndex(cmdIdx);
+        return _motionHelper.moveTo(args);
+    }
+
+    // Take blocks from the pipeline (as the ramp generator would) and record the numbered command
+    // index of each - servicing adds any moves and blocks held back
+    void drain(std::vector<int>& cmdIdxs)
+    {
+        MotionPipeline* pPipeline = _motionHelper.testGetMotionPipeline();
+        for (int loopIdx = 0; loopIdx < MAX_SERVICE_LOOPS; loopIdx++)
+        {
+            _motionHelper.service();
+            MotionBlock* pBlock = pPipeline->peekGet();
+            if (!pBlock)
+                continue;
+            cmdIdxs.push_back(pBlock->getNumberedCommandIndex());
+            pPipeline->remove();
+        }
+    }
+
+    // A stepwise move after a coalesced move waits until all blocks of that move have been added
+    void testStepwiseAfterCoalesced()
+    {
+        setup();
+        TEST_ASSERT_TRUE(moveTo(1, 0, RobotConsts::NUMBERED_COMMAND_NONE));
+        TEST_ASSERT_TRUE(moveTo(20, 0, RobotConsts::NUMBERED_COMMAND_NONE));
+        RobotCommandArgs stepwiseArgs;
+        stepwiseArgs.setAxisSteps(0, 100, true);
+        stepwiseArgs.setNumberedCommandIndex(1);
+        TEST_ASSERT_TRUE(_motionHelper.moveTo(stepwiseArgs));
+        TEST_ASSERT_FALSE(_motionHelper.canAccept());
+        std::vector<int> cmdIdxs;
+        drain(cmdIdxs);
+        TEST_ASSERT_EQUAL_INT(21, cmdIdxs.size());
+        for (unsigned int blockIdx = 0; blockIdx < cmdIdxs.size() - 1; blockIdx++)
+            TEST_ASSERT_EQUAL_INT(RobotConsts::NUMBERED_COMMAND_NONE, cmdIdxs[blockIdx]);
+        TEST_ASSERT_EQUAL_INT(1, cmdIdxs.back());
+        TEST_ASSERT_TRUE(_motionHelper.canAccept());
+    }
+
+    // A move which can't be merged is split into blocks straight away after the held back move
+    void testUnmergeableAfterCoalesced()
+    {
+        setup();
+        TEST_ASSERT_TRUE(moveTo(1, 0, RobotConsts::NUMBERED_COMMAND_NONE));
+        TEST_ASSERT_EQUAL_INT(0, _motionHelper.testGetPipelineCount());
+        TEST_ASSERT_TRUE(moveTo(1, 3, 2));
+        TEST_ASSERT_EQUAL_INT(4, _motionHelper.testGetPipelineCount());
+        std::vector<int> cmdIdxs;
+        drain(cmdIdxs);
+        std::vector<int> expected = { RobotConsts::NUMBERED_COMMAND_NONE, 2, 2, 2 };
+        TEST_ASSERT_EQUAL_INT(expected.size(), cmdIdxs.size());
+        for (unsigned int blockIdx = 0; blockIdx < expected.size(); blockIdx++)
+            TEST_ASSERT_EQUAL_INT(expected[blockIdx], cmdIdxs[blockIdx]);
+    }
+
+    // Move along the X axis and then the Y axis with the corner rounded within blendToleranceMM - returns
+    // the lowest speed at the start of a block after the first and the furthest a block end is from the
+    // lines - the closest block end to the corner is also returned
+    void moveRoundCorner(float blendToleranceMM, float& minEntrySpeed, float& maxDeviationMM, float& minCornerDistMM)
+    {
+        setup(UnitTestMotionHelper_BlendConfig);
+        RobotCommandArgs args;
+        args.setPathBlendTolerance(blendToleranceMM);
+        args.setAxisValMM(0, 10, true);
+        args.setAxisValMM(1, 0, true);
+        TEST_ASSERT_TRUE(_motionHelper.moveTo(args));
+        args.setAxisValMM(1, 10, true);
+        TEST_ASSERT_TRUE(_motionHelper.moveTo(args));
+
+        // Take blocks as the ramp generator would - steps per mm is 100
+        MotionPipeline* pPipeline = _motionHelper.testGetMotionPipeline();
+        minEntrySpeed = 1e8;
+        maxDeviationMM = 0;
+        minCornerDistMM = 1e8;
+        float x = 0, y = 0;
+        int blockIdx = 0;
+        for (int loopIdx = 0; loopIdx < MAX_SERVICE_LOOPS; loopIdx++)
+        {
+            _motionHelper.service();
+            MotionBlock* pBlock = pPipeline->peekGet();
+            if (!pBlock)
+                continue;
+            if (blockIdx++ > 0)
+                minEntrySpeed = fminf(minEntrySpeed, pBlock->_maxEntrySpeedMMps);
+            x += pBlock->getStepsToTarget(0) / 100.0f;
+            y += pBlock->getStepsToTarget(1) / 100.0f;
+            maxDeviationMM = fmaxf(maxDeviationMM, fminf(fabsf(y), fabsf(x - 10)));
+            minCornerDistMM = fminf(minCornerDistMM, sqrtf((x - 10) * (x - 10) + y * y));
+            pPipeline->remove();
+        }
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 10, x);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 10, y);
+    }
+
+    // Rounding the corner keeps the path within the tolerance (allowing for the arc chord tolerance)
+    // and the blocks of the rounded corner can be taken much faster than the exact corner
+    void testCornerBlend()
+    {
+        float exactMinSpeed = 0, exactDeviationMM = 0, exactCornerDistMM = 0;
+        moveRoundCorner(0, exactMinSpeed, exactDeviationMM, exactCornerDistMM);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, 0, exactDeviationMM);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, 0, exactCornerDistMM);
+        float blendMinSpeed = 0, blendDeviationMM = 0, blendCornerDistMM = 0;
+        moveRoundCorner(0.2f, blendMinSpeed, blendDeviationMM, blendCornerDistMM);
+        TEST_ASSERT_TRUE(blendDeviationMM <= 0.2f + MotionHelper::arcChordToleranceMM_default + 0.01f);
+        TEST_ASSERT_TRUE(blendCornerDistMM > 0.15f);
+        TEST_ASSERT_TRUE(blendMinSpeed > exactMinSpeed * 2);
+    }
+
+    void runTests()
+    {
+        testStepwiseAfterCoalesced();
+        testUnmergeableAfterCoalesced();
+        testCornerBlend();
+    }
+};
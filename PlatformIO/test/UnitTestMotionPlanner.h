@@ -0,0 +1,253 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../src/RobotMotion/MotionControl/MotionPlanner.h"
+#include <ArduinoLog.h>
+
+// Same XY robot as used to generate Tests/TestOutputData/PipelinePlanner/steps_*.txt
+static const char* UnitTestMotionPlanner_Config = R"strDelim(
+    {"axis0":{"maxSpeed":100.0,"maxAcc":10.0,"stepsPerRot":3200,"unitsPerRot":32},
+     "axis1":{"maxSpeed":100.0,"maxAcc":10.0,"stepsPerRot":3200,"unitsPerRot":32}}
+    )strDelim";
+
+// Joint limited robot - max step rate 3200 steps/s and max step acceleration 800 steps/s^2
+static const char* UnitTestMotionPlanner_ActuatorConfig = R"strDelim(
+    {"axis0":{"maxSpeed":100.0,"maxAcc":10.0,"stepsPerRot":3200,"unitsPerRot":32,"maxRPM":60,"maxStepAccel":800},
+     "axis1":{"maxSpeed":100.0,"maxAcc":10.0,"stepsPerRot":3200,"unitsPerRot":32,"maxRPM":60,"maxStepAccel":800}}
+    )strDelim";
+
+// Y axis with four times the acceleration of X
+static const char* UnitTestMotionPlanner_FastYConfig = R"strDelim(
+    {"axis0":{"maxSpeed":100.0,"maxAcc":10.0,"stepsPerRot":3200,"unitsPerRot":32},
+     "axis1":{"maxSpeed":100.0,"maxAcc":40.0,"stepsPerRot":3200,"unitsPerRot":32}}
+    )strDelim";
+
+// Test cases from Tests/TestPipelinePlannerCLRCPP/TestPipelinePlannerCLRCPP/TestCaseMotionFile.txt
+// Each move is X, Y and each expected block is entry and exit speed in mm/s
+// Junction speeds differ from that file as junction acceleration is now limited per axis
+struct UnitTestMotionPlanner_Case
+{
+    const char* _name;
+    std::vector<std::pair<float, float>> _moves;
+    std::vector<std::pair<float, float>> _expectedSpeeds;
+};
+
+static std::vector<UnitTestMotionPlanner_Case> UnitTestMotionPlanner_Cases = {
+    {
+        "OneBlockXOnly",
+        { {50, 0} },
+        { {0.000, 0.000} }
+    },
+    {
+        "TwoBlocksXMajor",
+        { {10, 1}, {20, 2} },
+        { {0.000, 14.177}, {14.177, 0.000} }
+    },
+    {
+        "RightAngle",
+        { {1, 0}, {1, 1} },
+        { {0.000, 1.307}, {1.307, 0.000} }
+    },
+    {
+        "StraightLineInXWith8Segments",
+        { {1, 0}, {2, 0}, {3, 0}, {4, 0}, {5, 0}, {6, 0}, {7, 0}, {8, 0} },
+        { {0.000, 4.472}, {4.472, 6.325}, {6.325, 7.746}, {7.746, 8.944},
+          {8.944, 7.746}, {7.746, 6.325}, {6.325, 4.472}, {4.472, 0.000} }
+    },
+    {
+        "OneLargeMovement",
+        { {10, 10} },
+        { {0.000, 0.000} }
+    },
+    {
+        "SquareAndDiagonal",
+        { {100, 0}, {100, 100}, {0, 100}, {0, 0}, {100, 100}, {0, 0} },
+        { {0.000, 1.307}, {1.307, 1.307}, {1.307, 1.307}, {1.307, 0.579}, {0.579, 0.000}, {0.000, 0.000} }
+    },
+};
+
+class UnitTestMotionPlanner
+{
+public:
+    static const int BENCHMARK_NUM_BLOCKS = 5000;
+
+    AxesParams _axesParams;
+    MotionPipeline _motionPipeline;
+    MotionPlanner _motionPlanner;
+    AxisPosition _curAxisPosition;
+
+    void setupPlanner(const char* pConfig = UnitTestMotionPlanner_Config)
+    {
+        _axesParams.clearAxes();
+        String axisJSON;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            _axesParams.configureAxis(pConfig, axisIdx, axisJSON);
+        _motionPipeline.init(100);
+        _motionPlanner.configure(0.05f);
+        _curAxisPosition.clear();
+    }
+
+    // Actuator gearing multiplies the steps per mm to act like a non-cartesian transform
+    bool addMove(float x, float y, float actuatorGearing = 1)
+    {
+        RobotCommandArgs args;
+        args.setAxisValMM(0, x, true);
+        args.setAxisValMM(1, y, true);
+        AxisFloats actuatorCoords;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            actuatorCoords.setVal(axisIdx, args.getValNoCkMM(axisIdx) * _axesParams.getStepsPerUnit(axisIdx) * actuatorGearing);
+        if (!_motionPlanner.moveTo(args, actuatorCoords, _curAxisPosition, _axesParams, _motionPipeline))
+            return false;
+        _curAxisPosition._axisPositionMM = args.getPointMM();
+        return true;
+    }
+
+    // Act like the ramp generator ISR - start executing the first block and remove it when done
+    void consumeBlock()
+    {
+        MotionBlock* pBlock = _motionPipeline.peekGetCommitted();
+        if (!pBlock)
+            return;
+        if (pBlock->_isExecuting)
+            _motionPipeline.remove();
+        else
+            pBlock->_isExecuting = true;
+    }
+
+    void testCases()
+    {
+        for (UnitTestMotionPlanner_Case& testCase : UnitTestMotionPlanner_Cases)
+        {
+            Serial.printf("UnitTestMotionPlanner %s\n", testCase._name);
+            setupPlanner();
+            for (auto& move : testCase._moves)
+                TEST_ASSERT_TRUE(addMove(move.first, move.second));
+            TEST_ASSERT_EQUAL_INT(testCase._expectedSpeeds.size(), _motionPipeline.count());
+            for (unsigned int blockIdx = 0; blockIdx < testCase._expectedSpeeds.size(); blockIdx++)
+            {
+                MotionBlock* pBlock = _motionPipeline.peekNthFromGet(blockIdx);
+                TEST_ASSERT_NOT_NULL(pBlock);
+                TEST_ASSERT_FLOAT_WITHIN(0.001, testCase._expectedSpeeds[blockIdx].first, pBlock->_entrySpeedMMps);
+                TEST_ASSERT_FLOAT_WITHIN(0.001, testCase._expectedSpeeds[blockIdx].second, pBlock->_exitSpeedMMps);
+                TEST_ASSERT_TRUE(pBlock->_canExecute);
+            }
+        }
+    }
+
+    // Blocks committed to the ramp generator must not be replanned when following blocks are added
+    void testCommittedBlocks()
+    {
+        setupPlanner();
+        TEST_ASSERT_TRUE(addMove(1, 0));
+        TEST_ASSERT_NOT_NULL(_motionPipeline.peekGetCommitted());
+        TEST_ASSERT_TRUE(_motionPipeline.isGetCommitted());
+        TEST_ASSERT_TRUE(addMove(2, 0));
+        MotionBlock* pCommitted = _motionPipeline.peekNthFromGet(0);
+        MotionBlock* pFollowing = _motionPipeline.peekNthFromGet(1);
+        TEST_ASSERT_NOT_NULL(pFollowing);
+        TEST_ASSERT_EQUAL_FLOAT(0, pCommitted->_exitSpeedMMps);
+        TEST_ASSERT_EQUAL_FLOAT(0, pFollowing->_entrySpeedMMps);
+        TEST_ASSERT_TRUE(pFollowing->_canExecute);
+    }
+
+    // Blocks before those being replanned can be committed while the planner is busy
+    void testCommitWhilePlanning()
+    {
+        setupPlanner();
+        TEST_ASSERT_TRUE(addMove(1, 0));
+        TEST_ASSERT_TRUE(addMove(2, 0));
+        TEST_ASSERT_TRUE(addMove(3, 0));
+        TEST_ASSERT_TRUE(_motionPipeline.peekNthFromGet(0)->_canExecute);
+
+        // Planner changing every block - the first block can't be committed
+        _motionPipeline.beginPlanning(_motionPipeline.count());
+        TEST_ASSERT_NULL(_motionPipeline.peekGetCommitted());
+        TEST_ASSERT_FALSE(_motionPipeline.isGetCommitted());
+        _motionPipeline.endPlanning();
+
+        // Planner only changing the last two blocks
+        _motionPipeline.beginPlanning(2);
+        TEST_ASSERT_NOT_NULL(_motionPipeline.peekGetCommitted());
+        TEST_ASSERT_TRUE(_motionPipeline.isGetCommitted());
+        _motionPipeline.remove();
+        TEST_ASSERT_NULL(_motionPipeline.peekGetCommitted());
+        _motionPipeline.endPlanning();
+        TEST_ASSERT_NOT_NULL(_motionPipeline.peekGetCommitted());
+    }
+
+    // Dense short moves (like theta-rho files) with the pipeline kept full
+    // Feedrate and acceleration are limited by the actuator with the most steps per mm
+    void testActuatorLimits()
+    {
+        // 100 steps per mm so 32mm/s and 8mm/s^2 at the actuator limits
+        setupPlanner(UnitTestMotionPlanner_ActuatorConfig);
+        TEST_ASSERT_TRUE(addMove(10, 0));
+        MotionBlock* pBlock = _motionPipeline.peekNthFromGet(0);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, 32, pBlock->_feedrate);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, 8, pBlock->getMaxAccMMps2(_axesParams));
+
+        // 400 steps per mm so 8mm/s and 2mm/s^2
+        setupPlanner(UnitTestMotionPlanner_ActuatorConfig);
+        TEST_ASSERT_TRUE(addMove(10, 0, 4));
+        pBlock = _motionPipeline.peekNthFromGet(0);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, 8, pBlock->_feedrate);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, 2, pBlock->getMaxAccMMps2(_axesParams));
+
+        // Default max RPM allows 160mm/s so the axis limits apply
+        setupPlanner();
+        TEST_ASSERT_TRUE(addMove(10, 0));
+        pBlock = _motionPipeline.peekNthFromGet(0);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, 100, pBlock->_feedrate);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, 10, pBlock->getMaxAccMMps2(_axesParams));
+    }
+
+    // A junction where the change of direction is mostly in Y is limited by the Y axis acceleration
+    void testJunctionAxisAccel()
+    {
+        setupPlanner();
+        TEST_ASSERT_TRUE(addMove(10, 0));
+        TEST_ASSERT_TRUE(addMove(20, 5));
+        float junctionSpeed = _motionPipeline.peekNthFromGet(1)->_maxEntrySpeedMMps;
+        setupPlanner(UnitTestMotionPlanner_FastYConfig);
+        TEST_ASSERT_TRUE(addMove(10, 0));
+        TEST_ASSERT_TRUE(addMove(20, 5));
+        float fastYJunctionSpeed = _motionPipeline.peekNthFromGet(1)->_maxEntrySpeedMMps;
+        TEST_ASSERT_FLOAT_WITHIN(0.01, junctionSpeed * 2, fastYJunctionSpeed);
+    }
+
+    void benchmark(const char* testName, float segLenMM, float angleStepRads)
+    {
+        setupPlanner();
+        float x = 0, y = 0, angle = 0;
+        uint32_t totalUs = 0;
+        int blocksPlanned = 0;
+        for (int i = 0; i < BENCHMARK_NUM_BLOCKS; i++)
+        {
+            while (!_motionPipeline.canAccept())
+                consumeBlock();
+            angle += angleStepRads;
+            x += segLenMM * cosf(angle);
+            y += segLenMM * sinf(angle);
+            uint32_t startUs = micros();
+            if (addMove(x, y))
+                blocksPlanned++;
+            totalUs += micros() - startUs;
+        }
+        Serial.printf("UnitTestMotionPlanner benchmark %s blocks %d time %uus blocks/sec %.0f\n",
+                    testName, blocksPlanned, totalUs, totalUs > 0 ? blocksPlanned * 1e6 / totalUs : 0.0);
+        TEST_ASSERT_EQUAL_INT(BENCHMARK_NUM_BLOCKS, blocksPlanned);
+    }
+
+    void runTests()
+    {
+        testCases();
+        testCommittedBlocks();
+        testCommitWhilePlanning();
+        testActuatorLimits();
+        testJunctionAxisAccel();
+        benchmark("straight", 0.2f, 0);
+        benchmark("spiral", 0.2f, 0.01f);
+        benchmark("zigzag", 0.5f, 2.5f);
+    }
+};
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../src/WorkManager/Evaluators/EvaluatorPattern_Program.h"
+#include "../src/WorkManager/Evaluators/EvaluatorPattern_Vars.h"
+#include "../src/WorkManager/Evaluators/tinyexpr.h"
+#include <ArduinoLog.h>
+
+class UnitTestPatternProgram
+{
+public:
+    static const int BENCHMARK_NUM_POINTS = 5000;
+
+    // Results are the same as tinyexpr
+    void testMatchesTinyExpr()
+    {
+        const char* exprs[] = { "1+2*3", "-2^2", "2^3^2", "a*b+a/b", "a%3", "(a>1)+(b<0)*2", "a>=2 && b<=-3",
+                                "a==2 || 0", "a=b", "a<b|b", "sin(a)*cos(b)", "atan2(a,b)", "max(a,b)+min(a,b)",
+                                "pow(a,3)", "pi*e", "pi()*2", "sqrt 16", "sin a^2", "abs -a", "(1,2,a)",
+                                "log(100)+ln(e)+log2(8)", "floor(-a/3)+ceil(b/2)", "-(-a)", "--a+-+b",
+                                " 2 * ( 3 + a ) ", "1e-3*a", "tanh(b)+sinh(a)-cosh(1)", "a;ignored", "a\\nignored" };
+        EvaluatorPattern_Vars vars;
+        vars.addConstant("a", 2);
+        vars.addConstant("b", -3);
+        int resultIdx = vars.addConstant("r", 0);
+        for (const char* pExpr : exprs)
+        {
+            int err = 0;
+            te_expr* pTeExpr = te_compile(pExpr, vars.getVars(), vars.getNumVars(), &err);
+            TEST_ASSERT_NOT_NULL(pTeExpr);
+            double expected = te_eval(pTeExpr);
+            te_free(pTeExpr);
+            EvaluatorPattern_Program program;
+            TEST_ASSERT_TRUE(program.addAssignment(resultIdx, pExpr, vars));
+            program.run(vars);
+            TEST_ASSERT_FLOAT_WITHIN(1e-9, expected, vars.getValByIdx(resultIdx));
+        }
+
+        // Constants are folded
+        EvaluatorPattern_Program program;
+        TEST_ASSERT_TRUE(program.addAssignment(resultIdx, "2*(3+4)-pi*0", vars));
+        TEST_ASSERT_EQUAL_INT(1, program.getNumInstructions());
+        TEST_ASSERT_TRUE(program.addAssignment(resultIdx, "a*2+1", vars));
+        TEST_ASSERT_EQUAL_INT(3, program.getNumInstructions());
+
+        // Invalid expressions leave the program unchanged
+        const char* badExprs[] = { "a+", "foo(1)", "max(1)", "(1", "a)", "2 $ 3", "" };
+        for (const char* pExpr : badExprs)
+            TEST_ASSERT_FALSE(program.addAssignment(resultIdx, pExpr, vars));
+        TEST_ASSERT_EQUAL_INT(3, program.getNumInstructions());
+        program.run(vars);
+        TEST_ASSERT_FLOAT_WITHIN(1e-9, 5, vars.getValByIdx(resultIdx));
+
+        // Assignments see the results of those before them
+        program.clear();
+        int cIdx = vars.addConstant("c", 0);
+        TEST_ASSERT_TRUE(program.addAssignment(cIdx, "c+1", vars));
+        TEST_ASSERT_TRUE(program.addAssignment(resultIdx, "c*10", vars));
+        program.run(vars);
+        program.run(vars);
+        TEST_ASSERT_FLOAT_WITHIN(1e-9, 2, vars.getValByIdx(cIdx));
+        TEST_ASSERT_FLOAT_WITHIN(1e-9, 20, vars.getValByIdx(resultIdx));
+    }
+
+    // Variables are found by name once defined and x, y, z and stop have fixed indices
+    void testVars()
+    {
+        EvaluatorPattern_Vars vars;
+        TEST_ASSERT_EQUAL_INT(-1, vars.getVariableIdx("x"));
+        TEST_ASSERT_FALSE(vars.isDefined(EvaluatorPattern_Vars::VAR_IDX_X));
+        String outExpr;
+        TEST_ASSERT_EQUAL_INT(EvaluatorPattern_Vars::VAR_IDX_STOP, vars.addAssignment("stop=t>1", outExpr));
+        TEST_ASSERT_EQUAL_STRING("t>1", outExpr.c_str());
+        for (int i = 0; i < 100; i++)
+            TEST_ASSERT_EQUAL_INT(EvaluatorPattern_Vars::NUM_RESERVED_VARS + i,
+                        vars.addConstant((String("v") + String(i)).c_str(), i));
+        TEST_ASSERT_EQUAL_INT(EvaluatorPattern_Vars::VAR_IDX_X, vars.addAssignment("x=1", outExpr));
+        int upperXIdx = vars.addAssignment("X=2", outExpr);
+        TEST_ASSERT_EQUAL_INT(EvaluatorPattern_Vars::NUM_RESERVED_VARS + 100, upperXIdx);
+        TEST_ASSERT_EQUAL_INT(upperXIdx, vars.getVariableIdx("X"));
+        TEST_ASSERT_EQUAL_INT(EvaluatorPattern_Vars::VAR_IDX_X, vars.getVariableIdx("X", true));
+        TEST_ASSERT_EQUAL_INT(EvaluatorPattern_Vars::NUM_RESERVED_VARS + 57, vars.getVariableIdx("V57", true));
+        TEST_ASSERT_EQUAL_INT(-1, vars.getVariableIdx("V57"));
+        bool isValid = false;
+        TEST_ASSERT_FLOAT_WITHIN(1e-9, 57, vars.getVal("v57", isValid));
+        TEST_ASSERT_TRUE(isValid);
+        vars.cleanUp();
+        TEST_ASSERT_EQUAL_INT(-1, vars.getVariableIdx("v57"));
+        TEST_ASSERT_EQUAL_INT(-1, vars.getVariableIdx("stop"));
+        TEST_ASSERT_EQUAL_INT(EvaluatorPattern_Vars::NUM_RESERVED_VARS, vars.getNumVars());
+    }
+
+    // Generate points from the example patterns evaluating each assignment with tinyexpr
+    // and then running the compiled program
+    void benchmark()
+    {
+        static const char* patterns[][2] = {
+            { "angle=0;diam=10", "x=diam*sin(angle*3);y=diam*cos(angle*3);diam=diam+0.5;angle=angle+0.0314;stop=angle>6.28" },
+            { "t=0;R=sizeX/2", "x=R*sin(t);y=R*cos(t);R=R-0.3;t=t+0.1;stop=R<20" }
+        };
+        for (auto& pattern : patterns)
+        {
+            // Expressions evaluated by tinyexpr
+            EvaluatorPattern_Vars teVars;
+            std::vector<te_expr*> teSetupExprs, teExprs;
+            std::vector<int> teSetupVarIdxs, teVarIdxs;
+            addPatternVars(teVars);
+            compileTinyExpr(teVars, pattern[0], teSetupExprs, teSetupVarIdxs);
+            compileTinyExpr(teVars, pattern[1], teExprs, teVarIdxs);
+            for (unsigned int j = 0; j < teSetupExprs.size(); j++)
+                teVars.setValByIdx(teSetupVarIdxs[j], te_eval(teSetupExprs[j]));
+            int teXIdx = teVars.getVariableIdx("x");
+            int teYIdx = teVars.getVariableIdx("y");
+            std::vector<double> teXY;
+            teXY.reserve(BENCHMARK_NUM_POINTS * 2);
+            uint32_t startUs = micros();
+            for (int i = 0; i < BENCHMARK_NUM_POINTS; i++)
+            {
+                for (unsigned int j = 0; j < teExprs.size(); j++)
+                    teVars.setValByIdx(teVarIdxs[j], te_eval(teExprs[j]));
+                teXY.push_back(teVars.getValByIdx(teXIdx));
+                teXY.push_back(teVars.getValByIdx(teYIdx));
+            }
+            uint32_t teUs = micros() - startUs;
+            for (te_expr* pExpr : teSetupExprs)
+                te_free(pExpr);
+            for (te_expr* pExpr : teExprs)
+                te_free(pExpr);
+
+            // Compiled program
+            EvaluatorPattern_Vars progVars;
+            EvaluatorPattern_Program setupProgram;
+            EvaluatorPattern_Program loopProgram;
+            addPatternVars(progVars);
+            compileProgram(progVars, pattern[0], setupProgram);
+            compileProgram(progVars, pattern[1], loopProgram);
+            setupProgram.run(progVars);
+            int progXIdx = progVars.getVariableIdx("x");
+            int progYIdx = progVars.getVariableIdx("y");
+            std::vector<double> progXY;
+            progXY.reserve(BENCHMARK_NUM_POINTS * 2);
+            startUs = micros();
+            for (int i = 0; i < BENCHMARK_NUM_POINTS; i++)
+            {
+                loopProgram.run(progVars);
+                progXY.push_back(progVars.getValByIdx(progXIdx));
+                progXY.push_back(progVars.getValByIdx(progYIdx));
+            }
+            uint32_t progUs = micros() - startUs;
+
+            TEST_ASSERT_EQUAL_INT(teXY.size(), progXY.size());
+            for (unsigned int i = 0; i < teXY.size(); i++)
+                TEST_ASSERT_FLOAT_WITHIN(1e-9, teXY[i], progXY[i]);
+            Serial.printf("UnitTestPatternProgram benchmark loop %s tinyexpr %u points/s program %u points/s (%d instrs)\n",
+                        pattern[1], (uint32_t)(BENCHMARK_NUM_POINTS * 1000000.0 / (teUs ? teUs : 1)),
+                        (uint32_t)(BENCHMARK_NUM_POINTS * 1000000.0 / (progUs ? progUs : 1)),
+                        loopProgram.getNumInstructions());
+        }
+    }
+
+    void runTests()
+    {
+        testMatchesTinyExpr();
+        testVars();
+        benchmark();
+    }
+
+private:
+    void addPatternVars(EvaluatorPattern_Vars& vars)
+    {
+        vars.addConstant("sizeX", 400);
+        vars.addConstant("sizeY", 400);
+        vars.addConstant("sizeZ", 100);
+        vars.addConstant("originX", 0);
+        vars.addConstant("originY", 0);
+        vars.addConstant("originZ", 0);
+    }
+
+    // Split a pattern on ';' and call back for each assignment
+    template<typename F> void forEachAssignment(EvaluatorPattern_Vars& vars, const char* exprs, F func)
+    {
+        String remaining = exprs;
+        while (remaining.length() > 0)
+        {
+            int sepPos = remaining.indexOf(';');
+            String assignment = (sepPos < 0) ? remaining : remaining.substring(0, sepPos);
+            remaining = (sepPos < 0) ? "" : remaining.substring(sepPos + 1);
+            String outExpr;
+            int varIdx = vars.addAssignment(assignment.c_str(), outExpr);
+            TEST_ASSERT_TRUE(varIdx >= 0);
+            func(varIdx, outExpr);
+        }
+    }
+
+    void compileTinyExpr(EvaluatorPattern_Vars& vars, const char* exprs,
+                std::vector<te_expr*>& teExprs, std::vector<int>& teVarIdxs)
+    {
+        forEachAssignment(vars, exprs, [&](int varIdx, String& outExpr) {
+            te_expr* pExpr = te_compile(outExpr.c_str(), vars.getVars(), vars.getNumVars(), 0);
+            TEST_ASSERT_NOT_NULL(pExpr);
+            teExprs.push_back(pExpr);
+            teVarIdxs.push_back(varIdx);
+        });
+    }
+
+    void compileProgram(EvaluatorPattern_Vars& vars, const char* exprs, EvaluatorPattern_Program& program)
+    {
+        forEachAssignment(vars, exprs, [&](int varIdx, String& outExpr) {
+            TEST_ASSERT_TRUE(program.addAssignment(varIdx, outExpr.c_str(), vars));
+        });
+    }
+};
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../src/RobotMotion/MotionControl/MotionPlanner.h"
+#include "../src/RobotMotion/MotionControl/RampGenerator/RampGenerator.h"
+#include <ArduinoLog.h>
+
+// XY robot with 400 steps per mm - high step rates show up the effect of ms rate quantisation
+static const char* UnitTestRampGenerator_Config = R"strDelim(
+    {"axis0":{"maxSpeed":50.0,"maxAcc":500.0,"maxRPM":6000,"stepsPerRot":400,"unitsPerRot":1},
+     "axis1":{"maxSpeed":50.0,"maxAcc":500.0,"maxRPM":6000,"stepsPerRot":400,"unitsPerRot":1}}
+    )strDelim";
+
+class UnitTestRampGenerator
+{
+public:
+    static constexpr float MAX_SPEED = 50.0f;
+    static constexpr float MAX_ACC = 500.0f;
+    static constexpr float STEPS_PER_MM = 400.0f;
+    static constexpr float MOVE_DIST_MM = 10.0f;
+    static constexpr int STEP_EVENT_QUEUE_LEN = 100;
+    static constexpr uint32_t MAIN_LOOP_INTERVAL_NS = 1000000;
+    static constexpr float SCHEDULED_TEST_TOLERANCE_SECS = 0.00001f;
+
+    // Ways the ISR can be driven
+    enum StepMode
+    {
+        STEP_MODE_POLLED,
+        STEP_MODE_SCHEDULED,
+        STEP_MODE_STEP_EVENT_QUEUE
+    };
+
+    // Time (secs) at which a position (mm) is reached for a trapezoidal move from rest to rest
+    float profileTimeAtPosition(float pos)
+    {
+        float tAccel = MAX_SPEED / MAX_ACC;
+        float distAccel = MAX_SPEED * tAccel / 2;
+        float tCruise = (MOVE_DIST_MM - 2 * distAccel) / MAX_SPEED;
+        if (pos <= distAccel)
+            return sqrtf(2 * pos / MAX_ACC);
+        if (pos <= MOVE_DIST_MM - distAccel)
+            return tAccel + (pos - distAccel) / MAX_SPEED;
+        return 2 * tAccel + tCruise - sqrtf(2 * (MOVE_DIST_MM - pos) / MAX_ACC);
+    }
+
+    // Results of running a move
+    struct MoveStats
+    {
+        float maxErrSecs;
+        uint32_t isrCalls;
+    };
+
+    // Run a move with a virtual timer and return the max error (secs) in step timing compared to the ideal
+    // profile and the number of ISR calls - in polled mode the ISR is called every tick and in scheduled
+    // modes the timer is advanced by the interval returned from each call - the step event queue is
+    // filled at the main loop interval
+    MoveStats runMove(bool perStepAccel, StepMode stepMode)
+    {
+        // Setup
+        AxesParams axesParams;
+        String axisJSON;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            axesParams.configureAxis(UnitTestRampGenerator_Config, axisIdx, axisJSON);
+        MotionPipeline motionPipeline;
+        motionPipeline.init(10);
+        MotionPlanner motionPlanner;
+        motionPlanner.configure(0.05f);
+        AxisPosition curAxisPosition;
+        curAxisPosition.clear();
+        RampGenerator* pRampGenerator = new RampGenerator(&motionPipeline);
+        pRampGenerator->setPerStepAccel(perStepAccel);
+        if (stepMode == STEP_MODE_STEP_EVENT_QUEUE)
+            pRampGenerator->setStepEventQueueLen(STEP_EVENT_QUEUE_LEN);
+        pRampGenerator->pause(false);
+
+        // Add a single move on X
+        RobotCommandArgs args;
+        args.setAxisValMM(0, MOVE_DIST_MM, true);
+        args.setAxisValMM(1, 0, true);
+        args.setFeedrate(MAX_SPEED);
+        AxisFloats actuatorCoords(MOVE_DIST_MM * STEPS_PER_MM, 0, 0);
+        TEST_ASSERT_TRUE(motionPlanner.moveTo(args, actuatorCoords, curAxisPosition, axesParams, motionPipeline));
+
+        // Run the ramp generator checking the time of each step
+        // The block starts on the first call so time is measured from then
+        uint32_t totalSteps = uint32_t(MOVE_DIST_MM * STEPS_PER_MM);
+        uint32_t stepCount = 0;
+        MoveStats moveStats = { 0, 0 };
+        uint64_t timeNs = 0;
+        uint64_t mainLoopTimeNs = 0;
+        while ((timeNs < 10 * 1000000000ull) && (motionPipeline.canGet() || pRampGenerator->stepEventsPending()))
+        {
+            uint32_t intervalNs = MotionBlock::TICK_INTERVAL_NS;
+            uint32_t stepsDone = 0;
+            switch (stepMode)
+            {
+                case STEP_MODE_POLLED:
+                    pRampGenerator->testISRStepperMotion();
+                    stepsDone = pRampGenerator->testGetStepCount(0);
+                    break;
+                case STEP_MODE_SCHEDULED:
+                    intervalNs = pRampGenerator->testISRStepperMotionScheduled();
+                    stepsDone = pRampGenerator->testGetStepCount(0);
+                    break;
+                case STEP_MODE_STEP_EVENT_QUEUE:
+                    if (timeNs >= mainLoopTimeNs)
+                    {
+                        pRampGenerator->testProduceStepEvents();
+                        mainLoopTimeNs += MAIN_LOOP_INTERVAL_NS;
+                    }
+                    intervalNs = pRampGenerator->testISRStepEventQueue();
+                    stepsDone = pRampGenerator->testGetStepEventAxisSteps(0);
+                    break;
+            }
+            moveStats.isrCalls++;
+            while (stepCount < stepsDone)
+            {
+                stepCount++;
+                float errSecs = fabsf(timeNs / 1e9 - profileTimeAtPosition(stepCount / STEPS_PER_MM));
+                moveStats.maxErrSecs = std::max(moveStats.maxErrSecs, errSecs);
+            }
+            timeNs += intervalNs;
+        }
+        delete pRampGenerator;
+        TEST_ASSERT_EQUAL_INT(totalSteps, stepCount);
+        return moveStats;
+    }
+
+    // Compare step timing of per-ms and per-step acceleration
+    void testPerStepAccel()
+    {
+        float perMsErrSecs = runMove(false, STEP_MODE_POLLED).maxErrSecs;
+        float perStepErrSecs = runMove(true, STEP_MODE_POLLED).maxErrSecs;
+        Serial.printf("UnitTestRampGenerator max step time error per-ms %.6fs per-step %.6fs\n", perMsErrSecs, perStepErrSecs);
+
+        // Per-step acceleration should be within a few ISR ticks of the ideal profile throughout - steps
+        // can only happen on a tick and the first tick of a block is used for setup
+        TEST_ASSERT_TRUE(perStepErrSecs <= 4 / MotionBlock::TICKS_PER_SEC);
+        TEST_ASSERT_TRUE(perStepErrSecs <= perMsErrSecs);
+    }
+
+    // Compare ISR calls and step timing of polled and scheduled stepping
+    void testScheduledStepping()
+    {
+        for (int perStepAccel = 0; perStepAccel < 2; perStepAccel++)
+        {
+            MoveStats polled = runMove(perStepAccel, STEP_MODE_POLLED);
+            MoveStats scheduled = runMove(perStepAccel, STEP_MODE_SCHEDULED);
+            Serial.printf("UnitTestRampGenerator %s polled ISR calls %u max err %.6fs scheduled ISR calls %u max err %.6fs\n",
+                        perStepAccel ? "per-step" : "per-ms", polled.isrCalls, polled.maxErrSecs,
+                        scheduled.isrCalls, scheduled.maxErrSecs);
+
+            // Scheduled calls are 2 per step (step start and end) plus ms boundaries when the rate is updated every ms
+            uint32_t maxScheduledCalls = uint32_t(MOVE_DIST_MM * STEPS_PER_MM) * 2 + 10;
+            if (!perStepAccel)
+                maxScheduledCalls += uint32_t(profileTimeAtPosition(MOVE_DIST_MM) * 1000) + 10;
+            TEST_ASSERT_TRUE(scheduled.isrCalls <= maxScheduledCalls);
+            TEST_ASSERT_TRUE(scheduled.isrCalls < polled.isrCalls);
+            // Scheduled step times aren't quantised to ticks - with per-ms acceleration the error is dominated by
+            // the rate quantisation so allow for step times moving by up to a tick
+            TEST_ASSERT_TRUE(scheduled.maxErrSecs <= polled.maxErrSecs + 1 / MotionBlock::TICKS_PER_SEC);
+        }
+    }
+
+    // Steps output from the step event queue should have the same timing as scheduled stepping
+    void testStepEventQueue()
+    {
+        for (int perStepAccel = 0; perStepAccel < 2; perStepAccel++)
+        {
+            MoveStats scheduled = runMove(perStepAccel, STEP_MODE_SCHEDULED);
+            MoveStats queued = runMove(perStepAccel, STEP_MODE_STEP_EVENT_QUEUE);
+            Serial.printf("UnitTestRampGenerator %s scheduled ISR calls %u max err %.6fs step-event-queue ISR calls %u max err %.6fs\n",
+                        perStepAccel ? "per-step" : "per-ms", scheduled.isrCalls, scheduled.maxErrSecs,
+                        queued.isrCalls, queued.maxErrSecs);
+            TEST_ASSERT_TRUE(queued.isrCalls <= scheduled.isrCalls);
+            TEST_ASSERT_FLOAT_WITHIN(SCHEDULED_TEST_TOLERANCE_SECS, scheduled.maxErrSecs, queued.maxErrSecs);
+        }
+    }
+
+    // Time spent paused mustn't be made up with a burst of steps when scheduled stepping resumes
+    void testScheduledPauseResume()
+    {
+        // Setup
+        AxesParams axesParams;
+        String axisJSON;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            axesParams.configureAxis(UnitTestRampGenerator_Config, axisIdx, axisJSON);
+        MotionPipeline motionPipeline;
+        motionPipeline.init(10);
+        MotionPlanner motionPlanner;
+        motionPlanner.configure(0.05f);
+        AxisPosition curAxisPosition;
+        curAxisPosition.clear();
+        RampGenerator* pRampGenerator = new RampGenerator(&motionPipeline);
+        pRampGenerator->pause(false);
+        RobotCommandArgs args;
+        args.setAxisValMM(0, MOVE_DIST_MM, true);
+        args.setAxisValMM(1, 0, true);
+        args.setFeedrate(MAX_SPEED);
+        AxisFloats actuatorCoords(MOVE_DIST_MM * STEPS_PER_MM, 0, 0);
+        TEST_ASSERT_TRUE(motionPlanner.moveTo(args, actuatorCoords, curAxisPosition, axesParams, motionPipeline));
+
+        // Run to the middle of the move where it is cruising
+        while (pRampGenerator->testGetStepCount(0) < MOVE_DIST_MM * STEPS_PER_MM / 2)
+            pRampGenerator->testISRStepperMotionScheduled();
+
+        // Pause and resume a few times checking the steps in a short time after resuming
+        static constexpr uint32_t RESUME_CHECK_NS = 200000;
+        uint32_t maxStepsAfterResume = uint32_t(MAX_SPEED * STEPS_PER_MM * RESUME_CHECK_NS / 1e9) + 1;
+        for (int pauseIdx = 0; pauseIdx < 5; pauseIdx++)
+        {
+            pRampGenerator->pause(true);
+            for (int isrIdx = 0; isrIdx < 10; isrIdx++)
+                pRampGenerator->testISRStepperMotionScheduled();
+            pRampGenerator->pause(false);
+            uint32_t stepsAtResume = pRampGenerator->testGetStepCount(0);
+            uint32_t timeNs = 0;
+            while (timeNs < RESUME_CHECK_NS)
+                timeNs += pRampGenerator->testISRStepperMotionScheduled();
+            TEST_ASSERT_TRUE(pRampGenerator->testGetStepCount(0) - stepsAtResume <= maxStepsAfterResume);
+        }
+        delete pRampGenerator;
+    }
+
+    void runTests()
+    {
+        testPerStepAccel();
+        testScheduledStepping();
+        testStepEventQueue();
+        testScheduledPauseResume();
+    }
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../src/RobotMotion/MotionControl/MotionPlanner.h"
+#include "../src/RobotMotion/MotionControl/RampGenerator/RampGenerator.h"
+#include <ArduinoLog.h>
+
+// XY robot with 100 steps per mm and a jerk limit
+static const char* UnitTestSCurve_Config = R"strDelim(
+    {"axis0":{"maxSpeed":20.0,"maxAcc":100.0,"maxJerk":1000.0,"maxRPM":3000,"stepsPerRot":100,"unitsPerRot":1},
+     "axis1":{"maxSpeed":20.0,"maxAcc":100.0,"maxJerk":1000.0,"maxRPM":3000,"stepsPerRot":100,"unitsPerRot":1}}
+    )strDelim";
+
+class UnitTestSCurve
+{
+public:
+    static constexpr float MAX_SPEED = 20.0f;
+    static constexpr float MAX_ACC = 100.0f;
+    static constexpr float MAX_JERK = 1000.0f;
+    static constexpr float STEPS_PER_MM = 100.0f;
+    static constexpr float MOVE_DIST_MM = 50.0f;
+
+    // Check that speed <-> distance calculations used by the planner are consistent
+    void testSpeedDistanceMaths()
+    {
+        static const float testSpeeds[] = { 0, 1, 5, 20 };
+        static const float testDists[] = { 0.01, 0.1, 1, 3, 10, 100 };
+        for (float speed : testSpeeds)
+        {
+            for (float dist : testDists)
+            {
+                float maxSpeed = MotionBlock::maxAchievableSpeed(MAX_ACC, MAX_JERK, speed, dist);
+                TEST_ASSERT_TRUE(maxSpeed > speed);
+                TEST_ASSERT_TRUE(maxSpeed <= MotionBlock::maxAchievableSpeed(MAX_ACC, 0, speed, dist));
+                TEST_ASSERT_FLOAT_WITHIN(dist * 0.001 + 0.0001, dist,
+                            MotionBlock::distanceToChangeSpeed(MAX_ACC, MAX_JERK, speed, maxSpeed));
+            }
+        }
+    }
+
+    // Position (mm) at time t (secs) for a move from rest to rest using a 7 segment S-curve
+    // The test move is long enough to reach both max acceleration and max speed
+    float profilePosition(float t)
+    {
+        float tJerk = MAX_ACC / MAX_JERK;
+        float tAccel = MAX_SPEED / MAX_ACC + tJerk;
+        float distAccel = MAX_SPEED * tAccel / 2;
+        float tCruise = (MOVE_DIST_MM - 2 * distAccel) / MAX_SPEED;
+        float tTotal = 2 * tAccel + tCruise;
+        if (t >= tTotal)
+            return MOVE_DIST_MM;
+        if (t > tAccel + tCruise)
+            return MOVE_DIST_MM - profilePosition(tTotal - t);
+        if (t > tAccel)
+            return distAccel + (t - tAccel) * MAX_SPEED;
+        if (t > tAccel - tJerk)
+            return distAccel - MAX_SPEED * (tAccel - t) + MAX_JERK * (tAccel - t) * (tAccel - t) * (tAccel - t) / 6;
+        if (t > tJerk)
+            return MAX_JERK * tJerk * tJerk * tJerk / 6 + MAX_JERK * tJerk * tJerk / 2 * (t - tJerk) + MAX_ACC * (t - tJerk) * (t - tJerk) / 2;
+        return MAX_JERK * t * t * t / 6;
+    }
+
+    // Time at which a position is reached
+    float profileTimeAtPosition(float pos)
+    {
+        float lowT = 0, highT = 10;
+        for (int i = 0; i < 40; i++)
+        {
+            float midT = (lowT + highT) / 2;
+            if (profilePosition(midT) < pos)
+                lowT = midT;
+            else
+                highT = midT;
+        }
+        return highT;
+    }
+
+    void testStepTimings()
+    {
+        // Setup
+        AxesParams axesParams;
+        String axisJSON;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            axesParams.configureAxis(UnitTestSCurve_Config, axisIdx, axisJSON);
+        MotionPipeline motionPipeline;
+        motionPipeline.init(10);
+        MotionPlanner motionPlanner;
+        motionPlanner.configure(0.05f);
+        AxisPosition curAxisPosition;
+        curAxisPosition.clear();
+        RampGenerator* pRampGenerator = new RampGenerator(&motionPipeline);
+        pRampGenerator->pause(false);
+
+        // Add a single move on X
+        RobotCommandArgs args;
+        args.setAxisValMM(0, MOVE_DIST_MM, true);
+        args.setAxisValMM(1, 0, true);
+        args.setFeedrate(MAX_SPEED);
+        AxisFloats actuatorCoords(MOVE_DIST_MM * STEPS_PER_MM, 0, 0);
+        TEST_ASSERT_TRUE(motionPlanner.moveTo(args, actuatorCoords, curAxisPosition, axesParams, motionPipeline));
+        MotionBlock* pBlock = motionPipeline.peekGet();
+        TEST_ASSERT_NOT_NULL(pBlock);
+        uint32_t maxAcc = pBlock->_accStepsPerTTicksPerMS;
+        uint32_t maxJerk = pBlock->_jerkStepsPerTTicksPerMSPerMS;
+        TEST_ASSERT_TRUE(maxJerk > 0);
+
+        // Run the ramp generator recording the time of each step and checking acceleration and jerk each ms
+        uint32_t totalSteps = uint32_t(MOVE_DIST_MM * STEPS_PER_MM);
+        std::vector<uint32_t> stepTicks;
+        int32_t prevRate = 0, prevAcc = 0;
+        int32_t maxAccSeen = 0, maxJerkSeen = 0;
+        static const uint32_t TICKS_PER_MS = MotionBlock::NS_IN_A_MS / MotionBlock::TICK_INTERVAL_NS;
+        for (uint32_t tick = 0; (tick < 10 * MotionBlock::TICKS_PER_SEC) && motionPipeline.canGet(); tick++)
+        {
+            pRampGenerator->testISRStepperMotion();
+            while (stepTicks.size() < pRampGenerator->testGetStepCount(0))
+                stepTicks.push_back(tick);
+            if (tick % TICKS_PER_MS == 0)
+            {
+                int32_t rate = pRampGenerator->testGetStepRatePerTTicks();
+                int32_t acc = rate - prevRate;
+                maxAccSeen = std::max(maxAccSeen, abs(acc));
+                maxJerkSeen = std::max(maxJerkSeen, abs(acc - prevAcc));
+                prevRate = rate;
+                prevAcc = acc;
+            }
+        }
+        delete pRampGenerator;
+
+        // Check the profile limits
+        Serial.printf("UnitTestSCurve maxAcc %d (limit %d) maxJerk %d (limit %d)\n", maxAccSeen, maxAcc, maxJerkSeen, maxJerk);
+        TEST_ASSERT_EQUAL_INT(totalSteps, stepTicks.size());
+        TEST_ASSERT_TRUE(maxAccSeen <= int32_t(maxAcc));
+        TEST_ASSERT_TRUE(maxJerkSeen <= int32_t(maxJerk));
+
+        // Check step timings against the profile
+        static const uint32_t checkSteps[] = { 10, 50, 100, 200, 300, 1000, 2500, 4700, 4800, 4900, 4990, 5000 };
+        for (uint32_t stepNum : checkSteps)
+        {
+            float expectedSecs = profileTimeAtPosition(stepNum / STEPS_PER_MM);
+            float actualSecs = stepTicks[stepNum - 1] / MotionBlock::TICKS_PER_SEC;
+            Serial.printf("UnitTestSCurve step %d expected %.4fs actual %.4fs\n", stepNum, expectedSecs, actualSecs);
+            TEST_ASSERT_FLOAT_WITHIN(0.005 + expectedSecs * 0.01, expectedSecs, actualSecs);
+        }
+    }
+
+    void runTests()
+    {
+        testSpeedDistanceMaths();
+        testStepTimings();
+    }
+};
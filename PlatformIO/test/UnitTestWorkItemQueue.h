@@ -0,0 +1,161 @@
+#pragma once
+
+#include <Arduino.h>
+#include <unity.h>
+#include "../src/WorkManager/WorkItemQueue.h"
+#include <queue>
+#include <ArduinoLog.h>
+
+class UnitTestWorkItemQueue
+{
+public:
+    static const int BENCHMARK_NUM_LINES = 20000;
+    static const int BENCHMARK_QUEUE_LEN = 50;
+
+    // Items are returned in order and the arena wraps when there isn't room at the end
+    void testArena()
+    {
+        WorkItemQueue workItemQueue;
+        workItemQueue.init("{\"workItemQueue\":{\"maxLen\":4}}", "workItemQueue");
+        TEST_ASSERT_TRUE(workItemQueue.isEmpty());
+        TEST_ASSERT_NULL(workItemQueue.peek());
+
+        // Limited by number of items
+        TEST_ASSERT_TRUE(workItemQueue.add("G0 X1"));
+        TEST_ASSERT_TRUE(workItemQueue.add("G0 X2"));
+        TEST_ASSERT_TRUE(workItemQueue.add("G0 X3"));
+        TEST_ASSERT_TRUE(workItemQueue.add("G0 X4"));
+        TEST_ASSERT_TRUE(workItemQueue.isFull());
+        TEST_ASSERT_FALSE(workItemQueue.add("G0 X5"));
+        WorkItem workItem;
+        TEST_ASSERT_TRUE(workItemQueue.peek(workItem));
+        TEST_ASSERT_EQUAL_STRING("G0 X1", workItem.getCString());
+        TEST_ASSERT_TRUE(workItem.getCString() == workItemQueue.peek());
+        workItemQueue.clear();
+
+        // Limited by space in the arena - items are never split
+        String longItem;
+        while (longItem.length() < workItemQueue.arenaSize() / 3)
+            longItem += "G0 X1.23456 Y6.54321;";
+        String longerItem = longItem + "G0 X1";
+        TEST_ASSERT_TRUE(workItemQueue.add(longerItem.c_str()));
+        TEST_ASSERT_TRUE(workItemQueue.add("A"));
+        TEST_ASSERT_TRUE(workItemQueue.add(longItem.c_str()));
+        TEST_ASSERT_FALSE(workItemQueue.add(longItem.c_str()));
+        TEST_ASSERT_TRUE(workItemQueue.remove());
+        TEST_ASSERT_TRUE(workItemQueue.add(longItem.c_str()));
+        TEST_ASSERT_EQUAL_STRING("A", workItemQueue.peek());
+        TEST_ASSERT_TRUE(workItemQueue.remove());
+        TEST_ASSERT_EQUAL_STRING(longItem.c_str(), workItemQueue.peek());
+        TEST_ASSERT_TRUE(workItemQueue.remove());
+        TEST_ASSERT_EQUAL_STRING(longItem.c_str(), workItemQueue.peek());
+        TEST_ASSERT_TRUE(workItemQueue.remove());
+        TEST_ASSERT_TRUE(workItemQueue.isEmpty());
+
+        // An item which can never fit is rejected
+        String hugeItem;
+        while (hugeItem.length() <= workItemQueue.arenaSize())
+            hugeItem += longItem;
+        TEST_ASSERT_FALSE(workItemQueue.add(hugeItem.c_str()));
+
+        // Part of a string can be added (as when splitting compound commands)
+        const char* compoundCmd = "G0 X1;G0 Y2";
+        TEST_ASSERT_TRUE(workItemQueue.add(compoundCmd + 6, 5));
+        TEST_ASSERT_TRUE(workItemQueue.add(compoundCmd, 5));
+        TEST_ASSERT_EQUAL_STRING("G0 Y2", workItemQueue.peek());
+        TEST_ASSERT_TRUE(workItemQueue.remove());
+        TEST_ASSERT_EQUAL_STRING("G0 X1", workItemQueue.peek());
+
+        // An item is only removed if it is still at the head
+        uint32_t headSeq = workItemQueue.getHeadSeq();
+        workItemQueue.clear();
+        TEST_ASSERT_TRUE(workItemQueue.add("G0 X3"));
+        TEST_ASSERT_FALSE(workItemQueue.removeIfHead(headSeq));
+        TEST_ASSERT_EQUAL_STRING("G0 X3", workItemQueue.peek());
+        TEST_ASSERT_TRUE(workItemQueue.removeIfHead(workItemQueue.getHeadSeq()));
+        TEST_ASSERT_TRUE(workItemQueue.isEmpty());
+    }
+
+    // Format a line as produced by the theta-rho file evaluator
+    void thrLine(int lineIdx, char* lineBuf)
+    {
+        sprintf(lineBuf, "_THRLINEN_/%0.5f/%0.5f", lineIdx * 0.0123, (lineIdx % 1000) / 1000.0);
+    }
+
+    // Handle a line in the way the work manager does
+    bool handleLine(WorkItem& workItem)
+    {
+        return strncmp(workItem.getCString(), "_THRLINE", strlen("_THRLINE")) == 0;
+    }
+
+    // Queue and handle the lines of a long theta-rho file keeping the queue topped up
+    // Long-lived allocations (like status strings) are made along the way as these are what
+    // cause fragmentation when mixed with the queue's own allocations
+    void benchmark()
+    {
+        char lineBuf[100];
+        std::vector<String> otherAllocs(BENCHMARK_QUEUE_LEN);
+
+        // Previous queue implementation - each item is a WorkItem containing a String
+        uint32_t heapBefore = ESP.getFreeHeap();
+        uint32_t startUs = micros();
+        std::queue<WorkItem> stringQueue;
+        int linesHandled = 0;
+        for (int lineIdx = 0; lineIdx < BENCHMARK_NUM_LINES; )
+        {
+            while ((stringQueue.size() < BENCHMARK_QUEUE_LEN) && (lineIdx < BENCHMARK_NUM_LINES))
+            {
+                thrLine(lineIdx++, lineBuf);
+                stringQueue.push(WorkItem(lineBuf));
+                otherAllocs[lineIdx % otherAllocs.size()] = String(lineIdx);
+            }
+            while (!stringQueue.empty())
+            {
+                WorkItem workItem = stringQueue.front();
+                stringQueue.pop();
+                if (handleLine(workItem))
+                    linesHandled++;
+            }
+        }
+        uint32_t stringQueueUs = micros() - startUs;
+        uint32_t stringQueueLargestBlock = ESP.getMaxAllocHeap();
+        uint32_t stringQueueHeap = ESP.getFreeHeap();
+        TEST_ASSERT_EQUAL_INT(BENCHMARK_NUM_LINES, linesHandled);
+
+        // Arena queue
+        WorkItemQueue workItemQueue;
+        workItemQueue.init("{\"workItemQueue\":{\"maxLen\":50}}", "workItemQueue");
+        uint32_t arenaHeapBefore = ESP.getFreeHeap();
+        startUs = micros();
+        linesHandled = 0;
+        for (int lineIdx = 0; lineIdx < BENCHMARK_NUM_LINES; )
+        {
+            while (!workItemQueue.isFull() && (lineIdx < BENCHMARK_NUM_LINES))
+            {
+                thrLine(lineIdx++, lineBuf);
+                TEST_ASSERT_TRUE(workItemQueue.add(lineBuf));
+                otherAllocs[lineIdx % otherAllocs.size()] = String(lineIdx);
+            }
+            WorkItem workItem;
+            while (workItemQueue.peek(workItem))
+            {
+                if (handleLine(workItem))
+                    linesHandled++;
+                workItemQueue.remove();
+            }
+        }
+        uint32_t arenaQueueUs = micros() - startUs;
+        TEST_ASSERT_EQUAL_INT(BENCHMARK_NUM_LINES, linesHandled);
+
+        Serial.printf("UnitTestWorkItemQueue benchmark %d lines String queue %uus heap %u->%u largest block %u, "
+                    "arena queue %uus heap %u->%u largest block %u\n",
+                    BENCHMARK_NUM_LINES, stringQueueUs, heapBefore, stringQueueHeap, stringQueueLargestBlock,
+                    arenaQueueUs, arenaHeapBefore, ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+    }
+
+    void runTests()
+    {
+        testArena();
+        benchmark();
+    }
+};
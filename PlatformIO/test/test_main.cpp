@@ -2,6 +2,18 @@
 #include <unity.h>
 #include "UnitTestHomingSeq.h"
 #include "UnitTestMiniHDLC.h"
+#include "UnitTestMotionPlanner.h"
+#include "UnitTestSCurve.h"
+#include "UnitTestRampGenerator.h"
+#include "UnitTestWorkItemQueue.h"
+#include "UnitTestFileManager.h"
+#include "UnitTestJsonDocumentView.h"
+#include "UnitTestPatternProgram.h"
+#include "UnitTestGCode.h"
+#include "UnitTestBlockSplitter.h"
+#include "UnitTestMotionCoalescer.h"
+#include "UnitTestFilesSimplifier.h"
+#include "UnitTestMotionHelper.h"
 
 void setUp(void) {
 // set stuff up here
@@ -21,6 +33,66 @@ void testMiniHDLC(void) {
     unitTestMiniHDLC.runTests();
 }
 
+void testMotionPlanner(void) {
+    UnitTestMotionPlanner unitTestMotionPlanner;
+    unitTestMotionPlanner.runTests();
+}
+
+void testSCurve(void) {
+    UnitTestSCurve unitTestSCurve;
+    unitTestSCurve.runTests();
+}
+
+void testRampGenerator(void) {
+    UnitTestRampGenerator unitTestRampGenerator;
+    unitTestRampGenerator.runTests();
+}
+
+void testWorkItemQueue(void) {
+    UnitTestWorkItemQueue unitTestWorkItemQueue;
+    unitTestWorkItemQueue.runTests();
+}
+
+void testFileManager(void) {
+    UnitTestFileManager unitTestFileManager;
+    unitTestFileManager.runTests();
+}
+
+void testJsonDocumentView(void) {
+    UnitTestJsonDocumentView unitTestJsonDocumentView;
+    unitTestJsonDocumentView.runTests();
+}
+
+void testPatternProgram(void) {
+    UnitTestPatternProgram unitTestPatternProgram;
+    unitTestPatternProgram.runTests();
+}
+
+void testGCode(void) {
+    UnitTestGCode unitTestGCode;
+    unitTestGCode.runTests();
+}
+
+void testBlockSplitter(void) {
+    UnitTestBlockSplitter unitTestBlockSplitter;
+    unitTestBlockSplitter.runTests();
+}
+
+void testMotionCoalescer(void) {
+    UnitTestMotionCoalescer unitTestMotionCoalescer;
+    unitTestMotionCoalescer.runTests();
+}
+
+void testFilesSimplifier(void) {
+    UnitTestFilesSimplifier unitTestFilesSimplifier;
+    unitTestFilesSimplifier.runTests();
+}
+
+void testMotionHelper(void) {
+    UnitTestMotionHelper unitTestMotionHelper;
+    unitTestMotionHelper.runTests();
+}
+
 void setup() {
     // NOTE!!! Wait for >2 secs
     // if board doesn't support software reset via Serial.DTR/RTS
@@ -31,6 +103,18 @@ void setup() {
     // Run the tests
     RUN_TEST(testMiniHDLC);
     RUN_TEST(testHomingSeq);
+    RUN_TEST(testMotionPlanner);
+    RUN_TEST(testSCurve);
+    RUN_TEST(testRampGenerator);
+    RUN_TEST(testWorkItemQueue);
+    RUN_TEST(testFileManager);
+    RUN_TEST(testJsonDocumentView);
+    RUN_TEST(testPatternProgram);
+    RUN_TEST(testGCode);
+    RUN_TEST(testBlockSplitter);
+    RUN_TEST(testMotionCoalescer);
+    RUN_TEST(testFilesSimplifier);
+    RUN_TEST(testMotionHelper);
 
     UNITY_END(); // stop unit testing
 